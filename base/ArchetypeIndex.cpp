@@ -0,0 +1,95 @@
+
+#include <lg/interface.h>
+#include <lg/scrmanagers.h>
+#include <lg/scrservices.h>
+#include <lg/objects.h>
+#include "ArchetypeIndex.h"
+#include "ScriptServices.h"
+
+
+/* ------------------------------------------------------------------------
+ *  Public interface
+ */
+
+ArchetypeIndex& ArchetypeIndex::get()
+{
+    static ArchetypeIndex index;
+
+    return index;
+}
+
+
+bool ArchetypeIndex::inherits_from(int obj_id, int archetype)
+{
+    if(obj_id == archetype) return true;
+
+    if(!built) build();
+
+    // Anything the index doesn't know about has to go to the engine
+    if(!indexed(archetype)) {
+        SService<IObjectSrv>& ObjectSrv = ScriptServices::object();
+        true_bool inherits;
+
+        ObjectSrv -> InheritsFrom(inherits, obj_id, archetype);
+        return inherits;
+    }
+
+    // Concrete objects are checked via their archetype
+    if(obj_id > 0) {
+        SInterface<ITraitManager>& TraitMgr = ScriptServices::trait_manager();
+        obj_id = TraitMgr -> GetArchetype(obj_id);
+    }
+
+    if(!indexed(obj_id)) return false;
+
+    uint number = enter[-obj_id];
+    return number >= enter[-archetype] && number <= leave[-archetype];
+}
+
+
+/* ------------------------------------------------------------------------
+ *  Private members
+ */
+
+void ArchetypeIndex::build()
+{
+    SInterface<IObjectSystem>& ObjectSys = ScriptServices::object_system();
+
+    enter.clear();
+    leave.clear();
+
+    int root = ObjectSys -> GetObjectNamed("Object");
+    if(root < 0) {
+        uint counter = 0;
+        visit(root, counter);
+    }
+
+    built = true;
+}
+
+
+void ArchetypeIndex::visit(int archetype, uint& counter)
+{
+    uint slot = -archetype;
+    if(slot >= enter.size()) {
+        enter.resize(slot + 1, 0);
+        leave.resize(slot + 1, 0);
+    }
+
+    // Numbers start at 1, so that 0 can mean "not indexed"
+    enter[slot] = ++counter;
+
+    SInterface<ITraitManager>& TraitMgr = ScriptServices::trait_manager();
+    SInterface<IObjectQuery> query = TraitMgr -> Query(archetype, kTraitQueryChildren);
+    if(query) {
+        for(; !query -> Done(); query -> Next()) {
+            int child = query -> Object();
+
+            // Concrete objects are not part of the tree
+            if(child < 0)
+                visit(child, counter);
+        }
+    }
+
+    leave[slot] = counter;
+}
@@ -0,0 +1,93 @@
+/** @file
+ * This file contains the interface for the module-wide archetype ancestry
+ * index, which answers "does this object inherit from that archetype?"
+ * without walking the hierarchy in the engine.
+ *
+ * @author Chris Page &lt;chris@starforge.co.uk&gt;
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef ARCHETYPEINDEX_H
+#define ARCHETYPEINDEX_H
+
+#include <lg/config.h>
+#include <lg/objstd.h>
+#include <vector>
+
+/** A flattened copy of the archetype hierarchy below "Object". The hierarchy
+ *  is walked depth-first once, numbering each archetype on the way down and
+ *  recording the last number used below it on the way back up, so every
+ *  archetype owns a contiguous interval of numbers that contains exactly the
+ *  numbers of its descendants. Checking whether one archetype descends from
+ *  another is then two comparisons.
+ *
+ *  Archetypes can only be added or reparented in the editor, so the index is
+ *  built the first time it is needed and discarded by invalidate() when the
+ *  sim starts or a new mission or saved game is loaded.
+ *
+ *  Metaproperties are not part of the archetype tree, and objects gain and
+ *  lose them during the game, so checks against a metaproperty (or anything
+ *  else not in the index) are passed on to the engine.
+ */
+class ArchetypeIndex
+{
+public:
+    /** Obtain a reference to the module's archetype index.
+     *
+     * @return A reference to the index.
+     */
+    static ArchetypeIndex& get();
+
+
+    /** Determine whether the specified object is, or inherits from, the
+     *  specified archetype. This gives the same result as
+     *  IObjectSrv::InheritsFrom().
+     *
+     * @param obj_id    The ID of the object to check. This may be concrete or
+     *                  an archetype.
+     * @param archetype The ID of the archetype or metaproperty to check for.
+     * @return true if the object inherits from the archetype, false otherwise.
+     */
+    bool inherits_from(int obj_id, int archetype);
+
+
+    /** Discard the index, so that it is rebuilt the next time it is used.
+     */
+    void invalidate()
+        { built = false; }
+
+private:
+    ArchetypeIndex() : enter(), leave(), built(false)
+        { /* fnord */ }
+
+    /** Walk the archetype hierarchy and build the intervals.
+     */
+    void build();
+
+    /** Number the specified archetype and all of its descendants.
+     */
+    void visit(int archetype, uint& counter);
+
+    /** Determine whether the specified archetype is in the index.
+     */
+    bool indexed(int archetype) const
+        { return archetype < 0 && uint(-archetype) < enter.size() && enter[-archetype]; }
+
+    std::vector<uint> enter; //!< The number given to each archetype, indexed by -ID. 0 if not in the index.
+    std::vector<uint> leave; //!< The highest number given to any descendant of each archetype, indexed by -ID.
+    bool built;              //!< Has the index been built since it was last invalidated?
+};
+
+#endif // ARCHETYPEINDEX_H
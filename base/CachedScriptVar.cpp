@@ -0,0 +1,140 @@
+
+#include "CachedScriptVar.h"
+
+CachedScriptVar* CachedScriptVar::dirty_head = NULL;
+uint CachedScriptVar::current_generation = 1;
+uint CachedScriptVar::depth = 0;
+
+
+/* ------------------------------------------------------------------------
+ *  Public interface
+ */
+
+void CachedScriptVar::flush()
+{
+    if(!dirty) return;
+
+    sMultiParm param;
+    to_param(param);
+    g_pScriptManager -> SetScriptData(&m_tag, &param);
+
+    unlink();
+}
+
+
+bool CachedScriptVar::Valid()
+{
+    fetch();
+
+    return is_set;
+}
+
+
+void CachedScriptVar::Clear()
+{
+    unlink();
+
+    sMultiParm param;
+    param.type = kMT_Undef;
+    g_pScriptManager -> ClearScriptData(&m_tag, &param);
+
+    // The variable is now known to be unset, so there's no need to ask again.
+    param.type = kMT_Undef;
+    from_param(param);
+    is_set = false;
+    generation = current_generation;
+}
+
+
+void CachedScriptVar::flush_all()
+{
+    while(dirty_head)
+        dirty_head -> flush();
+}
+
+
+void CachedScriptVar::invalidate_all()
+{
+    flush_all();
+
+    // Any variable fetched before this point will no longer match.
+    ++current_generation;
+}
+
+
+/* ------------------------------------------------------------------------
+ *  Protected members
+ */
+
+CachedScriptVar::CachedScriptVar(const char* script_name, const char* var_name, int obj_id) : script_var(script_name, var_name, obj_id), is_set(false), dirty(false), generation(0), prev_dirty(NULL), next_dirty(NULL)
+{
+    /* fnord */
+}
+
+
+CachedScriptVar::~CachedScriptVar()
+{
+    // Scopes flush everything before control returns to the engine, so
+    // there should never be anything to lose here. If there is, the
+    // database may already be going away, so it is not safe to write it.
+    unlink();
+}
+
+
+void CachedScriptVar::mark_dirty()
+{
+    is_set = true;
+    generation = current_generation;
+
+    if(!depth) {
+        dirty = true;
+        flush();
+        return;
+    }
+
+    if(!dirty) {
+        dirty = true;
+        prev_dirty = NULL;
+        next_dirty = dirty_head;
+        if(dirty_head)
+            dirty_head -> prev_dirty = this;
+        dirty_head = this;
+    }
+}
+
+
+/* ------------------------------------------------------------------------
+ *  Private members
+ */
+
+void CachedScriptVar::load()
+{
+    sMultiParm param;
+    param.type = kMT_Undef;
+
+    is_set = g_pScriptManager -> IsScriptDataSet(&m_tag);
+    if(is_set)
+        g_pScriptManager -> GetScriptData(&m_tag, &param);
+
+    from_param(param);
+    generation = current_generation;
+}
+
+
+void CachedScriptVar::unlink()
+{
+    if(!dirty) return;
+
+    // flush() may be called on a variable that was written outside of any
+    // Scope, in which case it was never linked into the list.
+    if(prev_dirty)
+        prev_dirty -> next_dirty = next_dirty;
+    else if(dirty_head == this)
+        dirty_head = next_dirty;
+
+    if(next_dirty)
+        next_dirty -> prev_dirty = prev_dirty;
+
+    prev_dirty = next_dirty = NULL;
+    dirty = false;
+}
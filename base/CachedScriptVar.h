@@ -0,0 +1,227 @@
+/** @file
+ * This file contains the interface for write-back cached persistent script
+ * variables. These behave like the script_int and script_float classes in
+ * scriptvars.h, except that the value is only fetched from the script
+ * database once, and changes are held in memory until the variables are
+ * flushed.
+ *
+ * @author Chris Page &lt;chris@starforge.co.uk&gt;
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef CACHEDSCRIPTVAR_H
+#define CACHEDSCRIPTVAR_H
+
+#include "scriptvars.h"
+
+/** The type-independent part of a cached persistent script variable. This
+ *  keeps track of whether the cached value is current, and maintains a
+ *  module-wide list of variables whose values have changed but have not yet
+ *  been written back to the script database.
+ *
+ *  The engine does not reliably tell scripts before it writes a save game
+ *  (quicksaves in particular happen between messages), so the only point at which the database is guaranteed to be up to date is when
+ *  control returns to the engine. TWBaseScript::ReceiveMessage() holds a
+ *  Scope while handling each message, and when the outermost Scope ends all
+ *  dirty variables are flushed. However many times a variable is read or
+ *  written while handling a message (including any messages sent while
+ *  handling it), it costs at most one database read and one write.
+ *
+ *  Cached values are discarded whenever invalidate_all() is called, which
+ *  TWBaseScript does when the sim starts, when the game mode changes, and
+ *  when a script begins, as these are the points at which the database may
+ *  have been replaced by a loaded game.
+ */
+class CachedScriptVar : public script_var
+{
+public:
+    /** A convenience class that marks the start and end of a period in which
+     *  writes to cached variables may be deferred. When the outermost Scope
+     *  is destroyed, all dirty variables are flushed.
+     */
+    class Scope
+    {
+    public:
+        Scope()
+            { ++depth; }
+
+        ~Scope()
+            { if(!--depth) flush_all(); }
+    };
+
+
+    /** Write any pending change to this variable back to the script database.
+     */
+    void flush();
+
+
+    /** Determine whether the variable has a value, either in the database
+     *  or pending being written to it.
+     *
+     * @return true if the variable has been set, false otherwise.
+     */
+    bool Valid();
+
+
+    /** Remove the variable from the script database, discarding any pending
+     *  change to it.
+     */
+    void Clear();
+
+
+    /** Write all pending changes to cached variables back to the database.
+     */
+    static void flush_all();
+
+
+    /** Flush any pending changes, and then discard all cached values so
+     *  that they will be fetched from the database again the next time they
+     *  are used.
+     */
+    static void invalidate_all();
+
+protected:
+    CachedScriptVar(const char* script_name, const char* var_name, int obj_id);
+    virtual ~CachedScriptVar();
+
+
+    /** Ensure that the cached value is current, fetching it from the
+     *  database if needed.
+     */
+    void fetch()
+        { if(generation != current_generation) load(); }
+
+
+    /** Record that the cached value has been set and needs to be written
+     *  back to the database. This makes the cached value current, so the
+     *  value does not need to be fetched before it is overwritten. If no
+     *  Scope is active, the value is written back immediately.
+     */
+    void mark_dirty();
+
+
+    /** Store the value in the specified multiparm in the cache.
+     *
+     * @param param The multiparm to copy the value out of. If the variable
+     *              is not set, this will have type kMT_Undef.
+     */
+    virtual void from_param(const sMultiParm& param) = 0;
+
+
+    /** Copy the cached value into the specified multiparm.
+     *
+     * @param param The multiparm to store the value in.
+     */
+    virtual void to_param(sMultiParm& param) = 0;
+
+private:
+    // Cached variables live in script objects, and must not be copied.
+    CachedScriptVar(const CachedScriptVar&);
+    CachedScriptVar& operator=(const CachedScriptVar&);
+
+    /** Fetch the value of the variable from the database.
+     */
+    void load();
+
+    /** Remove this variable from the dirty list.
+     */
+    void unlink();
+
+    bool is_set;                  //!< Does the variable have a value?
+    bool dirty;                   //!< Does the value need to be written back?
+    uint generation;              //!< The value of current_generation when the value was fetched.
+    CachedScriptVar* prev_dirty;  //!< The previous variable in the dirty list.
+    CachedScriptVar* next_dirty;  //!< The next variable in the dirty list.
+
+    static CachedScriptVar* dirty_head; //!< The most recently dirtied variable.
+    static uint current_generation;     //!< Incremented to discard all cached values.
+    static uint depth;                  //!< The number of Scopes currently active.
+};
+
+
+/** A cached persistent script variable holding a simple value. T must be
+ *  either int or float.
+ */
+template <typename T>
+class CachedScriptValue : public CachedScriptVar
+{
+public:
+    CachedScriptValue(const char* script_name, const char* var_name, int obj_id) : CachedScriptVar(script_name, var_name, obj_id), value(0)
+        { /* fnord */ }
+
+
+    /** Set the variable to the specified value if it has not already been
+     *  set in a previous session.
+     *
+     * @param initial The value to set.
+     */
+    void Init(T initial = 0)
+        { if(!Valid()) *this = initial; }
+
+
+    operator T()
+        { fetch(); return value; }
+
+    CachedScriptValue& operator=(T newval)
+        { value = newval; mark_dirty(); return *this; }
+
+    CachedScriptValue& operator+=(T delta)
+        { return *this = *this + delta; }
+
+    CachedScriptValue& operator-=(T delta)
+        { return *this = *this - delta; }
+
+    CachedScriptValue& operator++()
+        { return *this = *this + 1; }
+
+    CachedScriptValue& operator--()
+        { return *this = *this - 1; }
+
+    T operator++(int)
+        { T old = *this; *this = old + 1; return old; }
+
+    T operator--(int)
+        { T old = *this; *this = old - 1; return old; }
+
+protected:
+    void from_param(const sMultiParm& param);
+    void to_param(sMultiParm& param);
+
+private:
+    T value; //!< The cached value of the variable.
+};
+
+
+template <>
+inline void CachedScriptValue<int>::from_param(const sMultiParm& param)
+    { value = (param.type == kMT_Int) ? param.i : 0; }
+
+template <>
+inline void CachedScriptValue<int>::to_param(sMultiParm& param)
+    { param.type = kMT_Int; param.i = value; }
+
+template <>
+inline void CachedScriptValue<float>::from_param(const sMultiParm& param)
+    { value = (param.type == kMT_Float) ? param.f : 0.0f; }
+
+template <>
+inline void CachedScriptValue<float>::to_param(sMultiParm& param)
+    { param.type = kMT_Float; param.f = value; }
+
+
+typedef CachedScriptValue<int>   cached_script_int;
+typedef CachedScriptValue<float> cached_script_float;
+
+#endif // CACHEDSCRIPTVAR_H
@@ -0,0 +1,64 @@
+/** @file
+ * This file contains case-insensitive comparison and hashing functors for
+ * use with unordered containers keyed on C strings.
+ *
+ * @author Chris Page &lt;chris@starforge.co.uk&gt;
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef CHARHASH_H
+#define CHARHASH_H
+
+#include <cstddef>
+#include <cctype>
+
+/** Case-insensitive equality functor for C strings.
+ */
+struct char_icmp
+{
+    bool operator () (const char* a ,const char* b) const {
+        while(*a && *b) {
+            if(tolower(*a) != tolower(*b)) return false;
+            ++a;
+            ++b;
+        }
+        return(*a == *b);
+    }
+};
+
+
+/** Case-insensitive hash functor for C strings.
+ */
+struct char_hash
+{
+    /** Hashing operator based on the sdbm algorith, see this URL
+     *  http://www.cse.yorku.ca/~oz/hash.html for more details.
+     */
+    size_t operator()(const char* str) const {
+        size_t hash = 0;
+        int c;
+
+        /* Note the tolower here is not standard: I've added it to make the
+         * hash case insensitive.
+         */
+        while((c = tolower(*str++))) {
+            hash = c + (hash << 6) + (hash << 16) - hash;
+        }
+
+        return hash;
+    }
+};
+
+#endif // CHARHASH_H
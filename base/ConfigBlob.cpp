@@ -0,0 +1,141 @@
+
+#include <windows.h>
+#include <cstring>
+#include <algorithm>
+#include "ConfigBlob.h"
+
+const ConfigBlob::Header*    ConfigBlob::header = NULL;
+const ConfigBlob::Note*      ConfigBlob::notes  = NULL;
+const DesignNote::Key*       ConfigBlob::keys   = NULL;
+const char*                  ConfigBlob::text   = NULL;
+void*                        ConfigBlob::handle = NULL;
+
+/** Ordering for note records, so they can be searched by hash.
+ */
+static bool note_hash_less(const ConfigBlob::Note& note, uint32_t hash)
+{
+    return note.hash < hash;
+}
+
+
+/* ------------------------------------------------------------------------
+ *  Public interface
+ */
+
+bool ConfigBlob::load(const char* filename)
+{
+    release();
+
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(file == INVALID_HANDLE_VALUE)
+        return false;
+
+    DWORD size = GetFileSize(file, NULL);
+    HANDLE mapping = NULL;
+    const void* view = NULL;
+
+    if(size != INVALID_FILE_SIZE && size >= sizeof(Header)) {
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if(mapping)
+            view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    }
+
+    // The mapping keeps the file open for as long as it needs it
+    CloseHandle(file);
+
+    if(!view || !validate(view, size)) {
+        if(view) UnmapViewOfFile(view);
+        if(mapping) CloseHandle(mapping);
+
+        return false;
+    }
+
+    handle = mapping;
+    header = static_cast<const Header*>(view);
+    notes  = reinterpret_cast<const Note*>(header + 1);
+    keys   = reinterpret_cast<const DesignNote::Key*>(notes + header -> note_count);
+    text   = reinterpret_cast<const char*>(keys + header -> key_count);
+
+    return true;
+}
+
+
+void ConfigBlob::release()
+{
+    if(header) {
+        UnmapViewOfFile(header);
+        CloseHandle(static_cast<HANDLE>(handle));
+    }
+
+    header = NULL;
+    notes  = NULL;
+    keys   = NULL;
+    text   = NULL;
+    handle = NULL;
+}
+
+
+const ConfigBlob::Note* ConfigBlob::find(const char* note, size_t length)
+{
+    if(!header) return NULL;
+
+    uint32_t hash = DesignNote::note_hash(note, length);
+
+    const Note* end = notes + header -> note_count;
+    for(const Note* it = std::lower_bound(notes, end, hash, note_hash_less); it != end && it -> hash == hash; ++it) {
+        if(it -> length == length && !memcmp(text + it -> text, note, length))
+            return it;
+    }
+
+    return NULL;
+}
+
+
+/* ------------------------------------------------------------------------
+ *  Private members
+ */
+
+bool ConfigBlob::validate(const void* data, size_t size)
+{
+    const Header* head = static_cast<const Header*>(data);
+
+    if(size < sizeof(Header) || memcmp(head -> magic, "TWCB", 4) || head -> version != VERSION)
+        return false;
+
+    // 64-bit arithmetic, so that silly counts can't wrap around
+    unsigned long long expected = sizeof(Header) +
+                                  static_cast<unsigned long long>(head -> note_count) * sizeof(Note) +
+                                  static_cast<unsigned long long>(head -> key_count) * sizeof(DesignNote::Key) +
+                                  head -> text_size;
+    if(expected != size)
+        return false;
+
+    const Note* note_list = reinterpret_cast<const Note*>(head + 1);
+    const DesignNote::Key* key_list = reinterpret_cast<const DesignNote::Key*>(note_list + head -> note_count);
+
+    // Everything is checked here, so that nothing needs to be checked when the notes are used
+    for(uint32_t n = 0; n < head -> note_count; ++n) {
+        const Note& note = note_list[n];
+
+        if(n && note.hash < note_list[n - 1].hash)
+            return false;
+
+        if(note.text > head -> text_size || note.length > head -> text_size - note.text)
+            return false;
+
+        if(note.first_key > head -> key_count || note.key_count > head -> key_count - note.first_key)
+            return false;
+
+        for(uint32_t k = note.first_key; k < note.first_key + note.key_count; ++k) {
+            const DesignNote::Key& key = key_list[k];
+
+            if(key.start > note.length || key.length > note.length - key.start || key.entry > key.start)
+                return false;
+
+            if(key.value > note.length || key.value_length > note.length - key.value)
+                return false;
+        }
+    }
+
+    return true;
+}
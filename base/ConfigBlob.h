@@ -0,0 +1,117 @@
+/** @file
+ * This file contains the interface for precompiled config blobs, which hold
+ * design notes that have already been split into parameters by the
+ * twcompile tool, so that scripts do not need to parse them at runtime.
+ *
+ * @author Chris Page &lt;chris@starforge.co.uk&gt;
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef CONFIGBLOB_H
+#define CONFIGBLOB_H
+
+// No lg headers here: this is also built into the twcompile tool.
+#include <cstddef>
+#include <stdint.h>
+#include "DesignNote.h"
+
+/** A memory-mapped file of precompiled design notes. A blob is laid out as
+ *  a Header, followed by header.note_count Note records sorted by hash,
+ *  header.key_count DesignNote::Key records, and header.text_size bytes of
+ *  note text. Offsets in Note records are relative to the start of the
+ *  key records and the text respectively. All values are little-endian.
+ *
+ *  Each key record also holds the parameter's value already parsed as a
+ *  number, so scripts reading parameters from a note in the blob do no
+ *  parsing at all beyond locating the note.
+ *
+ *  The module maps `twscript.twc` from the game directory when it is
+ *  loaded, if the file exists. Blobs are built from dumps of missions'
+ *  design notes by the twcompile tool, which reports any problems in the
+ *  notes as it does so. Notes that are not in the blob are parsed at
+ *  runtime as usual, so a blob never needs to be complete.
+ */
+class ConfigBlob
+{
+public:
+    static const uint32_t VERSION = 2; //!< Increase this whenever the layout changes.
+
+    struct Header {
+        char     magic[4];   //!< Always "TWCB".
+        uint32_t version;    //!< The VERSION the blob was written with.
+        uint32_t note_count; //!< The number of Note records.
+        uint32_t key_count;  //!< The number of DesignNote::Key records.
+        uint32_t text_size;  //!< The number of bytes of note text.
+    };
+
+    struct Note {
+        uint32_t hash;      //!< DesignNote::note_hash() of the text.
+        uint32_t text;      //!< The offset of the note text.
+        uint32_t length;    //!< The length of the note text.
+        uint32_t first_key; //!< The index of the note's first key record.
+        uint32_t key_count; //!< The number of key records for the note.
+    };
+
+
+    /** Map the specified blob into memory, replacing any blob currently
+     *  mapped. The blob is checked thoroughly before it is used, so a
+     *  damaged or out of date blob is rejected rather than trusted.
+     *
+     * @param filename The name of the blob to map.
+     * @return true if the blob has been mapped, false if it does not exist
+     *         or is not valid.
+     */
+    static bool load(const char* filename);
+
+
+    /** Unmap the current blob, if there is one.
+     */
+    static void release();
+
+
+    /** Locate a note in the blob.
+     *
+     * @param note   The text of the note to locate.
+     * @param length The length of the note.
+     * @return A pointer to the note record, or NULL if the note is not in the
+     *         blob or no blob is mapped.
+     */
+    static const Note* find(const char* note, size_t length);
+
+
+    /** Obtain the text of a note in the blob.
+     */
+    static const char* note_text(const Note* note)
+        { return text + note -> text; }
+
+
+    /** Obtain the parameters of a note in the blob.
+     */
+    static const DesignNote::Key* note_keys(const Note* note)
+        { return keys + note -> first_key; }
+
+private:
+    /** Check that a blob in memory is well formed.
+     */
+    static bool validate(const void* data, size_t size);
+
+    static const Header*          header; //!< The start of the mapped blob, NULL if there is none.
+    static const Note*            notes;  //!< The note records in the blob.
+    static const DesignNote::Key* keys;   //!< The key records in the blob.
+    static const char*            text;   //!< The note text in the blob.
+    static void*                  handle; //!< The file mapping the blob is viewed through.
+};
+
+#endif // CONFIGBLOB_H
@@ -0,0 +1,270 @@
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include "DesignNote.h"
+#ifndef TWCOMPILE
+#include "ConfigBlob.h"
+#endif
+
+const uint32_t DesignNote::EMPTY_SLOT;
+
+
+/** Add a character to a case-insensitive hash. This is the same sdbm step
+ *  used by char_hash, so that names can be hashed a piece at a time.
+ */
+static inline uint32_t hash_step(uint32_t hash, char c)
+{
+    return tolower(static_cast<unsigned char>(c)) + (hash << 6) + (hash << 16) - hash;
+}
+
+
+/* ------------------------------------------------------------------------
+ *  Public interface
+ */
+
+const DesignNote& DesignNote::index(const char* text)
+{
+    static DesignNote note;
+
+    if(!text) text = "";
+    size_t length = strlen(text);
+
+    if(!note.matches(text, length))
+        note.parse(text, length);
+
+    return note;
+}
+
+
+int DesignNote::find(const char* prefix, const char* name) const
+{
+    const Key* key = lookup(prefix, name);
+
+    return key ? key -> entry : -1;
+}
+
+
+const DesignNote::Key* DesignNote::lookup(const char* prefix, const char* name) const
+{
+    uint32_t hash = 0;
+    size_t prefix_len = strlen(prefix);
+    size_t name_len   = strlen(name);
+
+    for(const char* c = prefix; *c; ++c) hash = hash_step(hash, *c);
+    for(const char* c = name;   *c; ++c) hash = hash_step(hash, *c);
+
+    if(slots.empty())
+        return NULL;
+
+    // Repeated parameters are inserted in order, so the first is found first
+    for(size_t slot = hash & slot_mask; slots[slot] != EMPTY_SLOT; slot = (slot + 1) & slot_mask) {
+        const Key* key = keys + slots[slot];
+        if(key -> hash != hash || key -> length != prefix_len + name_len)
+            continue;
+
+        const char* keyname = text + key -> start;
+        if(!::_strnicmp(keyname, prefix, prefix_len) && !::_strnicmp(keyname + prefix_len, name, name_len))
+            return key;
+    }
+
+    return NULL;
+}
+
+
+bool DesignNote::value(const Key& key, std::string& value) const
+{
+    // Notes in a config blob are not terminated, so stick to the value's length
+    value.assign(text + key.value, key.value_length);
+
+    return (key.flags & KEY_VALUE) != 0;
+}
+
+
+void DesignNote::tokenise(const char* note, std::vector<Key>& keys, std::vector<std::string>* problems)
+{
+    const char* pos = note;
+    std::string number;
+
+    keys.clear();
+
+    while(*pos) {
+        Key key;
+        key.entry = pos - note;
+
+        // Skip any space before the name
+        while(*pos && isspace(static_cast<unsigned char>(*pos))) ++pos;
+        key.start = pos - note;
+
+        // The name runs up to the = or the end of the parameter, without any trailing space
+        const char* name_end = pos;
+        while(*pos && *pos != '=' && *pos != ';') {
+            ++pos;
+            if(!isspace(static_cast<unsigned char>(pos[-1]))) name_end = pos;
+        }
+
+        key.length = name_end - (note + key.start);
+        key.hash   = 0;
+        for(const char* c = note + key.start; c != name_end; ++c) key.hash = hash_step(key.hash, *c);
+
+        key.value        = pos - note;
+        key.value_length = 0;
+        key.flags        = 0;
+        key.ival         = 0;
+        key.fval         = 0.0f;
+
+        // Skip the value, which may be quoted to allow it to contain ;
+        if(*pos == '=') {
+            ++pos;
+            while(*pos && isspace(static_cast<unsigned char>(*pos))) ++pos;
+
+            key.flags |= KEY_VALUE;
+            key.value  = pos - note;
+
+            if(*pos == '\'' || *pos == '"') {
+                char quote = *pos++;
+                key.value = pos - note;
+                while(*pos && *pos != quote) ++pos;
+                key.value_length = (pos - note) - key.value;
+
+                if(*pos) {
+                    ++pos;
+                } else if(problems) {
+                    problems -> push_back("unterminated quote in value of '" + std::string(note + key.start, key.length) + "'");
+                }
+
+                while(*pos && *pos != ';') ++pos;
+            } else {
+                while(*pos && *pos != ';') ++pos;
+                key.value_length = (pos - note) - key.value;
+            }
+
+            parse_number(note + key.value, key.value_length, key, number);
+
+        } else if(problems && key.length) {
+            problems -> push_back("'" + std::string(note + key.start, key.length) + "' has no value");
+        }
+
+        if(key.length) {
+            if(problems) {
+                for(std::vector<Key>::const_iterator prev = keys.begin(); prev != keys.end(); ++prev) {
+                    if(prev -> hash == key.hash && prev -> length == key.length && !::_strnicmp(note + prev -> start, note + key.start, key.length)) {
+                        problems -> push_back("'" + std::string(note + key.start, key.length) + "' is set more than once, only the first will be used");
+                        break;
+                    }
+                }
+            }
+
+            keys.push_back(key);
+        } else if(problems && pos != note + key.start) {
+            problems -> push_back("value with no parameter name");
+        }
+
+        if(*pos == ';') ++pos;
+    }
+}
+
+
+uint32_t DesignNote::note_hash(const char* note, size_t length)
+{
+    // FNV-1a, case sensitive as the notes have to match exactly
+    uint32_t hash = 2166136261u;
+
+    for(size_t i = 0; i < length; ++i) {
+        hash ^= static_cast<unsigned char>(note[i]);
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+
+/* ------------------------------------------------------------------------
+ *  Private members
+ */
+
+void DesignNote::parse_number(const char* value, size_t length, Key& key, std::string& buffer)
+{
+    // The value may be followed by the rest of the note, so parse a copy
+    buffer.assign(value, length);
+
+    const char* start = buffer.c_str();
+    while(*start && isspace(static_cast<unsigned char>(*start))) ++start;
+
+    if(*start == '$') {
+        key.flags |= KEY_QVAR;
+        return;
+    }
+
+    char* end;
+    long ival = strtol(start, &end, 10);
+    if(end != start) {
+        key.flags |= KEY_INT;
+        key.ival   = ival;
+    }
+
+    float fval = strtof(start, &end);
+    if(end != start) {
+        key.flags |= KEY_FLOAT;
+        key.fval   = fval;
+
+        if(*end == 's')
+            key.flags |= KEY_SECONDS;
+        else if(*end == 'm')
+            key.flags |= KEY_MINUTES;
+    }
+}
+
+
+bool DesignNote::matches(const char* note, size_t note_len) const
+{
+    // Design notes are fetched into freshly allocated strings, so the pointer
+    // alone says nothing about whether the note is the same one.
+    return note_len == length && !memcmp(note, text, note_len);
+}
+
+
+void DesignNote::parse(const char* note, size_t note_len)
+{
+#ifndef TWCOMPILE
+    // Notes compiled into the blob can be used without copying or parsing
+    const ConfigBlob::Note* compiled = ConfigBlob::find(note, note_len);
+    if(compiled) {
+        text      = ConfigBlob::note_text(compiled);
+        length    = note_len;
+        keys      = ConfigBlob::note_keys(compiled);
+        key_count = compiled -> key_count;
+
+        build_slots();
+        return;
+    }
+#endif
+
+    owned_text.assign(note, note_len);
+    tokenise(owned_text.c_str(), owned_keys);
+
+    text      = owned_text.c_str();
+    length    = owned_text.size();
+    keys      = owned_keys.empty() ? NULL : &owned_keys[0];
+    key_count = owned_keys.size();
+
+    build_slots();
+}
+
+
+void DesignNote::build_slots()
+{
+    // Keeping the table at most half full keeps the probe sequences short
+    size_t size = 8;
+    while(size < key_count * 2) size <<= 1;
+
+    slots.assign(size, EMPTY_SLOT);
+    slot_mask = size - 1;
+
+    for(size_t pos = 0; pos < key_count; ++pos) {
+        size_t slot = keys[pos].hash & slot_mask;
+        while(slots[slot] != EMPTY_SLOT) slot = (slot + 1) & slot_mask;
+
+        slots[slot] = pos;
+    }
+}
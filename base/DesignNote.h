@@ -0,0 +1,216 @@
+/** @file
+ * This file contains the interface for the design note index, which splits
+ * a design note into its parameters once so that they can be located
+ * without scanning the whole note for each one.
+ *
+ * @author Chris Page &lt;chris@starforge.co.uk&gt;
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef DESIGNNOTE_H
+#define DESIGNNOTE_H
+
+// No lg headers here: this is also built into the twcompile tool.
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/** An index of the parameters in a design note. Design notes are of the
+ *  form `Name1=value1;Name2='value2';...`, where values may be quoted with
+ *  ' or " if they need to contain ';'. The index records where each
+ *  parameter starts, keyed by a case-insensitive hash of its name, so that
+ *  looking a parameter up only needs to look at the names with the same
+ *  hash rather than the whole note.
+ *
+ *  Scripts usually read many parameters from the same note in quick
+ *  succession while initialising, so the index of the most recently used
+ *  note is kept. The note passed in is compared against the indexed copy
+ *  each time, so callers do not need to do anything to keep it current.
+ *  Values are also located, and parsed as numbers, while the index is built,
+ *  so reading a numeric parameter needs no further parsing or allocation.
+ *  If a precompiled config blob has been loaded (see ConfigBlob), notes it
+ *  contains are not parsed at all: the index uses the blob's copy directly.
+ */
+class DesignNote
+{
+public:
+    /** Flags describing the value of a parameter.
+     */
+    enum KeyFlags {
+        KEY_VALUE   = 0x01, //!< The parameter has a value.
+        KEY_QVAR    = 0x02, //!< The value starts with '$', so it is read from a QVar.
+        KEY_INT     = 0x04, //!< The value starts with an integer, stored in ival.
+        KEY_FLOAT   = 0x08, //!< The value starts with a number, stored in fval.
+        KEY_SECONDS = 0x10, //!< The number is followed by 's'.
+        KEY_MINUTES = 0x20, //!< The number is followed by 'm'.
+    };
+
+
+    /** The location of a parameter within a note, and its value parsed as a
+     *  number where possible. This is also the layout of the key records in
+     *  a config blob, so it must not be changed without changing
+     *  ConfigBlob::VERSION.
+     */
+    struct Key {
+        uint32_t hash;         //!< Case-insensitive hash of the parameter name.
+        uint32_t start;        //!< Offset of the start of the parameter name in the note.
+        uint32_t length;       //!< Length of the parameter name.
+        uint32_t entry;        //!< Offset of the start of the parameter, including any leading space.
+        uint32_t value;        //!< Offset of the start of the value, inside any quotes.
+        uint32_t value_length; //!< Length of the value, not including any quotes.
+        uint32_t flags;        //!< A combination of KeyFlags.
+        int32_t  ival;         //!< The value as an integer, if KEY_INT is set.
+        float    fval;         //!< The value as a float, if KEY_FLOAT is set.
+    };
+
+
+    /** Obtain the index for the specified design note, building it if the
+     *  note is not the one most recently indexed.
+     *
+     * @param text The design note to index.
+     * @return A reference to the index. This describes the note until a
+     *         different note is indexed.
+     */
+    static const DesignNote& index(const char* text);
+
+
+    /** Locate a parameter in the indexed note. The name of the parameter is
+     *  given in two parts, so that the script name does not need to be
+     *  joined onto the parameter name before searching.
+     *
+     * @param prefix The first part of the parameter name, usually the script name.
+     * @param name   The rest of the parameter name.
+     * @return An offset into the design note at which the parameter starts,
+     *         or -1 if the note does not contain it. If the note contains the
+     *         parameter more than once, this is the first one.
+     */
+    int find(const char* prefix, const char* name) const;
+
+
+    /** Locate the key for a parameter in the indexed note. This works in the
+     *  same way as find().
+     *
+     * @param prefix The first part of the parameter name, usually the script name.
+     * @param name   The rest of the parameter name.
+     * @return A pointer to the key for the parameter, or NULL if the note
+     *         does not contain it.
+     */
+    const Key* lookup(const char* prefix, const char* name) const;
+
+
+    /** Obtain the number of parameters in the indexed note.
+     *
+     * @return The number of parameters, including any repeated ones.
+     */
+    size_t size() const
+        { return key_count; }
+
+
+    /** Obtain the location of a parameter in the indexed note.
+     *
+     * @param pos The index of the parameter, in the order they appear in the note.
+     * @return A reference to the parameter's key.
+     */
+    const Key& key(size_t pos) const
+        { return keys[pos]; }
+
+
+    /** Obtain the name of a parameter in the indexed note. This is not
+     *  terminated: it runs for key.length characters.
+     *
+     * @param key The key of the parameter.
+     * @return A pointer to the start of the parameter name.
+     */
+    const char* name(const Key& key) const
+        { return text + key.start; }
+
+
+    /** Obtain the value of a parameter in the indexed note, with any quotes
+     *  around it removed. This is not terminated: it runs for
+     *  key.value_length characters.
+     *
+     * @param key The key of the parameter.
+     * @return A pointer to the start of the value.
+     */
+    const char* value_text(const Key& key) const
+        { return text + key.value; }
+
+
+    /** Fetch the value of a parameter in the indexed note, with any quotes
+     *  around it removed.
+     *
+     * @param key   The key of the parameter.
+     * @param value A string to store the value in. This is cleared if the
+     *              parameter has no value.
+     * @return true if the parameter has a value, false if it is just a name.
+     */
+    bool value(const Key& key, std::string& value) const;
+
+
+    /** Split a note into parameters, and parse their values as numbers where
+     *  possible. This is the parser used by index(), and by the twcompile
+     *  tool when building config blobs.
+     *
+     * @param note     The design note to split.
+     * @param keys     A vector to store the parameters in, in the order they appear.
+     * @param problems If not NULL, a description of anything in the note that
+     *                 looks like a mistake is added to this vector.
+     */
+    static void tokenise(const char* note, std::vector<Key>& keys, std::vector<std::string>* problems = NULL);
+
+
+    /** Calculate the hash used to look notes up in a config blob.
+     *
+     * @param note   The text of the note.
+     * @param length The length of the note.
+     * @return The hash of the note.
+     */
+    static uint32_t note_hash(const char* note, size_t length);
+
+private:
+    DesignNote() : owned_text(), owned_keys(), text(""), length(0), keys(NULL), key_count(0), slots(), slot_mask(0)
+        { /* fnord */ }
+
+    static const uint32_t EMPTY_SLOT = 0xFFFFFFFF; //!< Marks an unused slot in the hash table.
+
+    /** Build the hash table used by lookup() over the current keys.
+     */
+    void build_slots();
+
+    /** Split the specified note into parameters, replacing the current index.
+     */
+    void parse(const char* note, size_t note_len);
+
+    /** Parse the value of a parameter as a number, setting the key's flags
+     *  and values to match.
+     */
+    static void parse_number(const char* value, size_t length, Key& key, std::string& buffer);
+
+    /** Does the indexed note match the specified one?
+     */
+    bool matches(const char* note, size_t note_len) const;
+
+    std::string           owned_text; //!< A copy of the note, if it was parsed here.
+    std::vector<Key>      owned_keys; //!< The parameters in the note, if it was parsed here.
+    const char*           text;       //!< The indexed note, either owned_text or in a config blob.
+    size_t                length;     //!< The length of the indexed note.
+    const Key*            keys;       //!< The parameters in the note, in the order they appear.
+    size_t                key_count;  //!< The number of parameters in the note.
+    std::vector<uint32_t> slots;      //!< An open addressed hash table of indexes into keys, by name hash.
+    size_t                slot_mask;  //!< The size of the hash table, less one.
+};
+
+#endif // DESIGNNOTE_H
@@ -0,0 +1,75 @@
+
+#include <cstring>
+#include <unordered_set>
+#include "IString.h"
+
+const char IString::empty_str[] = "";
+
+/** Case-sensitive equality functor for C strings.
+ */
+struct char_cmp
+{
+    bool operator () (const char* a, const char* b) const {
+        return !strcmp(a, b);
+    }
+};
+
+
+/** Case-sensitive hash functor for C strings, using the same sdbm algorithm
+ *  as char_hash.
+ */
+struct char_exact_hash
+{
+    size_t operator()(const char* str) const {
+        size_t hash = 0;
+        int c;
+
+        while((c = static_cast<unsigned char>(*str++))) {
+            hash = c + (hash << 6) + (hash << 16) - hash;
+        }
+
+        return hash;
+    }
+};
+
+
+/** The pool itself. The strings it holds are owned by the pool, and freed
+ *  along with it when the module is unloaded.
+ */
+class StringPool
+{
+public:
+    typedef std::unordered_set<const char*, char_exact_hash, char_cmp> StringSet;
+
+    ~StringPool()
+    {
+        for(StringSet::iterator it = strings.begin(); it != strings.end(); ++it) {
+            delete[] *it;
+        }
+    }
+
+    StringSet strings;
+};
+
+
+/* ------------------------------------------------------------------------
+ *  Private members
+ */
+
+const char* IString::intern(const char* text)
+{
+    if(!text || !*text) return empty_str;
+
+    static StringPool pool;
+
+    StringPool::StringSet::const_iterator it = pool.strings.find(text);
+    if(it != pool.strings.end())
+        return *it;
+
+    // Not seen before, so the pool needs its own copy
+    char* copy = new char[strlen(text) + 1];
+    strcpy(copy, text);
+    pool.strings.insert(copy);
+
+    return copy;
+}
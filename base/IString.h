@@ -0,0 +1,96 @@
+/** @file
+ * This file contains the interface for interned strings, which allow script
+ * instances to share a single copy of strings that many of them hold.
+ *
+ * @author Chris Page &lt;chris@starforge.co.uk&gt;
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef ISTRING_H
+#define ISTRING_H
+
+#include <string>
+
+/** A handle on a string in the module-wide string pool. Every IString with
+ *  the same contents points at the same copy in the pool, so an IString is
+ *  only the size of a pointer, copying one never allocates, and comparing
+ *  two is a pointer comparison. Comparisons are case-sensitive, as the
+ *  pool holds arbitrary text rather than just names.
+ *
+ *  Strings are never removed from the pool while the module is loaded, so
+ *  c_str() remains valid for as long as the module is. This suits values
+ *  taken from design notes, of which there are only as many distinct ones
+ *  as the mission's author wrote, but IStrings should not be used for text
+ *  that is generated freely at runtime.
+ */
+class IString
+{
+public:
+    /** Create an empty string.
+     */
+    IString() : str(empty_str)
+        { /* fnord */ }
+
+    /** Create a handle on the pooled copy of the specified text, adding it
+     *  to the pool if it is not already there.
+     *
+     * @param text The text to intern. NULL is treated as an empty string.
+     */
+    IString(const char* text) : str(intern(text))
+        { /* fnord */ }
+
+    /** Create a handle on the pooled copy of the specified text, adding it
+     *  to the pool if it is not already there.
+     *
+     * @param text The text to intern.
+     */
+    IString(const std::string& text) : str(intern(text.c_str()))
+        { /* fnord */ }
+
+
+    /** Obtain the text of the string. This remains valid for as long as the
+     *  module is loaded, even once the IString has been destroyed.
+     *
+     * @return A pointer to the pooled text. This must not be freed.
+     */
+    const char* c_str() const
+        { return str; }
+
+
+    /** Determine whether the string is empty.
+     *
+     * @return true if the string is empty, false otherwise.
+     */
+    bool empty() const
+        { return !*str; }
+
+
+    bool operator==(const IString& other) const
+        { return str == other.str; }
+
+    bool operator!=(const IString& other) const
+        { return str != other.str; }
+
+private:
+    /** Locate the pooled copy of the specified text, adding it if needed.
+     */
+    static const char* intern(const char* text);
+
+    const char* str; //!< The pooled copy of the string.
+
+    static const char empty_str[];
+};
+
+#endif // ISTRING_H
@@ -0,0 +1,157 @@
+#include <lg/interface.h>
+#include <lg/scrservices.h>
+#include <chrono>       // std::chrono::steady_clock
+#include "InitScheduler.h"
+#include "ScriptServices.h"
+
+/* ------------------------------------------------------------------------
+ *  Client
+ */
+
+InitScheduler::Client::~Client()
+{
+    InitScheduler& scheduler = InitScheduler::get();
+    bool was_driver = init_queued() && init_host == scheduler.driver_host;
+
+    scheduler.cancel(this);
+
+    // The wheel's engine timer may have been sent to this client's object,
+    // which is about to disappear along with it.
+    if(was_driver)
+        TimerWheel::get().host_gone(init_host);
+}
+
+
+/* ------------------------------------------------------------------------
+ *  Public interface
+ */
+
+InitScheduler& InitScheduler::get()
+{
+    // The wheel must outlive the scheduler, as the scheduler is one of its
+    // clients, so make sure it is constructed first.
+    TimerWheel::get();
+
+    static InitScheduler scheduler;
+
+    return scheduler;
+}
+
+
+bool InitScheduler::defer(Client* client, int host, uint now)
+{
+    if(client -> init_queued()) return true;
+
+    // The budget is read as each batch of scripts starts arriving, so that
+    // it can differ between missions.
+    if(!count) {
+        budget_ms = read_budget();
+        now_ms    = now;
+    } else if(now > now_ms) {
+        now_ms = now;
+    }
+
+    if(!budget_ms) return false;
+
+    Link* link = client;
+    link -> prev = queue.prev;
+    link -> next = &queue;
+    queue.prev -> next = link;
+    queue.prev = link;
+
+    client -> init_host = host;
+    ++count;
+
+    if(!wheel_scheduled())
+        reschedule(now_ms);
+
+    return true;
+}
+
+
+void InitScheduler::cancel(Client* client)
+{
+    if(!client -> init_queued()) return;
+
+    unlink(client);
+
+    // Keep the wheel timer attached to an object that is still waiting.
+    if(client -> init_host == driver_host) {
+        if(count) {
+            reschedule(now_ms);
+        } else {
+            TimerWheel::get().cancel(this);
+            driver_host = 0;
+        }
+    }
+}
+
+
+/* ------------------------------------------------------------------------
+ *  Private members
+ */
+
+InitScheduler::InitScheduler() : count(0), budget_ms(DEFAULT_BUDGET_MS), now_ms(0), driver_host(0)
+{
+    queue.prev = queue.next = &queue;
+}
+
+
+void InitScheduler::on_wheel_timer(sScrTimerMsg* tick, uint due)
+{
+    if(tick -> time > now_ms)
+        now_ms = tick -> time;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::milliseconds budget(budget_ms);
+
+    // At least one client is initialised each tick, however long it takes,
+    // so that the queue always drains.
+    while(count) {
+        Client* client = static_cast<Client*>(queue.next);
+        unlink(client);
+
+        client -> on_deferred_init(tick);
+
+        if(std::chrono::steady_clock::now() - start >= budget)
+            break;
+    }
+
+    if(count) {
+        reschedule(now_ms);
+    } else {
+        driver_host = 0;
+    }
+}
+
+
+void InitScheduler::unlink(Client* client)
+{
+    Link* link = client;
+    link -> prev -> next = link -> next;
+    link -> next -> prev = link -> prev;
+    link -> prev = link -> next = NULL;
+
+    --count;
+}
+
+
+void InitScheduler::reschedule(uint now)
+{
+    driver_host = static_cast<Client*>(queue.next) -> init_host;
+
+    TimerWheel::get().schedule(this, driver_host, now, now + 1);
+}
+
+
+uint InitScheduler::read_budget()
+{
+    SService<IQuestSrv>& QuestSrv = ScriptServices::quest();
+
+    if(!QuestSrv -> Exists("TWScriptInitBudget"))
+        return DEFAULT_BUDGET_MS;
+
+    int budget = QuestSrv -> Get("TWScriptInitBudget");
+
+    return (budget > 0) ? static_cast<uint>(budget) : 0;
+}
@@ -0,0 +1,139 @@
+/** @file
+ * This file contains the interface for the init scheduler, which spreads the
+ * initialisation of scripts over several timer wheel ticks rather than
+ * doing it all in the frame the mission starts.
+ *
+ * @author Chris Page &lt;chris@starforge.co.uk&gt;
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef INITSCHEDULER_H
+#define INITSCHEDULER_H
+
+#include <lg/config.h>
+#include <lg/objstd.h>
+#include <lg/scrmsgs.h>
+#include "TimerWheel.h"
+
+/** A queue of scripts waiting to be initialised. When a mission starts or a
+ *  saved game is loaded, every script in it receives BeginScript, Sim, and
+ *  DarkGameModeChange in the same few frames, and initialising them all at
+ *  once causes a visible hitch on large missions. Instead, scripts that have
+ *  nothing better to do than initialise are queued here, and the scheduler
+ *  initialises them in order on the following ticks of the timer wheel,
+ *  stopping each tick once its time budget has been used up. A script that receives any other
+ *  message while it is queued is initialised immediately instead.
+ *
+ *  The budget is taken from the "TWScriptInitBudget" QVar, in milliseconds
+ *  per 50ms tick, when the queue starts to fill. Setting it to 0 disables
+ *  the scheduler, so scripts initialise on their first message as before.
+ */
+class InitScheduler : private TimerWheel::Client
+{
+    struct Link {
+        Link* prev;
+        Link* next;
+    };
+
+public:
+    /** The base class for anything that can be queued for init. A client can
+     *  be queued at most once at a time. Destroying a client removes it from
+     *  the queue.
+     */
+    class Client : private Link
+    {
+    public:
+        Client() : init_host(0)
+            { prev = next = NULL; }
+
+        virtual ~Client();
+
+        /** Determine whether the client is waiting to be initialised.
+         *
+         * @return true if the client is queued, false otherwise.
+         */
+        bool init_queued() const
+            { return next != NULL; }
+
+    protected:
+        /** Called by the scheduler when it is the client's turn to initialise.
+         *  The client is no longer queued when this is called.
+         *
+         * @param tick The engine timer message that drove the timer wheel.
+         */
+        virtual void on_deferred_init(sScrTimerMsg* tick) = 0;
+
+    private:
+        friend class InitScheduler;
+
+        int init_host; //!< The object the client is attached to.
+    };
+
+
+    /** Obtain a reference to the module's init scheduler.
+     *
+     * @return A reference to the scheduler.
+     */
+    static InitScheduler& get();
+
+
+    /** Queue the specified client for init, if the scheduler is enabled. A
+     *  client that is already queued keeps its place.
+     *
+     * @param client The client to queue.
+     * @param host   The ID of the object the client is attached to.
+     * @param now    The current sim time.
+     * @return true if the client is queued, false if it should initialise
+     *         straight away.
+     */
+    bool defer(Client* client, int host, uint now);
+
+
+    /** Remove the specified client from the queue, if it is queued.
+     *
+     * @param client The client to remove.
+     */
+    void cancel(Client* client);
+
+private:
+    InitScheduler();
+
+    /** Initialise queued clients until the budget for this tick is used up.
+     */
+    virtual void on_wheel_timer(sScrTimerMsg* tick, uint due);
+
+    /** Take a client off the queue.
+     */
+    void unlink(Client* client);
+
+    /** Put the scheduler on the timer wheel for the next tick, with the
+     *  engine timer sent to the object of the first client in the queue.
+     */
+    void reschedule(uint now);
+
+    /** Fetch the per-tick budget from its QVar.
+     */
+    static uint read_budget();
+
+    static const uint DEFAULT_BUDGET_MS = 5;
+
+    Link queue;       //!< Circular list of queued clients.
+    uint count;       //!< The number of queued clients.
+    uint budget_ms;   //!< The time to spend initialising clients in each tick.
+    uint now_ms;      //!< The latest sim time seen.
+    int  driver_host; //!< The object the scheduler's wheel timer is attached to.
+};
+
+#endif // INITSCHEDULER_H
@@ -0,0 +1,82 @@
+
+#include "LinkFlavours.h"
+#include "ScriptServices.h"
+
+uint LinkFlavours::current_generation = 1;
+
+
+/* ------------------------------------------------------------------------
+ *  Public interface
+ */
+
+long LinkFlavours::id(const char* name)
+{
+    return lookup(name) -> id;
+}
+
+
+SInterface<IRelation>& LinkFlavours::relation(const char* name)
+{
+    return entry_relation(lookup(name));
+}
+
+
+void LinkFlavours::invalidate()
+{
+    EntryMap& map = entries();
+
+    for(EntryMap::iterator it = map.begin(); it != map.end(); ++it) {
+        delete it -> second -> relation;
+        delete it -> second;
+    }
+    map.clear();
+
+    // Skip 0 on wrap, so that new handles never look current
+    if(!++current_generation)
+        ++current_generation;
+}
+
+
+/* ------------------------------------------------------------------------
+ *  Private members
+ */
+
+LinkFlavours::Entry* LinkFlavours::lookup(const char* name)
+{
+    EntryMap& map = entries();
+
+    EntryMap::iterator it = map.find(name);
+    if(it != map.end())
+        return it -> second;
+
+    SService<ILinkToolsSrv>& LinkToolsSrv = ScriptServices::link_tools();
+
+    Entry* entry = new Entry;
+    entry -> name     = name;
+    entry -> id       = LinkToolsSrv -> LinkKindNamed(name);
+    entry -> relation = NULL;
+
+    // The key must point at the entry's copy of the name, not the caller's
+    map.insert(EntryMap::value_type(entry -> name.c_str(), entry));
+
+    return entry;
+}
+
+
+SInterface<IRelation>& LinkFlavours::entry_relation(Entry* entry)
+{
+    if(!entry -> relation) {
+        SInterface<ILinkManager>& LinkMgr = ScriptServices::link_manager();
+        entry -> relation = new SInterface<IRelation>(LinkMgr -> GetRelationNamed(entry -> name.c_str()));
+    }
+
+    return *entry -> relation;
+}
+
+
+LinkFlavours::EntryMap& LinkFlavours::entries()
+{
+    static EntryMap map;
+
+    return map;
+}
@@ -0,0 +1,164 @@
+/** @file
+ * This file contains the interface for the module-wide link flavour
+ * registry, which resolves link flavour names to flavour IDs and relations
+ * once rather than every time a script needs to walk links.
+ *
+ * @author Chris Page &lt;chris@starforge.co.uk&gt;
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef LINKFLAVOURS_H
+#define LINKFLAVOURS_H
+
+#include <lg/config.h>
+#include <lg/objstd.h>
+#include <lg/interface.h>
+#include <lg/links.h>
+#include <string>
+#include <unordered_map>
+#include "CharHash.h"
+
+/** A cache of link flavour IDs and relations, keyed on flavour name. The
+ *  flavours available depend on the gamesys, so the cache is discarded by
+ *  invalidate() whenever a new mission or saved game may have been loaded.
+ *  Scripts that look up the same flavour repeatedly should hold a
+ *  LinkFlavour handle rather than calling id() or relation() directly, as
+ *  the handle only needs to consult the registry once per mission.
+ */
+class LinkFlavours
+{
+public:
+    /** Obtain the ID of the named link flavour, resolving it through the
+     *  engine if it has not been looked up since the cache was invalidated.
+     *
+     * @param name The name of the link flavour, optionally prefixed with '~'
+     *             to select the reverse flavour.
+     * @return The flavour ID, or 0 if the flavour does not exist.
+     */
+    static long id(const char* name);
+
+
+    /** Obtain the relation for the named link flavour. The relation is held
+     *  by the registry, so callers do not need to release it, but must not
+     *  keep it beyond the current message.
+     *
+     * @param name The name of the link flavour.
+     * @return A reference to the relation for the flavour.
+     */
+    static SInterface<IRelation>& relation(const char* name);
+
+
+    /** Discard all cached flavours, releasing any relations held. This is
+     *  called when the first script is created after all scripts have been
+     *  destroyed (which happens whenever a mission or saved game is loaded),
+     *  and when the sim starts.
+     */
+    static void invalidate();
+
+
+    /** Release all cached flavours. This is called when the last script is
+     *  destroyed, while the engine can still accept the relations back. It
+     *  must not be left to module unload, as the registry's own statics may
+     *  have been destroyed by then.
+     */
+    static void release()
+        { invalidate(); }
+
+
+    /** Obtain the current cache generation. This changes every time the
+     *  cache is invalidated, and is never 0.
+     *
+     * @return The current generation.
+     */
+    static uint generation()
+        { return current_generation; }
+
+private:
+    struct Entry {
+        std::string            name;     //!< The flavour name, also used as the map key.
+        long                   id;       //!< The flavour ID, 0 if the flavour does not exist.
+        SInterface<IRelation>* relation; //!< The relation, NULL until it is first requested.
+    };
+
+    typedef std::unordered_map<const char*, Entry*, char_hash, char_icmp> EntryMap;
+
+    /** Locate the entry for the specified flavour, creating it if needed.
+     */
+    static Entry* lookup(const char* name);
+
+    /** Obtain the relation for the specified entry, fetching it if needed.
+     */
+    static SInterface<IRelation>& entry_relation(Entry* entry);
+
+    static EntryMap& entries();
+
+    static uint current_generation; //!< Incremented to discard all cached flavours.
+
+    friend class LinkFlavour;
+};
+
+
+/** A handle on a link flavour that resolves its ID and relation at most once
+ *  per mission. Handles are intended to be declared as static or member
+ *  variables, eg:
+ *
+ *      static LinkFlavour awareness("AIAwareness");
+ *      link_srv -> GetAll(links, awareness.id(), ObjId(), 0);
+ */
+class LinkFlavour
+{
+public:
+    /** Create a new handle on the named flavour. This does not resolve the
+     *  flavour; that is done when id() or relation() is first called.
+     *
+     * @param flavour The name of the flavour. This must remain valid for the
+     *                life of the handle, so it should usually be a literal.
+     */
+    explicit LinkFlavour(const char* flavour) : name(flavour), entry(NULL), generation(0)
+        { /* fnord */ }
+
+
+    /** Obtain the ID of the flavour.
+     *
+     * @return The flavour ID, or 0 if the flavour does not exist.
+     */
+    long id()
+        { return resolve() -> id; }
+
+
+    /** Obtain the relation for the flavour. See LinkFlavours::relation() for
+     *  the restrictions on its use.
+     *
+     * @return A reference to the relation for the flavour.
+     */
+    SInterface<IRelation>& relation()
+        { return LinkFlavours::entry_relation(resolve()); }
+
+private:
+    LinkFlavours::Entry* resolve()
+    {
+        if(generation != LinkFlavours::current_generation) {
+            entry = LinkFlavours::lookup(name);
+            generation = LinkFlavours::current_generation;
+        }
+        return entry;
+    }
+
+    const char*          name;       //!< The name of the flavour.
+    LinkFlavours::Entry* entry;      //!< The registry entry, valid while generation is current.
+    uint                 generation; //!< The registry generation entry was obtained in.
+};
+
+#endif // LINKFLAVOURS_H
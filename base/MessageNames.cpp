@@ -0,0 +1,98 @@
+
+#include <cstring>
+#include "MessageNames.h"
+
+// Note that this must match the order of the MessageID enum.
+const char* const MessageNames::known_names[] = {
+    "",
+    "Sim", "Timer", "Null", "BeginScript", "EndScript", "DarkGameModeChange",
+    "TurnOn", "TurnOff", "TweqComplete", "Alertness", "ObjRoomTransit",
+    "AIModeChange", "Slain", "IgnorePotion", "QuestChange",
+    "ResetCount", "Despawned", "ResetSpawned", "DumpMemStats",
+    "DelayInit", "StopBreath", "CheckPop", "FixLinks", "CheckLinks", "CheckVis",
+    "CheckVelocity", "CheckOnScreen", "Despawn", "FireShadow", "TWWheelTick",
+    "TWDeferredInit"
+};
+
+
+/* ------------------------------------------------------------------------
+ *  Public interface
+ */
+
+int MessageNames::lookup(const char* name)
+{
+    if(!name) return MSGID_UNKNOWN;
+
+    MessageNames& self = table();
+    IDMap::const_iterator it = self.ids.find(name);
+
+    return (it != self.ids.end()) ? it -> second : static_cast<int>(MSGID_UNKNOWN);
+}
+
+
+int MessageNames::intern(const char* name)
+{
+    if(!name || !*name) return MSGID_UNKNOWN;
+
+    MessageNames& self = table();
+    IDMap::const_iterator it = self.ids.find(name);
+    if(it != self.ids.end())
+        return it -> second;
+
+    // Not seen before, so the table needs its own copy of the name
+    char* copy = new char[strlen(name) + 1];
+    strcpy(copy, name);
+    self.owned.push_back(copy);
+
+    int id = self.names.size();
+    self.names.push_back(copy);
+    self.ids.insert(IDMap::value_type(copy, id));
+
+    return id;
+}
+
+
+const char* MessageNames::name(int id)
+{
+    MessageNames& self = table();
+
+    if(id < 0 || id >= static_cast<int>(self.names.size()))
+        return "";
+
+    return self.names[id];
+}
+
+
+/* ------------------------------------------------------------------------
+ *  Private members
+ */
+
+MessageNames& MessageNames::table()
+{
+    static MessageNames instance;
+
+    return instance;
+}
+
+
+MessageNames::MessageNames()
+{
+    names.reserve(MSGID_DYNAMIC * 2);
+
+    // The names in known_names are literals, so they can be used as keys directly
+    for(int id = 0; id < MSGID_DYNAMIC; ++id) {
+        names.push_back(known_names[id]);
+        if(id != MSGID_UNKNOWN)
+            ids.insert(IDMap::value_type(known_names[id], id));
+    }
+}
+
+
+MessageNames::~MessageNames()
+{
+    std::vector<char*>::iterator it;
+
+    for(it = owned.begin(); it != owned.end(); ++it) {
+        delete[] *it;
+    }
+}
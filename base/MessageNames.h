@@ -0,0 +1,136 @@
+/** @file
+ * This file contains the interface for the module-wide message name table.
+ * Message names are interned into small integer IDs when a message arrives,
+ * so that scripts can dispatch on the ID with a switch rather than walking a
+ * chain of case-insensitive string comparisons.
+ *
+ * @author Chris Page &lt;chris@starforge.co.uk&gt;
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef MESSAGENAMES_H
+#define MESSAGENAMES_H
+
+#include <vector>
+#include <unordered_map>
+#include "CharHash.h"
+
+/** IDs for the message and timer names the scripts in this module know about
+ *  at compile time. Names that are only known at runtime (remapped TurnOn and
+ *  TurnOff messages, for example) are given IDs starting at MSGID_DYNAMIC when
+ *  they are interned. The order of this enum must match the `known_names`
+ *  array in MessageNames.cpp!
+ */
+enum MessageID {
+    MSGID_NONE    = -1,       //!< Never the ID of a message, for names that must never match.
+    MSGID_UNKNOWN = 0,        //!< The name has never been interned.
+
+    // Engine messages
+    MSGID_SIM,
+    MSGID_TIMER,
+    MSGID_NULL,
+    MSGID_BEGINSCRIPT,
+    MSGID_ENDSCRIPT,
+    MSGID_DARKGAMEMODECHANGE,
+    MSGID_TURNON,
+    MSGID_TURNOFF,
+    MSGID_TWEQCOMPLETE,
+    MSGID_ALERTNESS,
+    MSGID_OBJROOMTRANSIT,
+    MSGID_AIMODECHANGE,
+    MSGID_SLAIN,
+    MSGID_IGNOREPOTION,
+    MSGID_QUESTCHANGE,
+
+    // Messages defined by scripts in this module
+    MSGID_RESETCOUNT,
+    MSGID_DESPAWNED,
+    MSGID_RESETSPAWNED,
+    MSGID_DUMPMEMSTATS,
+
+    // Timer names
+    MSGID_DELAYINIT,
+    MSGID_STOPBREATH,
+    MSGID_CHECKPOP,
+    MSGID_FIXLINKS,
+    MSGID_CHECKLINKS,
+    MSGID_CHECKVIS,
+    MSGID_CHECKVELOCITY,
+    MSGID_CHECKONSCREEN,
+    MSGID_DESPAWN,
+    MSGID_FIRESHADOW,
+    MSGID_WHEELTICK,
+    MSGID_DEFERREDINIT,
+
+    MSGID_DYNAMIC             //!< First ID handed out to names interned at runtime.
+};
+
+
+/** The module-wide message name interning table. All scripts in the module
+ *  share a single table, and lookups are case-insensitive to match the way
+ *  the engine treats message names.
+ */
+class MessageNames
+{
+public:
+    /** Obtain the ID of the specified message name, if it has been interned.
+     *  This never adds names to the table, so it is safe to call on every
+     *  message the script receives.
+     *
+     * @param name The message (or timer) name to look up.
+     * @return The ID of the name, or MSGID_UNKNOWN if it has not been interned.
+     */
+    static int lookup(const char* name);
+
+
+    /** Intern the specified message name, returning its ID. If the name has
+     *  not been seen before, it is copied into the table and given a new ID.
+     *  This should be used when a script learns a message name at runtime,
+     *  usually during init().
+     *
+     * @param name The message name to intern.
+     * @return The ID for the name. This will never be MSGID_UNKNOWN unless
+     *         name is NULL or empty.
+     */
+    static int intern(const char* name);
+
+
+    /** Fetch the name corresponding to the specified ID.
+     *
+     * @param id The ID to fetch the name for.
+     * @return A pointer to the name. This must not be freed. If the ID is not
+     *         valid, this returns an empty string.
+     */
+    static const char* name(int id);
+
+private:
+    typedef std::unordered_map<const char*, int, char_hash, char_icmp> IDMap;
+
+    /** Obtain a reference to the shared table, building it on first use.
+     *  This avoids depending on static initialisation order across the module.
+     */
+    static MessageNames& table();
+
+    MessageNames();
+    ~MessageNames();
+
+    IDMap ids;                      //!< Map of names to IDs.
+    std::vector<const char*> names; //!< Names indexed by ID.
+    std::vector<char*> owned;       //!< Copies of names interned at runtime.
+
+    static const char* const known_names[];
+};
+
+#endif // MESSAGENAMES_H
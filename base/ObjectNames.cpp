@@ -0,0 +1,90 @@
+
+#include <lg/interface.h>
+#include <lg/scrmanagers.h>
+#include <lg/objects.h>
+#include "ObjectNames.h"
+#include "ScriptServices.h"
+
+uint ObjectNames::current_generation = 1;
+
+
+/* ------------------------------------------------------------------------
+ *  Public interface
+ */
+
+int ObjectNames::id(const char* name)
+{
+    if(!name || !*name) return 0;
+
+    Entry* entry = find(name);
+    if(entry)
+        return entry -> obj_id;
+
+    return fetch(name, entry);
+}
+
+
+void ObjectNames::invalidate()
+{
+    EntryMap& map = entries();
+
+    for(EntryMap::iterator it = map.begin(); it != map.end(); ++it) {
+        delete it -> second;
+    }
+    map.clear();
+
+    // Skip 0 on wrap, so that new handles never look current
+    if(!++current_generation)
+        ++current_generation;
+}
+
+
+/* ------------------------------------------------------------------------
+ *  Private members
+ */
+
+ObjectNames::Entry* ObjectNames::find(const char* name)
+{
+    EntryMap& map = entries();
+
+    EntryMap::iterator it = map.find(name);
+    return (it != map.end()) ? it -> second : NULL;
+}
+
+
+int ObjectNames::fetch(const char* name, Entry*& entry)
+{
+    int obj_id = named(name);
+
+    // Concrete objects can come and go without the module seeing it, so only
+    // archetypes and metaproperties are kept.
+    if(obj_id >= 0) {
+        entry = NULL;
+        return obj_id;
+    }
+
+    entry = new Entry;
+    entry -> name   = name;
+    entry -> obj_id = obj_id;
+
+    // The key must point at the entry's copy of the name, not the caller's
+    entries().insert(EntryMap::value_type(entry -> name.c_str(), entry));
+
+    return obj_id;
+}
+
+
+int ObjectNames::named(const char* name)
+{
+    SInterface<IObjectSystem>& ObjectSys = ScriptServices::object_system();
+
+    return ObjectSys -> GetObjectNamed(name);
+}
+
+
+ObjectNames::EntryMap& ObjectNames::entries()
+{
+    static EntryMap map;
+
+    return map;
+}
@@ -0,0 +1,137 @@
+/** @file
+ * This file contains the interface for the module-wide object name cache,
+ * which remembers the results of looking up objects by name.
+ *
+ * @author Chris Page &lt;chris@starforge.co.uk&gt;
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef OBJECTNAMES_H
+#define OBJECTNAMES_H
+
+#include <lg/config.h>
+#include <lg/objstd.h>
+#include <string>
+#include <unordered_map>
+#include "CharHash.h"
+
+/** A case-insensitive cache of object name to object ID lookups for names
+ *  that resolve to archetypes or metaproperties.
+ *
+ *  Archetypes and metaproperties can only be created, destroyed, or renamed
+ *  in the editor, so a name that resolved to an archetype stays cached until
+ *  invalidate() is called when the sim starts or a mission or saved game is
+ *  loaded. Concrete objects can be created, destroyed, or renamed at any time
+ *  by the engine, other script modules, or editor commands, without this
+ *  module being told, so names that resolve to a concrete object, or to
+ *  nothing, are looked up through the engine every time.
+ *
+ *  Scripts that look up the same name repeatedly should hold a NamedObject
+ *  handle rather than calling id() directly.
+ */
+class ObjectNames
+{
+public:
+    /** Obtain the ID of the object with the specified name.
+     *
+     * @param name The name of the object to look up.
+     * @return The ID of the object, or 0 if there is no object with that name.
+     */
+    static int id(const char* name);
+
+
+    /** Discard all cached names.
+     */
+    static void invalidate();
+
+private:
+    struct Entry {
+        std::string name;   //!< The object name, also used as the map key.
+        int         obj_id; //!< The archetype the name resolved to.
+    };
+
+    typedef std::unordered_map<const char*, Entry*, char_hash, char_icmp> EntryMap;
+
+    /** Locate the entry for the specified name, or NULL if it is not cached.
+     */
+    static Entry* find(const char* name);
+
+    /** Look the name up through the engine, caching it if it names an
+     *  archetype.
+     *
+     * @param name  The name of the object to look up.
+     * @param entry Set to the new entry if the name was cached, NULL otherwise.
+     * @return The ID of the object, or 0 if there is no object with that name.
+     */
+    static int fetch(const char* name, Entry*& entry);
+
+    /** Look the name up through the engine, without caching it.
+     */
+    static int named(const char* name);
+
+    static EntryMap& entries();
+
+    static uint current_generation; //!< Incremented to discard all cached names.
+
+    friend class NamedObject;
+};
+
+
+/** A handle on a named object that skips the name cache's hash lookup
+ *  after the first call. Handles are intended to be declared as static or
+ *  member variables, eg:
+ *
+ *      static NamedObject knockedout("M-KnockedOut");
+ *      ObjectSrv -> HasMetaProperty(just_resting, ObjId(), knockedout.id());
+ */
+class NamedObject
+{
+public:
+    /** Create a new handle on the named object. This does not look up the
+     *  object; that is done when id() is first called.
+     *
+     * @param object_name The name of the object. This must remain valid for the
+     *                    life of the handle, so it should usually be a literal.
+     */
+    explicit NamedObject(const char* object_name) : name(object_name), entry(NULL), generation(0)
+        { /* fnord */ }
+
+
+    /** Obtain the ID of the object.
+     *
+     * @return The ID of the object, or 0 if there is no object with the name.
+     */
+    int id()
+    {
+        if(generation != ObjectNames::current_generation) {
+            generation = ObjectNames::current_generation;
+
+            entry = ObjectNames::find(name);
+            if(!entry)
+                return ObjectNames::fetch(name, entry);
+        }
+
+        // A name that is not an archetype won't become one until the cache
+        // is invalidated, so it can go straight to the engine.
+        return entry ? entry -> obj_id : ObjectNames::named(name);
+    }
+
+private:
+    const char*          name;       //!< The name of the object.
+    ObjectNames::Entry*  entry;      //!< The cache entry, or NULL if the name is not an archetype. Valid while generation is current.
+    uint                 generation; //!< The cache generation entry was obtained in.
+};
+
+#endif // OBJECTNAMES_H
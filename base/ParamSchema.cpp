@@ -0,0 +1,320 @@
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>    // std::min
+#include "ParamSchema.h"
+#include "DesignNote.h"
+
+/** The names of the parameter types, as used in the documentation.
+ */
+static const char* const type_names[] = { "boolean", "integer", "float", "time", "string", "float vector" };
+
+
+/** Calculate the case-insensitive edit distance between two names, giving up
+ *  once it exceeds the limit.
+ */
+static size_t name_distance(const char* a, size_t alen, const char* b, size_t blen, size_t limit)
+{
+    if((alen > blen ? alen - blen : blen - alen) > limit)
+        return limit + 1;
+
+    // Parameter names are short, so a single row is plenty
+    std::vector<size_t> row(blen + 1);
+    for(size_t j = 0; j <= blen; ++j) row[j] = j;
+
+    for(size_t i = 1; i <= alen; ++i) {
+        size_t diag = row[0];
+        row[0] = i;
+
+        for(size_t j = 1; j <= blen; ++j) {
+            size_t above = row[j];
+            size_t cost  = (tolower(static_cast<unsigned char>(a[i - 1])) == tolower(static_cast<unsigned char>(b[j - 1]))) ? 0 : 1;
+
+            row[j] = std::min(std::min(row[j] + 1, row[j - 1] + 1), diag + cost);
+            diag = above;
+        }
+    }
+
+    return row[blen];
+}
+
+
+/* ------------------------------------------------------------------------
+ *  Public interface
+ */
+
+uint64_t ParamSchema::bind(const char* script, int host, const char* note, void* dest, std::vector<std::string>* problems) const
+{
+    uint64_t found = 0;
+    size_t   script_len = strlen(script);
+    std::string value;
+
+    // Defaults go in first, so QVar expressions evaluated once have them to
+    // fall back on.
+    for(size_t pos = 0; pos < count; ++pos) {
+        const ParamDesc& desc = params[pos];
+
+        if(desc.field && desc.def_val)
+            parse(desc, desc.def_val, true, host, dest);
+    }
+
+    if(note) {
+        const DesignNote& index = DesignNote::index(note);
+
+        for(size_t pos = 0; pos < index.size(); ++pos) {
+            const DesignNote::Key& key = index.key(pos);
+            const char* name = index.name(key);
+
+            // Parameters for other scripts are none of this one's business
+            if(key.length <= script_len || ::_strnicmp(name, script, script_len))
+                continue;
+
+            name += script_len;
+            size_t length = key.length - script_len;
+
+            const ParamDesc* desc = lookup(name, length);
+            if(!desc) {
+                if(problems) {
+                    std::string problem = "unknown parameter '" + std::string(script) + std::string(name, length) + "'";
+
+                    const ParamDesc* guess = closest(name, length);
+                    if(guess) problem += ", did you mean '" + std::string(script) + guess -> name + "'?";
+
+                    problems -> push_back(problem);
+                }
+                continue;
+            }
+
+            // Parameters read elsewhere, and those in the parent schemas, are
+            // only here to be recognised.
+            if(!desc -> field || desc < params || desc >= params + count)
+                continue;
+
+            // As with the engine, the first setting of a parameter wins
+            uint64_t bit = 1ULL << (desc - params);
+            if(found & bit)
+                continue;
+
+            bool has_value = index.value(key, value);
+            if(parse(*desc, value.c_str(), has_value, host, dest)) {
+                found |= bit;
+            } else if(problems) {
+                problems -> push_back("unable to use '" + value + "' as the value of '" + std::string(script) + desc -> name + "'");
+            }
+        }
+    }
+
+    return found;
+}
+
+
+uint64_t ParamSchema::bit(const char* name) const
+{
+    for(size_t pos = 0; pos < count; ++pos) {
+        if(!::_stricmp(params[pos].name, name))
+            return 1ULL << pos;
+    }
+
+    return 0;
+}
+
+
+void ParamSchema::describe(const char* script, std::string& out) const
+{
+    for(const ParamSchema* schema = this; schema; schema = schema -> parent) {
+        for(const ParamDesc* desc = schema -> params; desc != schema -> params + schema -> count; ++desc) {
+            out += script;
+            out += desc -> name;
+
+            if(!desc -> field) {
+                out += ": read separately\n";
+                continue;
+            }
+
+            out += ": ";
+            out += type_names[desc -> type];
+            if(desc -> units) {
+                out += " (";
+                out += desc -> units;
+                out += ")";
+            }
+            out += ", default: ";
+            out += desc -> def_val ? desc -> def_val : "none";
+            if(desc -> qvar) {
+                out += ", may be a QVar";
+            } else if(desc -> type == PT_INT || desc -> type == PT_FLOAT || desc -> type == PT_TIME) {
+                out += ", may be a QVar (read once)";
+            }
+            out += "\n";
+        }
+    }
+}
+
+
+/* ------------------------------------------------------------------------
+ *  Private members
+ */
+
+const ParamDesc* ParamSchema::lookup(const char* name, size_t length) const
+{
+    for(const ParamSchema* schema = this; schema; schema = schema -> parent) {
+        for(const ParamDesc* desc = schema -> params; desc != schema -> params + schema -> count; ++desc) {
+            if(strlen(desc -> name) == length && !::_strnicmp(desc -> name, name, length))
+                return desc;
+        }
+    }
+
+    return NULL;
+}
+
+
+const ParamDesc* ParamSchema::closest(const char* name, size_t length) const
+{
+    // Anything further away than this is probably not a misspelling
+    size_t best_distance = (length < 6) ? 1 : 2;
+    const ParamDesc* best = NULL;
+
+    for(const ParamSchema* schema = this; schema; schema = schema -> parent) {
+        for(const ParamDesc* desc = schema -> params; desc != schema -> params + schema -> count; ++desc) {
+            size_t distance = name_distance(name, length, desc -> name, strlen(desc -> name), best_distance);
+
+            if(distance < best_distance || (!best && distance == best_distance)) {
+                best = desc;
+                best_distance = distance;
+            }
+        }
+    }
+
+    return best;
+}
+
+
+bool ParamSchema::parse(const ParamDesc& desc, const char* value, bool has_value, int host, void* dest)
+{
+    void* field = desc.field(dest);
+
+    while(isspace(static_cast<unsigned char>(*value))) ++value;
+
+    // QVar expressions are compiled once. Parameters that follow QVars are
+    // bound to the host object, and the rest just take the current value.
+    if(*value == '$' && desc.type != PT_STRING) {
+        std::string qvar_str = &value[1];
+        const QVarExpr& expr = QVarExpr::compiled(qvar_str);
+
+        switch(desc.type) {
+            case PT_INT:
+            case PT_TIME:
+                if(desc.qvar) {
+                    QVarParam<int>* param = static_cast<QVarParam<int>*>(field);
+                    param -> bind(expr.evaluate(int(*param), host), qvar_str, host);
+                } else {
+                    int* param = static_cast<int*>(field);
+                    *param = expr.evaluate(*param, host);
+                }
+                return true;
+
+            case PT_FLOAT:
+                if(desc.qvar) {
+                    QVarParam<float>* param = static_cast<QVarParam<float>*>(field);
+                    param -> bind(expr.evaluate(float(*param), host), qvar_str, host);
+                } else {
+                    float* param = static_cast<float*>(field);
+                    *param = expr.evaluate(*param, host);
+                }
+                return true;
+
+            default:
+                return false;
+        }
+    }
+
+    char* end;
+
+    switch(desc.type) {
+        case PT_BOOL: {
+            bool result;
+
+            if(!has_value || !*value) {
+                result = true;
+            } else if(strchr("tTyY", *value)) {
+                result = true;
+            } else if(strchr("fFnN", *value)) {
+                result = false;
+            } else {
+                result = strtol(value, &end, 10) != 0;
+                if(end == value) return false;
+            }
+
+            *static_cast<bool*>(field) = result;
+            break;
+        }
+
+        case PT_INT: {
+            int result = strtol(value, &end, 10);
+            if(end == value) return false;
+
+            if(desc.qvar) {
+                static_cast<QVarParam<int>*>(field) -> bind(result, std::string(), host);
+            } else {
+                *static_cast<int*>(field) = result;
+            }
+            break;
+        }
+
+        case PT_FLOAT: {
+            float result = strtof(value, &end);
+            if(end == value) return false;
+
+            if(desc.qvar) {
+                static_cast<QVarParam<float>*>(field) -> bind(result, std::string(), host);
+            } else {
+                *static_cast<float*>(field) = result;
+            }
+            break;
+        }
+
+        case PT_TIME: {
+            // Fractional seconds or minutes may be given, so work in float
+            float result = strtof(value, &end);
+            if(end == value) return false;
+
+            switch(*end) {
+                // 's' indicates the time is in seconds, multiply up to milliseconds
+                case 's': result *= 1000.0f; break;
+
+                // 'm' indicates the time is in minutes, multiply up to milliseconds
+                case 'm': result *= 60000.0f; break;
+            }
+
+            if(desc.qvar) {
+                static_cast<QVarParam<int>*>(field) -> bind(int(result), std::string(), host);
+            } else {
+                *static_cast<int*>(field) = int(result);
+            }
+            break;
+        }
+
+        case PT_STRING:
+            *static_cast<IString*>(field) = IString(value);
+            break;
+
+        case PT_VECTOR: {
+            // Components that are missing or can't be parsed keep their default
+            // values, which bind() has already stored.
+            cScrVec* vec = static_cast<cScrVec*>(field);
+            float* components[3] = { &vec -> x, &vec -> y, &vec -> z };
+
+            for(int comp = 0; comp < 3 && *value; ++comp) {
+                float result = strtof(value, &end);
+                if(end != value) *components[comp] = result;
+
+                value = strchr(value, ',');
+                if(!value) break;
+                ++value;
+            }
+            break;
+        }
+    }
+
+    return true;
+}
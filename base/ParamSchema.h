@@ -0,0 +1,199 @@
+/** @file
+ * This file contains the interface for parameter schemas, which let scripts
+ * describe the parameters they read from design notes in one place, and
+ * read them all in a single pass over the note.
+ *
+ * @author Chris Page &lt;chris@starforge.co.uk&gt;
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef PARAMSCHEMA_H
+#define PARAMSCHEMA_H
+
+#include <lg/config.h>
+#include <lg/objstd.h>
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "IString.h"
+#include "QVarParam.h"
+
+/** The types of value a parameter may hold.
+ */
+enum ParamType {
+    PT_BOOL,   //!< true/false, yes/no, or a number. A parameter with no value is true.
+    PT_INT,    //!< An integer.
+    PT_FLOAT,  //!< A floating point number.
+    PT_TIME,   //!< A time in milliseconds, or in seconds or minutes with an s or m suffix.
+    PT_STRING, //!< Arbitrary text.
+    PT_VECTOR, //!< Three comma-separated floating point numbers.
+};
+
+
+/** The type of the field a parameter is stored in. Parameters that may be
+ *  read from QVars are stored in QVarParams, so that they can follow the
+ *  QVars' values.
+ */
+template <ParamType type, bool qvar> struct ParamField;
+template <> struct ParamField<PT_BOOL,   false> { typedef bool             type; };
+template <> struct ParamField<PT_INT,    false> { typedef int              type; };
+template <> struct ParamField<PT_INT,    true>  { typedef QVarParam<int>   type; };
+template <> struct ParamField<PT_FLOAT,  false> { typedef float            type; };
+template <> struct ParamField<PT_FLOAT,  true>  { typedef QVarParam<float> type; };
+template <> struct ParamField<PT_TIME,   false> { typedef int              type; };
+template <> struct ParamField<PT_TIME,   true>  { typedef QVarParam<int>   type; };
+template <> struct ParamField<PT_STRING, false> { typedef IString          type; };
+template <> struct ParamField<PT_VECTOR, false> { typedef cScrVec          type; };
+
+
+/** The description of a single parameter. These should be created with the
+ *  PARAM or PARAM_KNOWN macros, rather than filled in by hand. Parameters
+ *  described with PARAM_KNOWN only have a name: their type and default are
+ *  defined by the code that reads them.
+ */
+struct ParamDesc {
+    const char* name;             //!< The name of the parameter, without the script name.
+    ParamType   type;             //!< The type of the parameter.
+    const char* def_val;          //!< The default value, as it would be written in a design note.
+    const char* units;            //!< The units of the value, for documentation, or NULL.
+    bool        qvar;             //!< Should the value follow a QVar expression? If not, expressions are evaluated once.
+    void*       (*field)(void*);  //!< Locates the field for the parameter in a settings struct, or NULL.
+};
+
+
+/** Describe a parameter that is stored in a field of a settings struct. The
+ *  type of the field is checked against the type of the parameter when the
+ *  schema is compiled.
+ *
+ * @param Struct  The type of the settings struct.
+ * @param Field   The field of the struct to store the value in.
+ * @param Name    The name of the parameter, without the script name.
+ * @param Type    The ParamType of the parameter.
+ * @param Default The default value, as a string, or NULL to leave the field alone.
+ * @param Units   The units of the value, or NULL.
+ * @param QVar    true if the value should follow a QVar expression as the
+ *                QVars change, false if it should be evaluated only once.
+ */
+#define PARAM(Struct, Field, Name, Type, Default, Units, QVar) \
+    { Name, Type, Default, Units, QVar, \
+      [](void* dest) -> void* { ParamField<Type, QVar>::type* field = &static_cast<Struct*>(dest) -> Field; return field; } }
+
+
+/** Describe a parameter that is read by other code, such as a base class or
+ *  a script that needs to handle it specially. This stops the parameter
+ *  being reported as unknown. Only the name is recorded, so that the type
+ *  and default stay with the code that reads the parameter.
+ */
+#define PARAM_KNOWN(Name) \
+    { Name, PT_STRING, NULL, NULL, false, NULL }
+
+
+/** A set of parameters read by a script. Scripts declare a static array of
+ *  ParamDescs describing their parameters, and a static ParamSchema over it,
+ *  eg:
+ *
+ *      static const ParamDesc foo_params[] = {
+ *          PARAM(FooConfig, delay, "Delay", PT_TIME,   "250",  "ms", false),
+ *          PARAM(FooConfig, sfx,   "SFX",   PT_STRING, "Puff", NULL, false),
+ *          PARAM_KNOWN("InCold"),
+ *      };
+ *      static const ParamSchema foo_schema(foo_params, &TWBaseTrap::param_schema);
+ *
+ *  and then fill their settings with bind() in init(). bind() walks the
+ *  design note once, rather than searching it for each parameter, and notes
+ *  any parameter for the script that the schema does not describe, as these
+ *  are usually misspellings. The parent schema describes the parameters
+ *  read by the script's base class, which are also known to the script.
+ */
+class ParamSchema
+{
+public:
+    static const size_t MAX_PARAMS = 64; //!< The most parameters a single schema may describe.
+
+    /** Create a schema over an array of parameter descriptions. This does
+     *  nothing but store pointers, so schemas can safely refer to schemas
+     *  defined in other files as their parents.
+     *
+     * @param descs The parameters read by the script.
+     * @param base  The schema for the parameters read by the script's base
+     *              class, or NULL if there is none.
+     */
+    template <size_t N>
+    constexpr ParamSchema(const ParamDesc (&descs)[N], const ParamSchema* base = NULL) : params(descs), count(N), parent(base)
+        { static_assert(N <= MAX_PARAMS, "Too many parameters in schema"); }
+
+
+    /** Fill in a settings struct from a design note. Parameters the note does
+     *  not set are given their default value. Parameters that follow QVars
+     *  are bound to the specified host, so the struct must only be used by
+     *  that object's script; structs shared between objects must not contain
+     *  any. Numeric parameters that do not follow QVars may still be set to
+     *  a QVar expression: it is evaluated once, here, with the parameter's
+     *  default (or the field's current value, if it has none) used in place
+     *  of missing QVars.
+     *
+     * @param script   The name of the script the parameters are for.
+     * @param host     The ID of the object the script is on.
+     * @param note     The design note to read. May be NULL, in which case
+     *                 all the parameters are given their defaults.
+     * @param dest     The settings struct described by this schema.
+     * @param problems If not NULL, a description of each parameter in the
+     *                 note that the schema does not know about, or whose
+     *                 value could not be used, is added to this vector.
+     * @return A mask with bit N set if the note set the value of the Nth
+     *         parameter in the schema.
+     */
+    uint64_t bind(const char* script, int host, const char* note, void* dest, std::vector<std::string>* problems = NULL) const;
+
+
+    /** Obtain the bit for a parameter in the masks returned by bind().
+     *
+     * @param name The name of the parameter, without the script name.
+     * @return The bit for the parameter, or 0 if it is not described by this
+     *         schema. Parameters in the parent schemas have no bit.
+     */
+    uint64_t bit(const char* name) const;
+
+
+    /** Write a description of the parameters in the schema and its parents,
+     *  one per line, in the form used in the script documentation.
+     *
+     * @param script The name of the script the parameters are for.
+     * @param out    The string to append the description to.
+     */
+    void describe(const char* script, std::string& out) const;
+
+private:
+    /** Locate the description of a parameter in this schema or its parents.
+     */
+    const ParamDesc* lookup(const char* name, size_t length) const;
+
+    /** Locate the parameter in this schema or its parents with the name
+     *  closest to the one given, if any is close enough to be a likely
+     *  misspelling of it.
+     */
+    const ParamDesc* closest(const char* name, size_t length) const;
+
+    /** Store a parameter value in the field for it.
+     */
+    static bool parse(const ParamDesc& desc, const char* value, bool has_value, int host, void* dest);
+
+    const ParamDesc*   params; //!< The parameters in the schema.
+    size_t             count;  //!< The number of parameters.
+    const ParamSchema* parent; //!< The schema for the base class' parameters, or NULL.
+};
+
+#endif // PARAMSCHEMA_H
@@ -0,0 +1,363 @@
+
+#include <lg/interface.h>
+#include <lg/scrmanagers.h>
+#include <lg/scrservices.h>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+#include "QVarExpr.h"
+#include "QVarShadow.h"
+
+// Characters that can never appear in a QVar name in an expression
+static const char* const NAME_DELIMITERS = "+*/(),$";
+
+static const char* skip_space(const char* pos)
+{
+    while(*pos && isspace(static_cast<unsigned char>(*pos))) ++pos;
+    return pos;
+}
+
+static bool is_name_char(char chr)
+{
+    return chr && !isspace(static_cast<unsigned char>(chr)) && !strchr(NAME_DELIMITERS, chr);
+}
+
+static inline int   constant(int,   int ival, float)      { return ival; }
+static inline float constant(float, int,      float fval) { return fval; }
+
+
+/* ------------------------------------------------------------------------
+ *  Public interface
+ */
+
+bool QVarExpr::compile(const char* text)
+{
+    program.clear();
+    names.clear();
+    depth = 0;
+    leading_qvar = false;
+    single_op = false;
+
+    if(!text) return false;
+
+    const char* pos = text;
+    uint stack = 0;
+
+    if(parse_expr(pos, stack) && !*skip_space(pos)) {
+        // The first op is the leftmost operand, which leads if the text starts with it
+        if(program[0].code == OP_QVAR) {
+            const char* start = skip_space(text);
+            if(*start == '$') ++start;
+
+            size_t len = strlen(names.c_str());
+            leading_qvar = !strncmp(start, names.c_str(), len) && !is_name_char(start[len]);
+        }
+
+        // The original syntax only allowed `qvar op value`, and ignored a right
+        // hand side that was zero, or that was neither a number nor a QVar.
+        if(leading_qvar && program.size() == 3 && program[2].code >= OP_ADD && program[2].code <= OP_DIV) {
+            single_op = true;
+
+            if(program[1].code == OP_QVAR && program[1].bare) {
+                program[1].code = OP_NUMBER;
+                program[1].ival = 0;
+                program[1].fval = 0.0f;
+            }
+        }
+        return true;
+    }
+
+    // Fall back on reading the QVar named before the first operator, as the
+    // original single-operator parser did.
+    program.clear();
+    names.clear();
+    depth = 0;
+
+    pos = skip_space(text);
+    while(*pos == '$') pos = skip_space(pos + 1);
+
+    const char* end = pos;
+    while(*end && *end != '+' && *end != '*' && *end != '/') ++end;
+    while(end > pos && isspace(static_cast<unsigned char>(end[-1]))) --end;
+
+    if(end > pos) {
+        stack = 0;
+        emit_qvar(pos, end, stack);
+        leading_qvar = true;
+    }
+
+    return false;
+}
+
+
+int QVarExpr::evaluate(int def_val, int host) const
+{
+    return run<int>(def_val, host);
+}
+
+
+float QVarExpr::evaluate(float def_val, int host) const
+{
+    return run<float>(def_val, host);
+}
+
+
+const QVarExpr& QVarExpr::compiled(const std::string& text)
+{
+    static std::unordered_map<std::string, QVarExpr> cache;
+
+    std::unordered_map<std::string, QVarExpr>::iterator it = cache.find(text);
+    if(it == cache.end()) {
+        it = cache.insert(std::make_pair(text, QVarExpr())).first;
+        it -> second.compile(text.c_str());
+    }
+
+    return it -> second;
+}
+
+
+/* ------------------------------------------------------------------------
+ *  Evaluation
+ */
+
+template <typename T>
+T QVarExpr::run(T def_val, int host) const
+{
+    if(program.empty()) return def_val;
+
+    // Compilation guarantees the program never needs more than MAX_DEPTH entries
+    T stack[MAX_DEPTH];
+    uint top = 0;
+
+    for(std::vector<Op>::const_iterator op = program.begin(); op != program.end(); ++op) {
+        switch(op -> code) {
+            case OP_NUMBER: stack[top++] = constant(def_val, op -> ival, op -> fval);
+                break;
+
+            case OP_QVAR: {
+                    int value;
+
+                    if(QVarShadow::get(names.c_str() + op -> name, host, value)) {
+                        stack[top++] = static_cast<T>(value);
+
+                    // A missing leading QVar is replaced by the default, which the
+                    // rest of the expression is applied to as usual
+                    } else if(leading_qvar && op == program.begin()) {
+                        stack[top++] = def_val;
+
+                    // Any other missing QVar leaves the operation it is used in unchanged
+                    } else {
+                        stack[top++] = constant(def_val, op -> ival, op -> fval);
+                    }
+                }
+                break;
+
+            case OP_ADD: --top; if(!single_op || stack[top]) stack[top - 1] += stack[top];
+                break;
+
+            case OP_SUB: --top; if(!single_op || stack[top]) stack[top - 1] -= stack[top];
+                break;
+
+            case OP_MUL: --top; if(!single_op || stack[top]) stack[top - 1] *= stack[top];
+                break;
+
+            case OP_DIV: --top; if(stack[top]) stack[top - 1] /= stack[top];
+                break;
+
+            case OP_MIN: --top; if(stack[top] < stack[top - 1]) stack[top - 1] = stack[top];
+                break;
+
+            case OP_MAX: --top; if(stack[top] > stack[top - 1]) stack[top - 1] = stack[top];
+                break;
+
+            case OP_CLAMP: top -= 2;
+                if(stack[top - 1] > stack[top + 1]) stack[top - 1] = stack[top + 1];
+                if(stack[top - 1] < stack[top])     stack[top - 1] = stack[top];
+                break;
+        }
+    }
+
+    return stack[0];
+}
+
+
+/* ------------------------------------------------------------------------
+ *  Parsing
+ */
+
+bool QVarExpr::parse_expr(const char*& pos, uint& stack)
+{
+    if(!parse_term(pos, stack)) return false;
+
+    for(;;) {
+        bool spaced = isspace(static_cast<unsigned char>(*pos));
+        pos = skip_space(pos);
+
+        if(*pos == '+') {
+            ++pos;
+            if(!parse_term(pos, stack)) return false;
+            emit(OP_ADD, stack, 2);
+
+        // '-' may be part of a QVar name, so it is only an operator between spaces
+        } else if(*pos == '-' && spaced && isspace(static_cast<unsigned char>(pos[1]))) {
+            ++pos;
+            if(!parse_term(pos, stack)) return false;
+            emit(OP_SUB, stack, 2);
+
+        } else {
+            return true;
+        }
+    }
+}
+
+
+bool QVarExpr::parse_term(const char*& pos, uint& stack)
+{
+    if(!parse_operand(pos, stack)) return false;
+
+    for(;;) {
+        const char* next = skip_space(pos);
+
+        if(*next == '*' || *next == '/') {
+            pos = next + 1;
+            if(!parse_operand(pos, stack)) return false;
+
+            // Multiplying or dividing by a missing QVar does nothing, as in the
+            // original single-operator syntax
+            if(program.back().code == OP_QVAR) {
+                program.back().ival = 1;
+                program.back().fval = 1.0f;
+            }
+
+            emit(*next == '*' ? OP_MUL : OP_DIV, stack, 2);
+
+        } else {
+            return true;
+        }
+    }
+}
+
+
+bool QVarExpr::parse_operand(const char*& pos, uint& stack)
+{
+    pos = skip_space(pos);
+
+    // Parenthesised subexpression
+    if(*pos == '(') {
+        ++pos;
+        if(!parse_expr(pos, stack)) return false;
+
+        pos = skip_space(pos);
+        if(*pos != ')') return false;
+        ++pos;
+
+    // Numeric constant, possibly signed
+    } else if(isdigit(static_cast<unsigned char>(*pos)) || *pos == '.' ||
+              ((*pos == '-' || *pos == '+') && (isdigit(static_cast<unsigned char>(pos[1])) || pos[1] == '.'))) {
+        char* end;
+        Op op;
+        op.code = OP_NUMBER;
+        op.ival = strtol(pos, NULL, 10);
+        op.fval = strtof(pos, &end);
+        op.name = 0;
+        op.bare = false;
+
+        if(end == pos) return false;
+        pos = end;
+
+        program.push_back(op);
+        grow(stack);
+
+    // QVar name, or function call
+    } else {
+        bool dollar = (*pos == '$');
+        if(dollar) ++pos;
+
+        const char* start = pos;
+        while(is_name_char(*pos)) ++pos;
+        if(pos == start) return false;
+
+        const char* after = skip_space(pos);
+        if(!dollar && *after == '(') {
+            size_t len = pos - start;
+            pos = after + 1;
+
+            if(len == 3 && !strncasecmp(start, "min", 3))   return parse_call(pos, stack, OP_MIN, 2);
+            if(len == 3 && !strncasecmp(start, "max", 3))   return parse_call(pos, stack, OP_MAX, 2);
+            if(len == 5 && !strncasecmp(start, "clamp", 5)) return parse_call(pos, stack, OP_CLAMP, 3);
+
+            return false;
+        }
+
+        emit_qvar(start, pos, stack, !dollar);
+    }
+
+    return stack <= MAX_DEPTH;
+}
+
+
+bool QVarExpr::parse_call(const char*& pos, uint& stack, OpCode code, uint args)
+{
+    for(uint arg = 0; arg < args; ++arg) {
+        if(arg) {
+            pos = skip_space(pos);
+            if(*pos != ',') return false;
+            ++pos;
+        }
+
+        if(!parse_expr(pos, stack)) return false;
+    }
+
+    pos = skip_space(pos);
+    if(*pos != ')') return false;
+    ++pos;
+
+    emit(code, stack, args);
+
+    return stack <= MAX_DEPTH;
+}
+
+
+/* ------------------------------------------------------------------------
+ *  Code generation
+ */
+
+void QVarExpr::emit(OpCode code, uint& stack, uint pops)
+{
+    Op op;
+    op.code = code;
+    op.ival = 0;
+    op.fval = 0.0f;
+    op.name = 0;
+    op.bare = false;
+    program.push_back(op);
+
+    // Operators replace their operands with the result
+    stack -= pops;
+    grow(stack);
+}
+
+
+void QVarExpr::grow(uint& stack)
+{
+    ++stack;
+    if(stack > depth) depth = stack;
+}
+
+
+void QVarExpr::emit_qvar(const char* start, const char* end, uint& stack, bool bare)
+{
+    Op op;
+    op.code = OP_QVAR;
+    op.ival = 0;
+    op.fval = 0.0f;
+    op.name = names.size();
+    op.bare = bare;
+
+    names.append(start, end - start);
+    names.push_back('\0');
+
+    program.push_back(op);
+    grow(stack);
+}
@@ -0,0 +1,162 @@
+/** @file
+ * This file contains the interface for compiled QVar expressions, which
+ * allow design note values to be calculated from quest variables.
+ *
+ * @author Chris Page &lt;chris@starforge.co.uk&gt;
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef QVAREXPR_H
+#define QVAREXPR_H
+
+#include <lg/config.h>
+#include <lg/objstd.h>
+#include <string>
+#include <vector>
+
+/** A QVar expression compiled into a short postfix program. Compiling an
+ *  expression does all the parsing and allocation up front, so evaluating
+ *  it only has to fetch the QVars it uses and do the arithmetic.
+ *
+ *  Expressions have the form
+ *
+ *      expr    := term (('+' | ' - ') term)*
+ *      term    := operand (('*' | '/') operand)*
+ *      operand := number | ['$']qvarname | '(' expr ')'
+ *               | min(expr, expr) | max(expr, expr) | clamp(expr, low, high)
+ *
+ *  Multiplication and division bind more tightly than addition and
+ *  subtraction. QVar names may contain '-', so subtraction is only
+ *  recognised when the '-' has spaces on both sides, eg: `foo - 2`, and
+ *  never in `foo-2`. The '$' before a QVar name is optional.
+ *
+ *  For compatibility with the original single-operator syntax, if the
+ *  expression starts with a QVar and that QVar does not exist, the default
+ *  value is used in its place, and the rest of the expression is applied to
+ *  it, so `$missing * 2` with a default of 3 gives 6. A QVar that does not
+ *  exist immediately after '*' or '/' counts as 1, and anywhere else as 0,
+ *  so `foo * $missing` and `foo + $missing` both give foo. Division by zero
+ *  leaves the left hand side unchanged.
+ *
+ *  An expression in the original single-operator form, a QVar, an operator,
+ *  and a number or QVar, behaves exactly as it always has: a right hand
+ *  side that is zero, whether a literal or a QVar, leaves the QVar
+ *  unchanged, so `foo * 0` and `foo * $zero` both give foo, and a right hand
+ *  side written without a '$' that is not a number is ignored. In longer
+ *  expressions, zeros are used like any other value, and names without a
+ *  '$' are QVars, so `foo * 0 + 1` gives 1.
+ *
+ *  Expressions that can not be compiled fall back to the original behaviour
+ *  of reading the QVar named before the first operator.
+ */
+class QVarExpr
+{
+public:
+    QVarExpr() : program(), names(), depth(0), leading_qvar(false), single_op(false)
+        { /* fnord */ }
+
+
+    /** Compile the specified expression, replacing any previously compiled
+     *  expression.
+     *
+     * @param text The expression to compile.
+     * @return true if the expression was compiled, false if it could not be
+     *         parsed and the fallback has been used instead.
+     */
+    bool compile(const char* text);
+
+
+    /** Evaluate the expression using integer arithmetic.
+     *
+     * @param def_val The value to use in place of the leading QVar if it does
+     *                not exist.
+     * @param host    The ID of the object to subscribe to changes in the QVars
+     *                used, see QVarShadow::get().
+     * @return The value of the expression.
+     */
+    int evaluate(int def_val, int host = 0) const;
+
+
+    /** Evaluate the expression using floating point arithmetic.
+     *
+     * @param def_val The value to use in place of the leading QVar if it does
+     *                not exist.
+     * @param host    The ID of the object to subscribe to changes in the QVars
+     *                used, see QVarShadow::get().
+     * @return The value of the expression.
+     */
+    float evaluate(float def_val, int host = 0) const;
+
+
+    /** Determine whether anything has been compiled into the expression.
+     *
+     * @return true if the expression is empty, false otherwise.
+     */
+    bool empty() const
+        { return program.empty(); }
+
+
+    /** Obtain a reference to the compiled form of the specified expression.
+     *  Expressions are compiled the first time they are seen, and kept for
+     *  the life of the module.
+     *
+     * @param text The expression to look up.
+     * @return A reference to the compiled expression.
+     */
+    static const QVarExpr& compiled(const std::string& text);
+
+private:
+    enum OpCode {
+        OP_NUMBER, //!< Push a constant.
+        OP_QVAR,   //!< Push the value of a QVar.
+        OP_ADD,
+        OP_SUB,
+        OP_MUL,
+        OP_DIV,
+        OP_MIN,
+        OP_MAX,
+        OP_CLAMP
+    };
+
+    struct Op {
+        OpCode code;
+        int    ival;  //!< The constant for OP_NUMBER, or the value of a missing QVar for OP_QVAR, in integer expressions.
+        float  fval;  //!< The constant for OP_NUMBER, or the value of a missing QVar for OP_QVAR, in float expressions.
+        uint   name;  //!< The offset of the QVar name in names, for OP_QVAR.
+        bool   bare;  //!< Was the QVar name written without a '$', for OP_QVAR?
+    };
+
+    template <typename T> T run(T def_val, int host) const;
+
+    // Recursive descent parser. Each function returns false on a syntax error.
+    bool parse_expr(const char*& pos, uint& stack);
+    bool parse_term(const char*& pos, uint& stack);
+    bool parse_operand(const char*& pos, uint& stack);
+    bool parse_call(const char*& pos, uint& stack, OpCode code, uint args);
+
+    void emit(OpCode code, uint& stack, uint pops);
+    void emit_qvar(const char* start, const char* end, uint& stack, bool bare = false);
+    void grow(uint& stack);
+
+    static const uint MAX_DEPTH = 16; //!< The deepest evaluation stack an expression may need.
+
+    std::vector<Op> program; //!< The compiled program, in postfix order.
+    std::string names;       //!< The QVar names used by the program, each nul terminated.
+    uint depth;              //!< The deepest the evaluation stack gets.
+    bool leading_qvar;       //!< Does the expression start with a QVar?
+    bool single_op;          //!< Is the expression in the original single-operator form, which ignores a zero right hand side?
+};
+
+#endif // QVAREXPR_H
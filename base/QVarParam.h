@@ -0,0 +1,114 @@
+/** @file
+ * This file contains the interface for design note parameters whose values
+ * may be read from QVars, and which only need to be recalculated when those
+ * QVars change.
+ *
+ * @author Chris Page &lt;chris@starforge.co.uk&gt;
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef QVARPARAM_H
+#define QVARPARAM_H
+
+#include <string>
+#include "QVarExpr.h"
+#include "QVarShadow.h"
+
+/** A parameter value that may be read from a QVar expression. Scripts should
+ *  hold these as member variables, set them up using the QVarParam versions
+ *  of TWBaseScript::get_scriptparam_int() and friends, and call update()
+ *  before using the value. update() only evaluates the expression again if
+ *  a shadowed QVar has changed since it was last evaluated, so the cost of
+ *  polling a parameter is a single comparison until something changes.
+ *  T must be either int or float.
+ */
+template <typename T>
+class QVarParam
+{
+public:
+    explicit QVarParam(T initial = 0) : value(initial), text(), expr(NULL), host(0), serial(0)
+        { /* fnord */ }
+
+
+    /** Set the value of the parameter, and the QVar expression it should be
+     *  read from, if any.
+     *
+     * @param initial  The value of the parameter.
+     * @param qvar_str The QVar expression to read the value from in future. If
+     *                 this is empty, the value is fixed.
+     * @param obj_id   The ID of the object to subscribe to changes in QVars
+     *                 used by the expression.
+     */
+    void bind(T initial, const std::string& qvar_str, int obj_id)
+    {
+        value  = initial;
+        text   = qvar_str;
+        expr   = text.empty() ? NULL : &QVarExpr::compiled(text);
+        host   = obj_id;
+        serial = QVarShadow::changes();
+    }
+
+
+    /** Recalculate the value of the parameter if any QVars have changed since
+     *  it was last calculated. If the leading QVar of the expression does not
+     *  exist, the previous value is kept.
+     *
+     * @return true if the value of the parameter has changed, false otherwise.
+     */
+    bool update()
+    {
+        if(!expr || serial == QVarShadow::changes())
+            return false;
+
+        serial = QVarShadow::changes();
+
+        T previous = value;
+        value = expr -> evaluate(value, host);
+
+        return value != previous;
+    }
+
+
+    /** Determine whether the parameter is read from a QVar expression.
+     *
+     * @return true if the parameter uses a QVar expression, false otherwise.
+     */
+    bool has_qvar() const
+        { return expr != NULL; }
+
+
+    /** Obtain the QVar expression the parameter is read from.
+     *
+     * @return The expression, or an empty string if there is none.
+     */
+    const std::string& qvar() const
+        { return text; }
+
+
+    operator T() const
+        { return value; }
+
+    QVarParam& operator=(T newval)
+        { value = newval; return *this; }
+
+private:
+    T               value;  //!< The current value of the parameter.
+    std::string     text;   //!< The QVar expression, if there is one.
+    const QVarExpr* expr;   //!< The compiled expression, NULL if there is none.
+    int             host;   //!< The object to subscribe to QVar changes.
+    uint            serial; //!< The value of QVarShadow::changes() when value was calculated.
+};
+
+#endif // QVARPARAM_H
@@ -0,0 +1,173 @@
+
+#include <lg/interface.h>
+#include <lg/scrservices.h>
+#include "QVarShadow.h"
+#include "ScriptServices.h"
+
+uint QVarShadow::current_generation = 1;
+uint QVarShadow::change_count       = 1;
+
+
+/* ------------------------------------------------------------------------
+ *  Public interface
+ */
+
+bool QVarShadow::get(const char* name, int host, int& value)
+{
+    if(!name || !*name) return false;
+
+    Entry* entry = find(name);
+
+    // Values are only trustworthy while something is subscribed to changes
+    if(entry && entry -> host && entry -> generation == current_generation) {
+        if(entry -> exists)
+            value = entry -> value;
+
+        return entry -> exists;
+    }
+
+    SService<IQuestSrv>& QuestSrv = ScriptServices::quest();
+
+    bool exists = QuestSrv -> Exists(name);
+    int  fetched = exists ? QuestSrv -> Get(name) : 0;
+
+    if(!entry && host) {
+        entry = new Entry;
+        entry -> name = name;
+        entry -> host = 0;
+
+        // The key must point at the entry's copy of the name, not the caller's
+        entries().insert(EntryMap::value_type(entry -> name.c_str(), entry));
+    }
+
+    if(entry) {
+        if(!entry -> host && host) {
+            subscribe(host, entry -> name.c_str());
+            entry -> host = host;
+        }
+
+        entry -> exists     = exists;
+        entry -> value      = fetched;
+        entry -> generation = current_generation;
+    }
+
+    if(exists)
+        value = fetched;
+
+    return exists;
+}
+
+
+void QVarShadow::set(const char* name, int value)
+{
+    Entry* entry = find(name);
+
+    if(entry && entry -> host) {
+        if(!entry -> exists || entry -> value != value)
+            ++change_count;
+
+        entry -> exists     = true;
+        entry -> value      = value;
+        entry -> generation = current_generation;
+    }
+}
+
+
+void QVarShadow::changed(const sQuestMsg* msg)
+{
+    // Several scripts on the host may pass on the same message, which is fine.
+    set(msg -> m_pName, msg -> m_newValue);
+}
+
+
+void QVarShadow::subscribe(int host, const char* name)
+{
+    Subscription sub = { host, name };
+
+    if(!subscriptions()[sub]++)
+        ScriptServices::quest() -> SubscribeMsg(host, name, kQuestDataAny);
+}
+
+
+void QVarShadow::unsubscribe(int host, const char* name)
+{
+    SubscriptionMap& map = subscriptions();
+    Subscription sub = { host, name };
+
+    SubscriptionMap::iterator it = map.find(sub);
+    if(it == map.end())
+        return;
+
+    if(!--it -> second) {
+        ScriptServices::quest() -> UnsubscribeMsg(host, name);
+        map.erase(it);
+    }
+}
+
+
+void QVarShadow::host_ended(int host)
+{
+    EntryMap& map = entries();
+
+    // The entries stay in the table, so a new host will be subscribed when
+    // they are next read.
+    for(EntryMap::iterator it = map.begin(); it != map.end(); ++it) {
+        if(it -> second -> host == host) {
+            unsubscribe(host, it -> second -> name.c_str());
+            it -> second -> host = 0;
+
+            // Changes may be missed until the QVar is read again
+            ++change_count;
+        }
+    }
+}
+
+
+void QVarShadow::invalidate(bool unsubscribe)
+{
+    EntryMap& map = entries();
+
+    for(EntryMap::iterator it = map.begin(); it != map.end(); ++it) {
+        if(unsubscribe && it -> second -> host)
+            QVarShadow::unsubscribe(it -> second -> host, it -> second -> name.c_str());
+
+        delete it -> second;
+    }
+    map.clear();
+
+    if(!unsubscribe)
+        subscriptions().clear();
+
+    refresh();
+}
+
+
+/* ------------------------------------------------------------------------
+ *  Private members
+ */
+
+QVarShadow::Entry* QVarShadow::find(const char* name)
+{
+    if(!name) return NULL;
+
+    EntryMap& map = entries();
+
+    EntryMap::iterator it = map.find(name);
+    return (it != map.end()) ? it -> second : NULL;
+}
+
+
+QVarShadow::EntryMap& QVarShadow::entries()
+{
+    static EntryMap map;
+
+    return map;
+}
+
+
+QVarShadow::SubscriptionMap& QVarShadow::subscriptions()
+{
+    static SubscriptionMap map;
+
+    return map;
+}
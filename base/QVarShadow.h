@@ -0,0 +1,182 @@
+/** @file
+ * This file contains the interface for the module-wide QVar shadow table,
+ * which holds copies of the quest variables scripts read so that they do
+ * not need to be fetched from the quest service every time.
+ *
+ * @author Chris Page &lt;chris@starforge.co.uk&gt;
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef QVARSHADOW_H
+#define QVARSHADOW_H
+
+#include <lg/config.h>
+#include <lg/objstd.h>
+#include <lg/scrmsgs.h>
+#include <cstring>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include "CharHash.h"
+
+/** A case-insensitive table of quest variable values. The first time a QVar
+ *  is read, its value is fetched from the quest service, and the object
+ *  of the script reading it (the host) is subscribed to changes in it. From
+ *  then on, reads are answered from the table, and the QuestChange messages
+ *  sent to the host keep the value up to date: TWBaseScript passes every
+ *  QuestChange message it receives to changed() before handling it.
+ *
+ *  There is only ever one subscription per QVar, however many scripts read
+ *  it. If the host's script ends, the subscription can no longer be relied
+ *  on, so the QVar is fetched again, and a new host subscribed, the next
+ *  time it is read.
+ *
+ *  The quest service keeps one subscription per object and QVar, and sends
+ *  a QuestChange for each subscription, so scripts that want QuestChange
+ *  messages for a QVar must subscribe through subscribe() and unsubscribe()
+ *  rather than calling the quest service themselves. These count the users
+ *  of each subscription, so the table and a script on the same object share
+ *  it, and neither cancels it while the other still needs it. Scripts that
+ *  handle QuestChange must still check the QVar named in the message, as
+ *  their object may be receiving changes to QVars the table is shadowing.
+ *
+ *  The quest service does not send messages when QVars are deleted, or when
+ *  a saved game replaces the quest database, so the values in the table are
+ *  also refetched after refresh() is called. TWBaseScript does that at the
+ *  same points at which it discards cached script variables.
+ */
+class QVarShadow
+{
+public:
+    /** Fetch the value of the specified QVar.
+     *
+     * @param name  The name of the QVar to fetch.
+     * @param host  The ID of the object to subscribe to changes in the QVar
+     *              if it is not already subscribed. If this is 0, the value
+     *              is fetched from the quest service if it is not already
+     *              being shadowed, but is not added to the table.
+     * @param value A reference to an int to store the value in. This is only
+     *              modified if the QVar exists.
+     * @return true if the QVar exists, false if it does not.
+     */
+    static bool get(const char* name, int host, int& value);
+
+
+    /** Update the table after a script has set a QVar. The quest service
+     *  will also send a QuestChange message, but this makes the new value
+     *  visible immediately.
+     *
+     * @param name  The name of the QVar that has been set.
+     * @param value The new value of the QVar.
+     */
+    static void set(const char* name, int value);
+
+
+    /** Update the table with the new value in a QuestChange message.
+     *
+     * @param msg The QuestChange message received.
+     */
+    static void changed(const sQuestMsg* msg);
+
+
+    /** Subscribe an object to changes in a QVar on behalf of one of its
+     *  scripts. Each call must be matched by a call to unsubscribe().
+     *
+     * @param host The ID of the object to send QuestChange messages to.
+     * @param name The name of the QVar to watch.
+     */
+    static void subscribe(int host, const char* name);
+
+
+    /** Release a subscription made with subscribe(). The quest service
+     *  subscription is only cancelled once nothing else is using it.
+     *
+     * @param host The ID of the object that was subscribed.
+     * @param name The name of the QVar.
+     */
+    static void unsubscribe(int host, const char* name);
+
+
+    /** Note that a script on the specified object has ended, so that any
+     *  QVars it was subscribed to are unsubscribed, and will be subscribed
+     *  again on another host.
+     *
+     * @param host The ID of the object the script was on.
+     */
+    static void host_ended(int host);
+
+
+    /** Mark all the values in the table as needing to be fetched again.
+     */
+    static void refresh()
+        { if(!++current_generation) ++current_generation; ++change_count; }
+
+
+    /** Obtain a counter that changes whenever the value of any shadowed QVar
+     *  may have changed. Anything calculated from QVars only needs to be
+     *  calculated again if this has changed since it was last calculated.
+     *
+     * @return The current change count.
+     */
+    static uint changes()
+        { return change_count; }
+
+
+    /** Discard the whole table, including the record of which objects are
+     *  subscribed to which QVars.
+     *
+     * @param unsubscribe If true, the table's own subscriptions are released.
+     *                    Pass false if the quest database they were made in
+     *                    has already been replaced, in which case the counts
+     *                    of scripts' subscriptions are forgotten too.
+     */
+    static void invalidate(bool unsubscribe = true);
+
+private:
+    struct Entry {
+        std::string name;       //!< The QVar name, also used as the map key.
+        int         host;       //!< The object subscribed to the QVar, 0 if there is none.
+        bool        exists;     //!< Did the QVar exist when value was fetched?
+        int         value;      //!< The value of the QVar.
+        uint        generation; //!< The value of current_generation when value was fetched.
+    };
+
+    typedef std::unordered_map<const char*, Entry*, char_hash, char_icmp> EntryMap;
+
+    /** Identifies a quest service subscription: an object, and a QVar name.
+     */
+    struct Subscription {
+        int         host;
+        std::string name;
+
+        bool operator<(const Subscription& other) const
+            { return (host != other.host) ? (host < other.host) : (::_stricmp(name.c_str(), other.name.c_str()) < 0); }
+    };
+
+    typedef std::map<Subscription, int> SubscriptionMap; //!< The number of users of each subscription.
+
+    /** Locate the entry for the specified QVar, or NULL if it is not shadowed.
+     */
+    static Entry* find(const char* name);
+
+    static EntryMap& entries();
+
+    static SubscriptionMap& subscriptions();
+
+    static uint current_generation; //!< Incremented to make all values be fetched again.
+    static uint change_count;       //!< Incremented whenever shadowed values may have changed.
+};
+
+#endif // QVARSHADOW_H
@@ -21,7 +21,7 @@
 #ifndef SAVED_COUNTER_H
 #define SAVED_COUNTER_H
 
-#include "scriptvars.h"
+#include "CachedScriptVar.h"
 
 /** A class providing persistent use count and limiting facilities. This
  *  class simplifies the process of maintaining use counters, limiters,
@@ -153,8 +153,8 @@ private:
     bool capacitor;       //!< If true, and min is set, the counter works in capacitor mode.
     bool limit;           //!< If true, capacitor is off, and max is set, the counter works in limit mode.
     int  falloff;         //!< The time in milliseconds it takes for the count to decrease by 1.
-    script_int count;     //!< The current count
-    script_int last_time; //!< The sim time at which the count was last updated
+    cached_script_int count;     //!< The current count
+    cached_script_int last_time; //!< The sim time at which the count was last updated
 };
 
 #endif // SAVED_COUNTER_H
@@ -0,0 +1,104 @@
+
+#include "ScratchArena.h"
+
+// Large enough that typical message handlers never need a second block.
+const size_t ScratchArena::BLOCK_SIZE = 16384;
+
+
+/* ------------------------------------------------------------------------
+ *  Public interface
+ */
+
+ScratchArena& ScratchArena::get()
+{
+    static ScratchArena arena;
+
+    return arena;
+}
+
+
+void* ScratchArena::alloc(size_t size)
+{
+    // Keep everything 8-byte aligned
+    size = (size + 7) & ~static_cast<size_t>(7);
+
+    if(blocks.empty() || offset + size > blocks[current].size)
+        next_block(size);
+
+    void* ptr = blocks[current].data + offset;
+    offset += size;
+
+    return ptr;
+}
+
+
+void ScratchArena::free(void* ptr, size_t size)
+{
+    size = (size + 7) & ~static_cast<size_t>(7);
+
+    // Only the most recent allocation can be handed back immediately
+    if(!blocks.empty() && size <= offset && static_cast<char*>(ptr) + size == blocks[current].data + offset)
+        offset -= size;
+}
+
+
+ScratchArena::Mark ScratchArena::mark() const
+{
+    Mark mark = { current, offset };
+
+    return mark;
+}
+
+
+void ScratchArena::release(const Mark& mark)
+{
+    current = mark.block;
+    offset  = mark.offset;
+
+    // When the arena is completely empty again, discard any oversized blocks
+    // made for unusually large allocations so they don't hang around forever.
+    if(!current && !offset) {
+        std::vector<Block>::iterator it = blocks.begin();
+        while(it != blocks.end()) {
+            if(it -> size > BLOCK_SIZE) {
+                delete[] it -> data;
+                it = blocks.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+
+/* ------------------------------------------------------------------------
+ *  Private members
+ */
+
+ScratchArena::~ScratchArena()
+{
+    std::vector<Block>::iterator it;
+
+    for(it = blocks.begin(); it != blocks.end(); ++it) {
+        delete[] it -> data;
+    }
+}
+
+
+void ScratchArena::next_block(size_t size)
+{
+    size_t next = blocks.empty() ? 0 : current + 1;
+
+    // Reuse the following block if there is one and it's big enough, otherwise
+    // a new block is needed at this point in the list.
+    if(next >= blocks.size() || blocks[next].size < size) {
+        Block block;
+        block.size = (size > BLOCK_SIZE) ? size : BLOCK_SIZE;
+        block.data = new char[block.size];
+
+        blocks.insert(blocks.begin() + next, block);
+    }
+
+    current = next;
+    offset  = 0;
+}
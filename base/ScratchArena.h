@@ -0,0 +1,208 @@
+/** @file
+ * This file contains the interface for the per-message scratch arena, a
+ * bump-pointer allocator for short-lived data created while a script is
+ * handling a message, and STL-compatible allocator and container types
+ * that use it.
+ *
+ * @author Chris Page &lt;chris@starforge.co.uk&gt;
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef SCRATCHARENA_H
+#define SCRATCHARENA_H
+
+#include <cstddef>
+#include <new>
+#include <string>
+#include <vector>
+
+/** A module-wide bump-pointer arena for transient allocations. Memory is
+ *  handed out by advancing a pointer through large blocks, and is reclaimed
+ *  all at once by releasing the arena back to a previously taken mark.
+ *  TWBaseScript::ReceiveMessage() takes a mark on entry and releases it on
+ *  exit, so anything allocated from the arena while handling a message is
+ *  discarded when the handler returns. As marks are released in the reverse
+ *  order to that in which they are taken, messages sent while handling
+ *  another message work as expected: the nested handler releases only what
+ *  it allocated.
+ *
+ * @warning Memory allocated from the arena must never be stored anywhere
+ *          that outlives the scope the allocation was made in - in practice,
+ *          it must not be kept in script member variables.
+ */
+class ScratchArena
+{
+public:
+    /** A position in the arena that it can later be released back to.
+     */
+    struct Mark {
+        size_t block;  //!< The index of the block in use when the mark was taken.
+        size_t offset; //!< The offset of the first free byte in that block.
+    };
+
+
+    /** A convenience class that takes a mark when created, and releases the
+     *  arena back to it when destroyed.
+     */
+    class Scope
+    {
+    public:
+        Scope() : mark(ScratchArena::get().mark())
+            { /* fnord */ }
+
+        ~Scope()
+            { ScratchArena::get().release(mark); }
+
+    private:
+        Mark mark;
+    };
+
+
+    /** Obtain a reference to the module's arena.
+     *
+     * @return A reference to the arena.
+     */
+    static ScratchArena& get();
+
+
+    /** Allocate the specified number of bytes from the arena. The memory
+     *  returned is aligned to 8 bytes.
+     *
+     * @param size The number of bytes to allocate.
+     * @return A pointer to the allocated memory. This never returns NULL,
+     *         std::bad_alloc is thrown if memory can not be obtained.
+     */
+    void* alloc(size_t size);
+
+
+    /** Return memory to the arena. This only does anything if the memory is
+     *  the most recent allocation made from the arena (which is often the
+     *  case when a container grows), otherwise the memory is reclaimed when
+     *  the arena is released.
+     *
+     * @param ptr  A pointer to memory allocated by alloc().
+     * @param size The size passed to alloc() when the memory was allocated.
+     */
+    void free(void* ptr, size_t size);
+
+
+    /** Record the current position in the arena.
+     *
+     * @return A mark that can be passed to release().
+     */
+    Mark mark() const;
+
+
+    /** Release all memory allocated from the arena since the specified mark
+     *  was taken. Marks must be released in the reverse order to that in
+     *  which they were taken.
+     *
+     * @param mark The mark to release the arena back to.
+     */
+    void release(const Mark& mark);
+
+private:
+    ScratchArena() : blocks(), current(0), offset(0)
+        { /* fnord */ }
+
+    ~ScratchArena();
+
+    /** Move to a block with at least the specified amount of space available.
+     *
+     * @param size The number of bytes that need to be allocated.
+     */
+    void next_block(size_t size);
+
+    struct Block {
+        char*  data;
+        size_t size;
+    };
+
+    std::vector<Block> blocks; //!< The blocks in the arena, in the order they are used.
+    size_t current;            //!< The index of the block allocations are currently made from.
+    size_t offset;             //!< The offset of the first free byte in the current block.
+
+    static const size_t BLOCK_SIZE;
+};
+
+
+/** An STL allocator that allocates from the ScratchArena. Containers using
+ *  this allocator must not outlive the message handler they are created in.
+ */
+template <typename T>
+class ScratchAllocator
+{
+public:
+    typedef T         value_type;
+    typedef T*        pointer;
+    typedef const T*  const_pointer;
+    typedef T&        reference;
+    typedef const T&  const_reference;
+    typedef size_t    size_type;
+    typedef ptrdiff_t difference_type;
+
+    template <typename U> struct rebind {
+        typedef ScratchAllocator<U> other;
+    };
+
+    ScratchAllocator()
+        { /* fnord */ }
+
+    template <typename U> ScratchAllocator(const ScratchAllocator<U>&)
+        { /* fnord */ }
+
+    pointer address(reference value) const
+        { return &value; }
+
+    const_pointer address(const_reference value) const
+        { return &value; }
+
+    pointer allocate(size_type count, const void* = 0)
+        { return static_cast<pointer>(ScratchArena::get().alloc(count * sizeof(T))); }
+
+    void deallocate(pointer ptr, size_type count)
+        { ScratchArena::get().free(ptr, count * sizeof(T)); }
+
+    size_type max_size() const
+        { return static_cast<size_type>(-1) / sizeof(T); }
+
+    void construct(pointer ptr, const T& value)
+        { new(static_cast<void*>(ptr)) T(value); }
+
+    void destroy(pointer ptr)
+        { ptr -> ~T(); }
+};
+
+template <typename T, typename U>
+inline bool operator==(const ScratchAllocator<T>&, const ScratchAllocator<U>&) { return true; }
+
+template <typename T, typename U>
+inline bool operator!=(const ScratchAllocator<T>&, const ScratchAllocator<U>&) { return false; }
+
+
+/** A string type for temporary strings built while handling a message.
+ */
+typedef std::basic_string<char, std::char_traits<char>, ScratchAllocator<char> > ScratchString;
+
+
+/** A vector type for temporary lists built while handling a message. Use
+ *  as `ScratchVector<Foo>::type`.
+ */
+template <typename T>
+struct ScratchVector {
+    typedef std::vector<T, ScratchAllocator<T> > type;
+};
+
+#endif // SCRATCHARENA_H
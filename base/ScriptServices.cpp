@@ -0,0 +1,37 @@
+
+#include "ScriptServices.h"
+
+ScriptServices* ScriptServices::cache = NULL;
+
+
+/* ------------------------------------------------------------------------
+ *  Public interface
+ */
+
+void ScriptServices::init(IScriptMan* manager)
+{
+    if(!cache && manager)
+        cache = new ScriptServices(manager);
+}
+
+
+void ScriptServices::release()
+{
+    // Deleting the cache releases all the interfaces it holds
+    delete cache;
+    cache = NULL;
+}
+
+
+/* ------------------------------------------------------------------------
+ *  Private members
+ */
+
+ScriptServices::ScriptServices(IScriptMan* manager) : act_react_srv(manager), ai_srv(manager),
+                                                      link_srv(manager), link_tools_srv(manager), object_srv(manager),
+                                                      pgroup_srv(manager), phys_srv(manager), property_srv(manager),
+                                                      quest_srv(manager), sound_srv(manager),
+                                                      link_manager_if(manager), object_system_if(manager), trait_manager_if(manager)
+{
+    /* fnord */
+}
@@ -0,0 +1,107 @@
+/** @file
+ * This file contains the interface for the module-wide cache of engine
+ * script services and interfaces.
+ *
+ * @author Chris Page &lt;chris@starforge.co.uk&gt;
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef SCRIPTSERVICES_H
+#define SCRIPTSERVICES_H
+
+#include <lg/config.h>
+#include <lg/objstd.h>
+#include <lg/interface.h>
+#include <lg/scrmanagers.h>
+#include <lg/scrservices.h>
+#include <lg/objects.h>
+#include <lg/links.h>
+#include <lg/properties.h>
+
+/** A cache of the engine services and interfaces used by the scripts in this
+ *  module. Constructing an SService or SInterface queries the script manager
+ *  for the interface and releases it again when it goes out of scope, which
+ *  adds up when it is done in helpers called for every link or object. The
+ *  cache acquires each interface once when the first script is created, and
+ *  releases them all when the last script is destroyed. The engine destroys
+ *  every script before it shuts down the script manager, so the interfaces
+ *  are never held past that point.
+ *
+ *  The accessors return references to the cached SService and SInterface
+ *  objects, so code that used to construct its own can simply bind a
+ *  reference instead, eg:
+ *
+ *      SService<IObjectSrv>& obj_srv = ScriptServices::object();
+ *
+ * @note The accessors must only be used while at least one TWBaseScript
+ *       exists, as outside that the services are not held.
+ */
+class ScriptServices
+{
+public:
+    /** Acquire all the cached services and interfaces. This is called when
+     *  the first script is created, and does nothing if they have already
+     *  been acquired.
+     *
+     * @param manager A pointer to the engine's script manager.
+     */
+    static void init(IScriptMan* manager);
+
+
+    /** Release all the cached services and interfaces. This is called when
+     *  the last script is destroyed.
+     */
+    static void release();
+
+
+    // Script services
+    static SService<IActReactSrv>&  act_react()  { return cache -> act_react_srv;  }
+    static SService<IAIScrSrv>&     ai()         { return cache -> ai_srv;         }
+    static SService<ILinkSrv>&      link()       { return cache -> link_srv;       }
+    static SService<ILinkToolsSrv>& link_tools() { return cache -> link_tools_srv; }
+    static SService<IObjectSrv>&    object()     { return cache -> object_srv;     }
+    static SService<IPGroupSrv>&    pgroup()     { return cache -> pgroup_srv;     }
+    static SService<IPhysSrv>&      phys()       { return cache -> phys_srv;       }
+    static SService<IPropertySrv>&  property()   { return cache -> property_srv;   }
+    static SService<IQuestSrv>&     quest()      { return cache -> quest_srv;      }
+    static SService<ISoundScrSrv>&  sound()      { return cache -> sound_srv;      }
+
+    // Engine interfaces
+    static SInterface<ILinkManager>&  link_manager()  { return cache -> link_manager_if;  }
+    static SInterface<IObjectSystem>& object_system() { return cache -> object_system_if; }
+    static SInterface<ITraitManager>& trait_manager() { return cache -> trait_manager_if; }
+
+private:
+    ScriptServices(IScriptMan* manager);
+
+    SService<IActReactSrv>  act_react_srv;
+    SService<IAIScrSrv>     ai_srv;
+    SService<ILinkSrv>      link_srv;
+    SService<ILinkToolsSrv> link_tools_srv;
+    SService<IObjectSrv>    object_srv;
+    SService<IPGroupSrv>    pgroup_srv;
+    SService<IPhysSrv>      phys_srv;
+    SService<IPropertySrv>  property_srv;
+    SService<IQuestSrv>     quest_srv;
+    SService<ISoundScrSrv>  sound_srv;
+
+    SInterface<ILinkManager>  link_manager_if;
+    SInterface<IObjectSystem> object_system_if;
+    SInterface<ITraitManager> trait_manager_if;
+
+    static ScriptServices* cache; //!< The module's cache, NULL outside init() and release().
+};
+
+#endif // SCRIPTSERVICES_H
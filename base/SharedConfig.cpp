@@ -0,0 +1,123 @@
+
+#include <cstring>
+#include "SharedConfig.h"
+#include "DesignNote.h"
+
+
+/* ------------------------------------------------------------------------
+ *  Public interface
+ */
+
+void SharedConfig::invalidate()
+{
+    BlockMap& map = blocks();
+
+    for(BlockMap::iterator it = map.begin(); it != map.end(); ++it) {
+        it -> second -> listed = false;
+
+        // Anything not in use can go now, the rest goes when it is released
+        if(!it -> second -> refs)
+            delete it -> second;
+    }
+    map.clear();
+}
+
+
+bool SharedConfig::shareable(const char* script, const char* note)
+{
+    if(!note) return true;
+
+    const DesignNote& index = DesignNote::index(note);
+    size_t script_len = strlen(script);
+
+    for(size_t pos = 0; pos < index.size(); ++pos) {
+        const DesignNote::Key& key = index.key(pos);
+
+        if(key.length <= script_len || ::_strnicmp(index.name(key), script, script_len))
+            continue;
+
+        // Vectors may take some of their components from QVars
+        if((key.flags & DesignNote::KEY_QVAR) || memchr(index.value_text(key), '$', key.value_length))
+            return false;
+    }
+
+    return true;
+}
+
+
+/* ------------------------------------------------------------------------
+ *  Private members
+ */
+
+SharedConfig* SharedConfig::find(const char* script, const char* note)
+{
+    std::string key;
+    make_key(key, script, note);
+
+    BlockMap& map = blocks();
+
+    BlockMap::iterator it = map.find(key);
+    if(it == map.end())
+        return NULL;
+
+    ++it -> second -> refs;
+    return it -> second;
+}
+
+
+void SharedConfig::share(SharedConfig* block, const char* script, const char* note)
+{
+    make_key(block -> key, script, note);
+    ++block -> refs;
+
+    // If another block has been shared under the same key, this one replaces it
+    // for new instances; the old one lives on until its users release it.
+    BlockMap& map = blocks();
+    BlockMap::iterator it = map.find(block -> key);
+    if(it != map.end()) {
+        it -> second -> listed = false;
+        if(!it -> second -> refs)
+            delete it -> second;
+
+        it -> second = block;
+    } else {
+        map.insert(BlockMap::value_type(block -> key, block));
+    }
+
+    block -> listed = true;
+}
+
+
+void SharedConfig::keep(SharedConfig* block)
+{
+    block -> listed = false;
+    ++block -> refs;
+}
+
+
+void SharedConfig::release()
+{
+    if(--refs) return;
+
+    if(listed)
+        blocks().erase(key);
+
+    delete this;
+}
+
+
+void SharedConfig::make_key(std::string& key, const char* script, const char* note)
+{
+    // The script name can't contain a nul, so it can safely separate the parts
+    key = script;
+    key += '\0';
+    if(note) key += note;
+}
+
+
+SharedConfig::BlockMap& SharedConfig::blocks()
+{
+    static BlockMap map;
+
+    return map;
+}
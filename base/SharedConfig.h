@@ -0,0 +1,209 @@
+/** @file
+ * This file contains the interface for configuration blocks that are parsed
+ * from design notes once and shared between all the script instances using
+ * the same design note.
+ *
+ * @author Chris Page &lt;chris@starforge.co.uk&gt;
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef SHAREDCONFIG_H
+#define SHAREDCONFIG_H
+
+#include <lg/config.h>
+#include <string>
+#include <unordered_map>
+
+/** The base class for settings parsed from a design note. Objects that
+ *  inherit a design note from a shared archetype all have identical notes,
+ *  so rather than each script instance parsing the note into its own copy
+ *  of the settings, the settings are parsed once and shared. Blocks are
+ *  looked up by script name and the full text of the design note, and are
+ *  immutable once shared. Script instances hold them through a ConfigRef,
+ *  and a block is deleted when the last reference to it goes away.
+ *
+ *  Settings that depend on anything other than the design note (the object
+ *  the script is on, persistent variables, QVars) must not be stored in a
+ *  shared block. Names resolved to object IDs are fine, as long as the
+ *  objects can not change while the sim is running: invalidate() is called
+ *  when the sim starts, so that blocks are parsed again for the new mission.
+ *  Notes that set any of the script's parameters from QVars can not be
+ *  shared at all, see shareable(), so their blocks are kept by the instance
+ *  that parsed them.
+ */
+class SharedConfig
+{
+public:
+    /** Stop sharing all the current blocks with new script instances. Blocks
+     *  still referenced by existing instances are not deleted until those
+     *  instances release them.
+     */
+    static void invalidate();
+
+
+    /** Determine whether the settings parsed from a design note may be shared.
+     *  A note that sets any of the script's parameters from a QVar, even
+     *  partly, will give different settings when parsed at different times.
+     *
+     * @param script The name of the script.
+     * @param note   The design note, which may be NULL.
+     * @return true if the note's settings may be shared, false if each
+     *         instance needs to parse the note for itself.
+     */
+    static bool shareable(const char* script, const char* note);
+
+protected:
+    SharedConfig() : refs(0), listed(false), key()
+        { /* fnord */ }
+
+    virtual ~SharedConfig()
+        { /* fnord */ }
+
+private:
+    template <typename T> friend class ConfigRef;
+
+    // Blocks are shared through ConfigRefs, and must not be copied.
+    SharedConfig(const SharedConfig&);
+    SharedConfig& operator=(const SharedConfig&);
+
+    /** Locate the block for the specified script and design note, and add a
+     *  reference to it.
+     */
+    static SharedConfig* find(const char* script, const char* note);
+
+    /** Make the specified block available to other instances of the script
+     *  with the same design note, and add a reference to it.
+     */
+    static void share(SharedConfig* block, const char* script, const char* note);
+
+    /** Add a reference to a block that is not to be shared.
+     */
+    static void keep(SharedConfig* block);
+
+    /** Remove a reference to the block, deleting it if there are none left.
+     */
+    void release();
+
+    /** Build the key used to look up blocks for the script and note.
+     */
+    static void make_key(std::string& key, const char* script, const char* note);
+
+    typedef std::unordered_map<std::string, SharedConfig*> BlockMap;
+
+    static BlockMap& blocks();
+
+    uint        refs;   //!< The number of ConfigRefs to the block.
+    bool        listed; //!< Is the block in the map of blocks available for sharing?
+    std::string key;    //!< The key the block is stored under in the map.
+};
+
+
+/** A reference to a shared configuration block of type T, which must
+ *  inherit from SharedConfig. Scripts should hold one of these as a member,
+ *  and set it up in init() using find(), then share() or keep(), eg:
+ *
+ *      if(!config.find(Name(), design_note)) {
+ *          FooConfig* parsed = new FooConfig;
+ *          parse_config(design_note, *parsed);
+ *
+ *          if(SharedConfig::shareable(Name(), design_note))
+ *              config.share(parsed, Name(), design_note);
+ *          else
+ *              config.keep(parsed);
+ *      }
+ */
+template <typename T>
+class ConfigRef
+{
+public:
+    ConfigRef() : block(NULL)
+        { /* fnord */ }
+
+    ~ConfigRef()
+        { clear(); }
+
+
+    /** Attach to the block already parsed from the specified design note by
+     *  another instance of the script, if there is one.
+     *
+     * @param script The name of the script.
+     * @param note   The design note, which may be NULL.
+     * @return true if a block was found, false if the note needs to be parsed.
+     */
+    bool find(const char* script, const char* note)
+    {
+        clear();
+        block = static_cast<const T*>(SharedConfig::find(script, note));
+        return block != NULL;
+    }
+
+
+    /** Attach to a newly parsed block, and make it available to other
+     *  instances of the script with the same design note.
+     *
+     * @param parsed The block parsed from the note. This must have been
+     *               allocated with new, and must not be modified afterwards.
+     * @param script The name of the script.
+     * @param note   The design note the block was parsed from, which may be NULL.
+     */
+    void share(T* parsed, const char* script, const char* note)
+    {
+        clear();
+        SharedConfig::share(parsed, script, note);
+        block = parsed;
+    }
+
+
+    /** Attach to a newly parsed block without sharing it with any other
+     *  instance of the script.
+     *
+     * @param parsed The block parsed from the note. This must have been
+     *               allocated with new.
+     */
+    void keep(T* parsed)
+    {
+        clear();
+        SharedConfig::keep(parsed);
+        block = parsed;
+    }
+
+
+    /** Drop the reference to the block, if there is one.
+     */
+    void clear()
+    {
+        if(block) const_cast<T*>(block) -> release();
+        block = NULL;
+    }
+
+
+    const T* operator->() const
+        { return block; }
+
+    const T& operator*() const
+        { return *block; }
+
+    operator bool() const
+        { return block != NULL; }
+
+private:
+    // Copying would need to add a reference, and nothing needs it.
+    ConfigRef(const ConfigRef&);
+    ConfigRef& operator=(const ConfigRef&);
+
+    const T* block; //!< The block referenced, or NULL.
+};
+
+#endif // SHAREDCONFIG_H
@@ -0,0 +1,176 @@
+
+#include <lg/interface.h>
+#include <lg/scrmanagers.h>
+#include <lg/scrservices.h>
+#include <lg/objects.h>
+#include <lg/properties.h>
+#include <algorithm>
+#include <cmath>
+#include "SpatialIndex.h"
+#include "ScriptServices.h"
+
+// Large enough that a typical trigger radius covers a handful of cells.
+const float SpatialIndex::CELL_SIZE = 16.0f;
+
+
+/* ------------------------------------------------------------------------
+ *  Public interface
+ */
+
+SpatialIndex& SpatialIndex::get()
+{
+    static SpatialIndex index;
+
+    return index;
+}
+
+
+void SpatialIndex::search(ScratchVector<int>::type& results, int archetype, bool do_full, int from_obj, float radius, bool lessthan, uint fetch_count, bool sorted, uint now)
+{
+    // Only archetypes can be searched
+    if(archetype >= 0) return;
+
+    SService<IObjectSrv>& ObjectSrv = ScriptServices::object();
+    cScrVec from_pos;
+    ObjectSrv -> Position(from_pos, from_obj);
+
+    Snapshot& snap = snapshots[(static_cast<long long>(archetype) << 1) | (do_full ? 1 : 0)];
+    ScratchVector<Candidate>::type found;
+
+    // Only searches after the first in a frame are worth building the grid for
+    if(snap.generation == generation && snap.time == now) {
+        grid_search(snap, from_pos, radius, lessthan, found);
+    } else {
+        snap.generation = generation;
+        snap.time       = now;
+        scan(snap, archetype, do_full, from_pos, radius * radius, lessthan, found);
+    }
+
+    // Nearest-N only needs the closest objects in order, a full sort is only
+    // needed when everything must be returned in order.
+    size_t count = found.size();
+    if(fetch_count && fetch_count < count) {
+        count = fetch_count;
+        std::partial_sort(found.begin(), found.begin() + count, found.end());
+    } else if(sorted || fetch_count) {
+        std::sort(found.begin(), found.end());
+    }
+
+    for(size_t pos = 0; pos < count; ++pos) {
+        results.push_back(found[pos].second);
+    }
+}
+
+
+/* ------------------------------------------------------------------------
+ *  Private members
+ */
+
+void SpatialIndex::scan(Snapshot& snap, int archetype, bool do_full, const cScrVec& from_pos, float radius2, bool lessthan, ScratchVector<Candidate>::type& found)
+{
+    SService<IObjectSrv>&      ObjectSrv = ScriptServices::object();
+    SInterface<ITraitManager>& TraitMgr  = ScriptServices::trait_manager();
+
+    snap.grouped = false;
+    snap.entries.clear();
+
+    ulong flags = kTraitQueryChildren;
+    if(do_full) flags |= kTraitQueryFull;
+
+    SInterface<IObjectQuery> query = TraitMgr -> Query(archetype, flags);
+    if(!query) return;
+
+    Entry entry;
+    cScrVec pos;
+
+    for(; !query -> Done(); query -> Next()) {
+        entry.obj_id = query -> Object();
+
+        // Only concrete objects have a position
+        if(entry.obj_id > 0) {
+            ObjectSrv -> Position(pos, entry.obj_id);
+            entry.x = pos.x;
+            entry.y = pos.y;
+            entry.z = pos.z;
+
+            float dx = entry.x - from_pos.x, dy = entry.y - from_pos.y, dz = entry.z - from_pos.z;
+            float dist2 = dx * dx + dy * dy + dz * dz;
+
+            if(lessthan ? (dist2 < radius2) : (dist2 > radius2))
+                found.push_back(Candidate(dist2, entry.obj_id));
+
+            // Kept in case another search over the archetype follows in this frame
+            snap.entries.push_back(entry);
+        }
+    }
+}
+
+
+void SpatialIndex::grid_search(Snapshot& snap, const cScrVec& from_pos, float radius, bool lessthan, ScratchVector<Candidate>::type& found)
+{
+    std::vector<Entry>& entries = snap.entries;
+    if(entries.empty()) return;
+
+    // Group the objects by cell so each cell can be found by binary search
+    if(!snap.grouped) {
+        for(std::vector<Entry>::iterator it = entries.begin(); it != entries.end(); ++it) {
+            it -> cell = cell_key(cell_coord(it -> x), cell_coord(it -> y), cell_coord(it -> z));
+        }
+        std::sort(entries.begin(), entries.end());
+        snap.grouped = true;
+    }
+
+    float radius2 = radius * radius;
+
+    // Work out which cells the sphere overlaps. Searches for objects outside the
+    // sphere, or for spheres that overlap more cells than there are objects, need
+    // to look at every object anyway.
+    int minx = cell_coord(from_pos.x - radius), maxx = cell_coord(from_pos.x + radius);
+    int miny = cell_coord(from_pos.y - radius), maxy = cell_coord(from_pos.y + radius);
+    int minz = cell_coord(from_pos.z - radius), maxz = cell_coord(from_pos.z + radius);
+    double cells = double(maxx - minx + 1) * double(maxy - miny + 1) * double(maxz - minz + 1);
+
+    std::vector<Entry>::const_iterator it;
+    if(!lessthan || cells > entries.size()) {
+        for(it = entries.begin(); it != entries.end(); ++it) {
+            float dx = it -> x - from_pos.x, dy = it -> y - from_pos.y, dz = it -> z - from_pos.z;
+            float dist2 = dx * dx + dy * dy + dz * dz;
+
+            if(lessthan ? (dist2 < radius2) : (dist2 > radius2))
+                found.push_back(Candidate(dist2, it -> obj_id));
+        }
+    } else {
+        Entry key;
+        for(int cx = minx; cx <= maxx; ++cx) {
+            for(int cy = miny; cy <= maxy; ++cy) {
+                for(int cz = minz; cz <= maxz; ++cz) {
+                    key.cell = cell_key(cx, cy, cz);
+                    std::pair<std::vector<Entry>::const_iterator, std::vector<Entry>::const_iterator> range = std::equal_range(entries.begin(), entries.end(), key);
+
+                    for(it = range.first; it != range.second; ++it) {
+                        float dx = it -> x - from_pos.x, dy = it -> y - from_pos.y, dz = it -> z - from_pos.z;
+                        float dist2 = dx * dx + dy * dy + dz * dz;
+
+                        if(dist2 < radius2)
+                            found.push_back(Candidate(dist2, it -> obj_id));
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+int SpatialIndex::cell_coord(float pos)
+{
+    return static_cast<int>(floorf(pos / CELL_SIZE));
+}
+
+
+long long SpatialIndex::cell_key(int cx, int cy, int cz)
+{
+    // 21 bits per axis is over 33 million units each way, far beyond any mission
+    const long long mask = (1LL << 21) - 1;
+
+    return ((cx & mask) << 42) | ((cy & mask) << 21) | (cz & mask);
+}
@@ -0,0 +1,158 @@
+/** @file
+ * This file contains the interface for the module-wide spatial index used
+ * to speed up radius archetype searches.
+ *
+ * @author Chris Page &lt;chris@starforge.co.uk&gt;
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef SPATIALINDEX_H
+#define SPATIALINDEX_H
+
+#include <lg/config.h>
+#include <lg/objstd.h>
+#include <lg/types.h>
+#include <unordered_map>
+#include <vector>
+#include "ScratchArena.h"
+
+/** A uniform grid of the concrete descendants of an archetype, used when the
+ *  same archetype is searched more than once in a frame.
+ *
+ *  The script interface does not tell scripts when objects move, so the grid
+ *  for an archetype is a snapshot of the positions of its descendants, and is
+ *  only reused by searches made at the same sim time. The first radius search
+ *  over an archetype at a given time simply fetches the position of every
+ *  descendant and measures its distance, as it would without the index, and
+ *  records the positions it fetched as it goes. If another search over the
+ *  same archetype is made at the same time, the recorded positions are
+ *  grouped into grid cells, and that search and any later ones at that time
+ *  only look at the cells that overlap their sphere. A search at a later
+ *  time always starts again with a fresh scan.
+ *
+ *  Positions are not fetched again for searches that reuse the grid, so an
+ *  object moved by a script after the first search in a frame is found where
+ *  it was at the time of that search. Snapshots are discarded when
+ *  invalidate() is called, which TWBaseScript does when a script begins or
+ *  ends, so objects created or destroyed along with a TWScript are noticed
+ *  straight away; other objects are noticed from the next frame.
+ */
+class SpatialIndex
+{
+public:
+    /** Obtain a reference to the module's spatial index.
+     *
+     * @return A reference to the index.
+     */
+    static SpatialIndex& get();
+
+
+    /** Mark all snapshots as stale, so that the next search over any archetype
+     *  fetches the archetype's descendants and their positions again. The
+     *  snapshots' storage is kept for reuse, as this happens whenever a script
+     *  starts or ends.
+     */
+    void invalidate()
+        { if(!++generation) ++generation; }
+
+
+    /** Discard all snapshots and their storage. This is called when the sim
+     *  starts or a new mission or saved game is loaded, after which the
+     *  archetypes searched may be entirely different.
+     */
+    void clear()
+        { snapshots.clear(); invalidate(); }
+
+
+    /** Locate the concrete descendants of an archetype that are inside, or
+     *  outside, a sphere around the specified object.
+     *
+     * @param results     A reference to a vector to store the matched object IDs in.
+     * @param archetype   The ID of the archetype to search.
+     * @param do_full     If true, include indirect descendants of the archetype.
+     * @param from_obj    The object at the centre of the sphere.
+     * @param radius      The radius of the sphere.
+     * @param lessthan    If true, objects must be inside the sphere, otherwise
+     *                    they must be outside it.
+     * @param fetch_count If non-zero, at most this many objects are returned, and
+     *                    they are the objects closest to from_obj.
+     * @param sorted      If true, the objects are returned in order of increasing
+     *                    distance from from_obj.
+     * @param now         The current sim time.
+     */
+    void search(ScratchVector<int>::type& results, int archetype, bool do_full, int from_obj, float radius, bool lessthan, uint fetch_count, bool sorted, uint now);
+
+private:
+    SpatialIndex() : snapshots(), generation(1)
+        { /* fnord */ }
+
+    /** An object in a snapshot, along with the grid cell it is in.
+     */
+    struct Entry {
+        long long cell;   //!< The key of the grid cell containing the object.
+        int       obj_id; //!< The ID of the object.
+        float     x;      //!< The position of the object.
+        float     y;
+        float     z;
+
+        bool operator<(const Entry& rhs) const
+            { return cell < rhs.cell; }
+    };
+
+    /** The positions of the descendants of an archetype at a given time. The
+     *  entries are sorted by grid cell, so that the objects in a cell are
+     *  contiguous, once a second search needs them.
+     */
+    struct Snapshot {
+        uint generation;            //!< The index generation the snapshot was taken in.
+        uint time;                  //!< The sim time the snapshot was taken at.
+        bool grouped;               //!< Have the entries been sorted by cell?
+        std::vector<Entry> entries; //!< The objects, in query order until grouped.
+
+        Snapshot() : generation(0), time(0), grouped(false), entries()
+            { /* fnord */ }
+    };
+
+    /** A matched object, with its squared distance from the search origin.
+     */
+    typedef std::pair<float, int> Candidate;
+
+    /** Check the distance to every descendant of the archetype, fetching its
+     *  position from the engine, and record the positions in the snapshot.
+     */
+    void scan(Snapshot& snap, int archetype, bool do_full, const cScrVec& from_pos, float radius2, bool lessthan, ScratchVector<Candidate>::type& found);
+
+    /** Check the distance to the objects in the snapshot's grid cells that
+     *  could be in the sphere, grouping the entries into cells if needed.
+     */
+    void grid_search(Snapshot& snap, const cScrVec& from_pos, float radius, bool lessthan, ScratchVector<Candidate>::type& found);
+
+    /** Work out the grid coordinate containing the specified position.
+     */
+    static int cell_coord(float pos);
+
+    /** Work out the key of the grid cell with the specified coordinates.
+     */
+    static long long cell_key(int cx, int cy, int cz);
+
+    typedef std::unordered_map<long long, Snapshot> SnapshotMap;
+
+    SnapshotMap snapshots; //!< The snapshots, keyed by archetype and whether they include indirect descendants.
+    uint generation;       //!< Incremented to discard all snapshots.
+
+    static const float CELL_SIZE;
+};
+
+#endif // SPATIALINDEX_H
@@ -12,16 +12,33 @@
 #include <cstdlib>
 #include <cstdio>
 #include <cstdarg>
-#include <algorithm>    // std::sort and std::shuffle
+#include <algorithm>    // std::sort, std::lower_bound and std::partial_sort
+#include <functional>   // std::greater
+#include <cmath>        // log
 #include <chrono>       // std::chrono::system_clock
 
 #include "Version.h"
 #include "TWBaseScript.h"
 #include "ScriptModule.h"
 #include "ScriptLib.h"
+#include "Allocator.h"
+#include "ScriptServices.h"
+#include "SpatialIndex.h"
+#include "QVarExpr.h"
+#include "DesignNote.h"
+
+extern cMemoryAllocator g_Allocator;
 
 const char* const TWBaseScript::debug_levels[] = {"DEBUG", "WARNING", "ERROR"};
+
+static const ParamDesc base_params[] = {
+    PARAM_KNOWN("Debug"),
+};
+const ParamSchema TWBaseScript::param_schema(base_params);
 const uint TWBaseScript::NAME_BUFFER_SIZE = 256;
+uint TWBaseScript::live_scripts = 0;
+bool TWBaseScript::reload_pending = false;
+bool TWBaseScript::sim_started = false;
 
 /* ------------------------------------------------------------------------
  *  Public interface exposed to the rest of the game
@@ -31,17 +48,74 @@ STDMETHODIMP TWBaseScript::ReceiveMessage(sScrMsg* msg, sMultiParm* reply, eScrT
 {
     long result = 0;
 
+    // Anything allocated from the scratch arena while handling this message
+    // is released when this returns.
+    ScratchArena::Scope scratch;
+
+    // Changes to cached persistent variables are written back to the
+    // database when the outermost message handler returns.
+    CachedScriptVar::Scope cached_vars;
+
+    // Credit any allocations made while handling this message to this
+    // script's class in the allocator statistics.
+    if(!mem_owner)
+        mem_owner = g_Allocator.RegisterOwner(Name());
+    uint outer_owner = g_Allocator.SetOwner(mem_owner);
+
     cScript::ReceiveMessage(msg, reply, trace);
 
     if(trace == kSpew)
         debug_printf(DL_DEBUG, "Got message '%s' at '%d'", msg -> message, msg -> time);
 
+    // Messages can be sent to this script while it is handling another, so
+    // the ID of the outer message must be restored once this one is done.
+    int outer_id = message_id;
+    message_id = MessageNames::lookup(msg -> message);
+
     message_time = msg -> time;
-    if(!::_stricmp(msg -> message, "Sim"))
+
+    // Every script receives Sim when the sim starts, but module-wide state
+    // only needs to be reset by the first of them.
+    bool sim_starting = false;
+    if(message_id == MSGID_SIM)
     {
-        sim_running = static_cast<sSimMsg*>(msg) -> fStarting;
+        sim_running  = static_cast<sSimMsg*>(msg) -> fStarting;
+        sim_starting = sim_running && !sim_started;
+        sim_started  = sim_running;
+    }
+
+    // The script database may have been replaced by a loaded game before the
+    // first script begins, or by the editor when the sim starts, so cached
+    // persistent variables need to be fetched again. Objects created during
+    // play get BeginScript too, so that only counts after a load.
+    if(sim_starting || (message_id == MSGID_BEGINSCRIPT && reload_pending)) {
+        reload_pending = false;
+        CachedScriptVar::invalidate_all();
+        QVarShadow::refresh();
+    }
+
+    // Link flavours, archetypes, and their names can only change while the sim is not running (in the editor)
+    if(sim_starting) {
+        LinkFlavours::invalidate();
+        ArchetypeIndex::get().invalidate();
+        ObjectNames::invalidate();
+        QVarShadow::invalidate();
+        SharedConfig::invalidate();
+        SpatialIndex::get().clear();
     }
 
+    // An object with a TWScript may have been created or destroyed, which
+    // radius searches later in this frame need to see.
+    else if(message_id == MSGID_BEGINSCRIPT || message_id == MSGID_ENDSCRIPT)
+        SpatialIndex::get().invalidate();
+
+    // Keep shadowed QVars up to date, and stop relying on subscriptions made
+    // by scripts that have gone away.
+    if(message_id == MSGID_QUESTCHANGE)
+        QVarShadow::changed(static_cast<sQuestMsg*>(msg));
+    else if(message_id == MSGID_ENDSCRIPT)
+        QVarShadow::host_ended(ObjId());
+
     try {
         // Ensure that reply is always available, even if ReceiveMessage was called with it NULL
         sMultiParm fallback;
@@ -60,6 +134,9 @@ STDMETHODIMP TWBaseScript::ReceiveMessage(sScrMsg* msg, sMultiParm* reply, eScrT
         result = S_FALSE;
     }
 
+    message_id = outer_id;
+    g_Allocator.SetOwner(outer_owner);
+
     return result;
 }
 
@@ -72,8 +149,19 @@ TWBaseScript::MsgStatus TWBaseScript::on_message(sScrMsg* msg, cMultiParm& reply
 {
     // Handle setting up the script from the design note
     if(!done_init) {
-        init(msg -> time);
-        done_init = true;
+        // Every script receives these broadcasts when a mission starts, a
+        // saved game is loaded, or the game returns from a menu, so the init
+        // can wait for the scheduler to reach the script. Traps may be set
+        // to fire on them, so they are still handled once the init has run.
+        if(((message_id == MSGID_SIM && sim_running) ||
+            message_id == MSGID_BEGINSCRIPT ||
+            message_id == MSGID_DARKGAMEMODECHANGE) &&
+           InitScheduler::get().defer(this, ObjId(), msg -> time)) {
+            hold_message(msg);
+            return MS_HALT;
+        }
+
+        run_init(msg);
     }
 
     return MS_CONTINUE;
@@ -108,6 +196,42 @@ void TWBaseScript::cancel_timed_message(tScrTimer timer)
 }
 
 
+void TWBaseScript::schedule_poll(const char* name, uint delay, bool stagger)
+{
+    uint start = message_time;
+
+    if(in_poll) {
+        // Keep to the original phase, unless the poll has fallen a whole
+        // period behind.
+        if(poll_fired + delay > message_time)
+            start = poll_fired;
+    } else if(stagger && delay > 1) {
+        uint phase = (static_cast<uint>(ObjId()) * 2654435761U) >> 16;
+        delay -= phase % (delay / 2 + 1);
+    }
+
+    // The name is interned so that the wheel can hand the same pointer back
+    // in the timer message, and so changes are easy to spot.
+    const char* interned = MessageNames::name(MessageNames::intern(name));
+    if(interned != poll_name) {
+        poll_name = interned;
+        set_script_data("PollName", poll_name);
+    }
+
+    poll_due = start + delay;
+    TimerWheel::get().schedule(this, ObjId(), message_time, start + delay);
+}
+
+
+void TWBaseScript::cancel_poll()
+{
+    TimerWheel::get().cancel(this);
+
+    if(poll_due.Valid())
+        poll_due.Clear();
+}
+
+
 /* ------------------------------------------------------------------------
  *  Script data handling
  */
@@ -154,7 +278,7 @@ bool TWBaseScript::clear_script_data(const char* name, cMultiParm& data)
 void TWBaseScript::debug_printf(TWBaseScript::DebugLevel level, const char* format, ...)
 {
     va_list args;
-    std::string name;
+    ScratchString name;
     char buffer[900]; // Temporary buffer, 900 is the limit imposed by MPrint. This is really nasty and needs fixing.
 
     // Need the name of the current object
@@ -170,7 +294,7 @@ void TWBaseScript::debug_printf(TWBaseScript::DebugLevel level, const char* form
 }
 
 
-void TWBaseScript::get_object_namestr(std::string& name, object obj_id)
+void TWBaseScript::get_object_namestr(ScratchString& name, object obj_id)
 {
     char namebuffer[NAME_BUFFER_SIZE];
 
@@ -179,7 +303,7 @@ void TWBaseScript::get_object_namestr(std::string& name, object obj_id)
     // using the version of GetName in ObjectSrv... Probably. Maybe. >.<
     // The docs for this are pretty shit, so this is mostly guesswork.
 
-    SInterface<IObjectSystem> ObjSys(g_pScriptManager);
+    SInterface<IObjectSystem>& ObjSys = ScriptServices::object_system();
     const char* obj_name = ObjSys -> GetName(obj_id);
 
     // If the object system has returned a name here, the concrete object
@@ -190,7 +314,7 @@ void TWBaseScript::get_object_namestr(std::string& name, object obj_id)
     // Otherwise, the concrete object has no name, get its archetype name
     // if possible and use that instead.
     } else {
-        SInterface<ITraitManager> TraitMan(g_pScriptManager);
+        SInterface<ITraitManager>& TraitMan = ScriptServices::trait_manager();
         object archetype_id = TraitMan -> GetArchetype(obj_id);
         const char* archetype_name = ObjSys -> GetName(archetype_id);
 
@@ -208,7 +332,7 @@ void TWBaseScript::get_object_namestr(std::string& name, object obj_id)
 }
 
 
-void TWBaseScript::get_object_namestr(std::string& name)
+void TWBaseScript::get_object_namestr(ScratchString& name)
 {
     get_object_namestr(name, ObjId());
 }
@@ -220,41 +344,9 @@ void TWBaseScript::get_object_namestr(std::string& name)
 
 int TWBaseScript::get_qvar_value(std::string& qvar, int def_val)
 {
-    int value = def_val;
-    char  op;
-    char* lhs_qvar, *rhs_data, *endstr = NULL;
-    char* buffer = parse_qvar(qvar.c_str(), &lhs_qvar, &op, &rhs_data);
-
-    if(buffer) {
-        value = get_qvar(lhs_qvar, def_val);
-
-        // If an operation and right hand side value/qvar were found, use them
-        if(op && rhs_data) {
-            int adjval = 0;
-
-            // Is the RHS a qvar itself? If so, fetch it, otherwise treat it as an int
-            if(*rhs_data == '$') {
-                adjval = get_qvar(&rhs_data[1], 0);
-            } else {
-                adjval = strtol(rhs_data, &endstr, 10);
-            }
-
-            // If a value was parsed in some way, apply it (this also avoids
-            // division-by-zero problems for / )
-            if(endstr != rhs_data && adjval) {
-                switch(op) {
-                    case('+'): value += adjval; break;
-                    case('-'): value -= adjval; break;
-                    case('*'): value *= adjval; break;
-                    case('/'): value /= adjval; break;
-                }
-            }
-        }
-
-        delete[] buffer;
-    }
-
-    return value;
+    // Expressions are compiled the first time they are seen, so this only
+    // needs to fetch the QVars and do the arithmetic.
+    return QVarExpr::compiled(qvar).evaluate(def_val, ObjId());
 }
 
 
@@ -263,41 +355,9 @@ int TWBaseScript::get_qvar_value(std::string& qvar, int def_val)
 // different features in future, so I'm leaving the duplication for now...
 float TWBaseScript::get_qvar_value(std::string& qvar, float def_val)
 {
-    float value = def_val;
-    char  op;
-    char* lhs_qvar, *rhs_data, *endstr = NULL;
-    char* buffer = parse_qvar(qvar.c_str(), &lhs_qvar, &op, &rhs_data);
-
-    if(buffer) {
-        value = get_qvar(lhs_qvar, def_val);
-
-        // If an operation and right hand side value/qvar were found, use them
-        if(op && rhs_data) {
-            float adjval = 0;
-
-            // Is the RHS a qvar itself? If so, fetch it, otherwise treat it as an int
-            if(*rhs_data == '$') {
-                adjval = get_qvar(&rhs_data[1], 0.0f);
-            } else {
-                adjval = strtof(rhs_data, &endstr);
-            }
-
-            // If a value was parsed in some way, apply it (this also avoids
-            // division-by-zero problems for / )
-            if(endstr != rhs_data && adjval) {
-                switch(op) {
-                    case('+'): value += adjval; break;
-                    case('-'): value -= adjval; break;
-                    case('*'): value *= adjval; break;
-                    case('/'): value /= adjval; break;
-                }
-            }
-        }
-
-        delete[] buffer;
-    }
-
-    return value;
+    // Expressions are compiled the first time they are seen, so this only
+    // needs to fetch the QVars and do the arithmetic.
+    return QVarExpr::compiled(qvar).evaluate(def_val, ObjId());
 }
 
 
@@ -305,6 +365,14 @@ float TWBaseScript::get_qvar_value(std::string& qvar, float def_val)
  *  Design note support
  */
 
+void TWBaseScript::get_key_qvar(const DesignNote& note, const DesignNote::Key& key, std::string& qvar_str)
+{
+    // Everything after the '$' is the QVar expression
+    note.value(key, qvar_str);
+    qvar_str.erase(0, qvar_str.find('$') + 1);
+}
+
+
 float TWBaseScript::parse_float(const char* param, float def_val, std::string& qvar_str)
 {
     float result = def_val;
@@ -336,37 +404,37 @@ float TWBaseScript::parse_float(const char* param, float def_val, std::string& q
 }
 
 
-void TWBaseScript::get_scriptparam_valuefalloff(char* design_note, const char* param, int* value, int* falloff, bool* limit)
+void TWBaseScript::get_scriptparam_valuefalloff(const DesignNote& note, const char* param, int* value, int* falloff, bool* limit)
 {
     std::string workstr = param;
     std::string dummy;
 
     // Get the value
     if(value) {
-        *value = get_scriptparam_int(design_note, param, 0, dummy);
+        *value = get_scriptparam_int(note, param, 0, dummy);
     }
 
     // Allow uses to fall off over time
     if(falloff) {
         workstr += "Falloff";
-        *falloff = get_scriptparam_int(design_note, workstr.c_str(), 0, dummy);
+        *falloff = get_scriptparam_int(note, workstr.c_str(), 0, dummy);
     }
 
     // And allow counting to be limited
     if(limit) {
         workstr = param;
         workstr += "Limit";
-        *limit = get_scriptparam_bool(design_note, workstr.c_str());
+        *limit = get_scriptparam_bool(note, workstr.c_str());
     }
 }
 
 
-TWBaseScript::CountMode TWBaseScript::get_scriptparam_countmode(char* design_note, const char* param, CountMode def_mode)
+TWBaseScript::CountMode TWBaseScript::get_scriptparam_countmode(const DesignNote& note, const char* param, CountMode def_mode)
 {
     TWBaseScript::CountMode result = def_mode;
 
     // Get the value the editor has set for countonly (or the default) and process it
-    char* mode = get_scriptparam_string(design_note, param, "Both");
+    char* mode = get_scriptparam_string(note, param, "Both");
     if(mode) {
         char* end = NULL;
 
@@ -396,124 +464,154 @@ TWBaseScript::CountMode TWBaseScript::get_scriptparam_countmode(char* design_not
 }
 
 
-float TWBaseScript::get_scriptparam_float(const char* design_note, const char* param, float def_val, std::string& qvar_str)
+float TWBaseScript::get_scriptparam_float(const DesignNote& note, const char* param, float def_val, std::string& qvar_str)
 {
-    float result = def_val;
+    const DesignNote::Key* key = note.lookup(Name(), param);
 
-    // Fetch the value as a string, if possible
-    char* value = get_scriptparam_string(design_note, param);
-    if(value) {
-        result = parse_float(value, def_val, qvar_str);
+    // The value was parsed when the note was indexed, so only QVars need more work
+    if(!key || !(key -> flags & DesignNote::KEY_VALUE))
+        return def_val;
 
-        g_pMalloc -> Free(value);
+    if(key -> flags & DesignNote::KEY_QVAR) {
+        get_key_qvar(note, *key, qvar_str);
+        return get_qvar_value(qvar_str, def_val);
     }
 
-    return result;
+    return (key -> flags & DesignNote::KEY_FLOAT) ? key -> fval : def_val;
 }
 
 
-int TWBaseScript::get_scriptparam_int(const char* design_note, const char* param, int def_val, std::string& qvar_str)
+int TWBaseScript::get_scriptparam_int(const DesignNote& note, const char* param, int def_val, std::string& qvar_str)
 {
-    int result = def_val;
-    char* value = get_scriptparam_string(design_note, param);
-
-    if(value) {
-        char* workptr = value;
+    const DesignNote::Key* key = note.lookup(Name(), param);
 
-        // Skip any leading whitespace
-        while(isspace(*workptr)) {
-            ++workptr;
-        }
+    if(!key || !(key -> flags & DesignNote::KEY_VALUE))
+        return def_val;
 
-        // If the string starts with a '$', it is a qvar, in theory
-        if(*workptr == '$') {
-            qvar_str = &param[1];
-            result = get_qvar_value(qvar_str, def_val);
-        } else {
-            char* endstr;
-            result = strtol(workptr, &endstr, 10);
-
-            // Restore the default if parsing failed
-            if(endstr == workptr) result = def_val;
-        }
-
-        g_pMalloc -> Free(value);
+    if(key -> flags & DesignNote::KEY_QVAR) {
+        get_key_qvar(note, *key, qvar_str);
+        return get_qvar_value(qvar_str, def_val);
     }
 
-    return result;
+    return (key -> flags & DesignNote::KEY_INT) ? key -> ival : def_val;
 }
 
 
-int TWBaseScript::get_scriptparam_time(const char* design_note, const char* param, int def_val, std::string& qvar_str)
+int TWBaseScript::get_scriptparam_time(const DesignNote& note, const char* param, int def_val, std::string& qvar_str)
 {
+    const DesignNote::Key* key = note.lookup(Name(), param);
+
+    if(!key || !(key -> flags & DesignNote::KEY_VALUE))
+        return def_val;
+
     // float is used internally for time handling, as the user may specify fractional
     // seconds or minutes
     float result = float(def_val);
-    char* value = get_scriptparam_string(design_note, param);
 
-    if(value) {
-        char* workptr = value;
+    if(key -> flags & DesignNote::KEY_QVAR) {
+        get_key_qvar(note, *key, qvar_str);
+        result = get_qvar_value(qvar_str, float(def_val));
 
-        // Skip any leading whitespace
-        while(isspace(*workptr)) ++workptr;
+    } else if(key -> flags & DesignNote::KEY_FLOAT) {
+        result = key -> fval;
 
-        // If the string starts with a '$', it is a qvar, in theory
-        if(*workptr == '$') {
-            qvar_str = &param[1];
-            result = get_qvar_value(qvar_str, float(def_val));
-        } else {
-            char* endstr;
-            result = strtof(workptr, &endstr);
+        // 's' indicates the time is in seconds, 'm' minutes, multiply up to milliseconds
+        if(key -> flags & DesignNote::KEY_SECONDS) {
+            result *= 1000.0f;
+        } else if(key -> flags & DesignNote::KEY_MINUTES) {
+            result *= 60000.0f;
+        }
+    }
 
-            // Restore the default if parsing failed
-            if(endstr == workptr) {
-                result = def_val;
+    // Drop the fractional part on the way out - here result is in integer milliseconds
+    return int(result);
+}
 
-            // otherwise, see if the character at the end is something we recognise
-            } else if(*endstr) {
-                // skip spaces, just in case
-                while(isspace(*workptr)) ++workptr;
 
-                switch(*endstr) {
-                    // 's' indicates the time is in seconds, multiply up to milliseconds
-                    case 's': result *= 1000.0f; break;
+float TWBaseScript::get_scriptparam_float(const DesignNote& note, const char* param, float def_val, QVarParam<float>& dest)
+{
+    std::string qvar_str;
+    float result = get_scriptparam_float(note, param, def_val, qvar_str);
 
-                    // 'm' indicates the time is in minutes, multiply up to milliseconds
-                    case 'm': result *= 60000.0f; break;
-                }
-            }
-        }
+    dest.bind(result, qvar_str, ObjId());
 
-        g_pMalloc -> Free(value);
-    }
+    return result;
+}
 
-    // Drop the fractional part on the way out - here result is in integer milliseconds
-    return int(result);
+
+int TWBaseScript::get_scriptparam_int(const DesignNote& note, const char* param, int def_val, QVarParam<int>& dest)
+{
+    std::string qvar_str;
+    int result = get_scriptparam_int(note, param, def_val, qvar_str);
+
+    dest.bind(result, qvar_str, ObjId());
+
+    return result;
 }
 
 
-bool TWBaseScript::get_scriptparam_bool(const char* design_note, const char* param, bool def_val)
+int TWBaseScript::get_scriptparam_time(const DesignNote& note, const char* param, int def_val, QVarParam<int>& dest)
 {
-    std::string namestr = Name();
-    namestr += param;
+    std::string qvar_str;
+    int result = get_scriptparam_time(note, param, def_val, qvar_str);
+
+    dest.bind(result, qvar_str, ObjId());
 
-    return GetParamBool(design_note, namestr.c_str(), def_val);
+    return result;
 }
 
 
-char* TWBaseScript::get_scriptparam_string(const char* design_note, const char* param, const char* def_val)
+bool TWBaseScript::get_scriptparam_bool(const DesignNote& note, const char* param, bool def_val)
 {
-    std::string namestr = Name();
-    namestr += param;
+    const DesignNote::Key* key = note.lookup(Name(), param);
+    if(!key)
+        return def_val;
+
+    // As with GetParamBool, a parameter with no value is true, and anything
+    // that isn't a word starting with t, y, f, or n is read as a number.
+    if(!(key -> flags & DesignNote::KEY_VALUE) || !key -> value_length)
+        return true;
+
+    switch(*note.value_text(*key)) {
+        case 't': case 'T': case 'y': case 'Y': return true;
+        case 'f': case 'F': case 'n': case 'N': return false;
+    }
+
+    return (key -> flags & DesignNote::KEY_INT) ? (key -> ival != 0) : def_val;
+}
+
+
+char* TWBaseScript::get_scriptparam_string(const DesignNote& note, const char* param, const char* def_val)
+{
+    const DesignNote::Key* key = note.lookup(Name(), param);
+
+    // The value was located when the note was indexed, so it only needs copying
+    const char* value;
+    size_t length;
+    if(key && (key -> flags & DesignNote::KEY_VALUE)) {
+        value  = note.value_text(*key);
+        length = key -> value_length;
+    } else if(def_val) {
+        value  = def_val;
+        length = strlen(def_val);
+    } else {
+        return NULL;
+    }
+
+    char* result = static_cast<char*>(g_pMalloc -> Alloc(length + 1));
+    if(result) {
+        memcpy(result, value, length);
+        result[length] = '\0';
+    }
 
-    return GetParamString(design_note, namestr.c_str(), def_val);
+    return result;
 }
 
 
-bool TWBaseScript::get_scriptparam_floatvec(const char* design_note, const char* param, cScrVec& vect, float defx, float defy, float defz)
+bool TWBaseScript::get_scriptparam_floatvec(const DesignNote& note, const char* param, cScrVec& vect, float defx, float defy, float defz)
 {
     bool parsed = false;
-    char* value = get_scriptparam_string(design_note, param, NULL);
+    char* value = get_scriptparam_string(note, param, NULL);
 
     if(value) {
         char* ystr = comma_split(value);              // Getting y is safe...
@@ -567,7 +665,8 @@ void TWBaseScript::init(int time)
     char* design_note = GetObjectParams(ObjId());
 
     if(design_note) {
-        debug = get_scriptparam_bool(design_note, "Debug");
+        const DesignNote& note = DesignNote::index(design_note);
+        debug = get_scriptparam_bool(note, "Debug");
 
         if(debug_enabled()) {
             debug_printf(DL_DEBUG, "Attached %s version %s", Name(), SCRIPT_VERSTRING);
@@ -592,12 +691,12 @@ long TWBaseScript::dispatch_message(sScrMsg* msg, sMultiParm* reply)
     // Only bother checking for fixup stuff if it hasn't been done.
     if(need_fixup) {
         // On starting sim, fix any links if possible
-        if(!::_stricmp(msg -> message, "Sim") && static_cast<sSimMsg*>(msg) -> fStarting) {
+        if(message_id == MSGID_SIM && static_cast<sSimMsg*>(msg) -> fStarting) {
             fixup_player_links();
 
         // Catch and handle the deferred player link fixup if needed
-        } else if(!::_stricmp(msg -> message, "Timer") &&
-                  !::_stricmp(static_cast<sScrTimerMsg*>(msg) -> name, "DelayInit") &&
+        } else if(message_id == MSGID_TIMER &&
+                  MessageNames::lookup(static_cast<sScrTimerMsg*>(msg) -> name) == MSGID_DELAYINIT &&
                   static_cast<sScrTimerMsg*>(msg) -> data == "FixupPlayerLinks") { // Note: data is a cMultiParm, so == does a strcmp internally
             fixup_player_links();
         }
@@ -605,7 +704,33 @@ long TWBaseScript::dispatch_message(sScrMsg* msg, sMultiParm* reply)
 
     // Capture and bin Null messages (to prevent TornOn/TurnOff triggering in
     // subclasses when the TirnOn/TurnOff message has been set to Null)
-    if(!::_stricmp(msg -> message, "Null")) {
+    if(message_id == MSGID_NULL) {
+        return S_OK;
+    }
+
+    // The timer wheel's own timer is never passed on to subclasses.
+    if(message_id == MSGID_TIMER &&
+       MessageNames::lookup(static_cast<sScrTimerMsg*>(msg) -> name) == MSGID_WHEELTICK) {
+        TimerWheel::get().tick(static_cast<sScrTimerMsg*>(msg));
+        return S_OK;
+    }
+
+    // The init scheduler's timer is only used to run a deferred init.
+    if(message_id == MSGID_TIMER &&
+       MessageNames::lookup(static_cast<sScrTimerMsg*>(msg) -> name) == MSGID_DEFERREDINIT) {
+        if(!done_init)
+            run_init(msg);
+        return S_OK;
+    }
+
+    // Scripts are recreated when a saved game is loaded, so any polling
+    // timer they had pending needs to go back on the wheel.
+    if(message_id == MSGID_BEGINSCRIPT)
+        restore_poll();
+
+    // Any script can be asked to write out the module's allocation statistics.
+    if(message_id == MSGID_DUMPMEMSTATS) {
+        dump_memory_stats((msg -> data.type == kMT_String) ? static_cast<const char*>(msg -> data) : NULL);
         return S_OK;
     }
 
@@ -614,59 +739,310 @@ long TWBaseScript::dispatch_message(sScrMsg* msg, sMultiParm* reply)
 }
 
 
+void TWBaseScript::on_wheel_timer(sScrTimerMsg* tick, uint due)
+{
+    // The poll has been consumed; the handler will schedule another if needed.
+    poll_due.Clear();
+
+    sScrTimerMsg timer(*tick);
+    timer.to   = ObjId();
+    timer.name = poll_name;
+
+    bool outer_in_poll = in_poll;
+    uint outer_fired   = poll_fired;
+    in_poll    = true;
+    poll_fired = due;
+
+    cMultiParm reply;
+    ReceiveMessage(&timer, &reply, kNoAction);
+
+    in_poll    = outer_in_poll;
+    poll_fired = outer_fired;
+}
+
+
+void TWBaseScript::run_init(sScrMsg* msg)
+{
+    InitScheduler::get().cancel(this);
+
+    init(msg -> time);
+    done_init = true;
+
+    // init may have interned message names, including possibly this one
+    if(message_id == MSGID_UNKNOWN)
+        message_id = MessageNames::lookup(msg -> message);
+
+    if(halted.empty())
+        return;
+
+    // Messages held back while the init was deferred arrived before this
+    // one, so they are handled first. ReceiveMessage restores the message
+    // ID, but not the time.
+    uint outer_time = message_time;
+    std::vector<sScrMsg*> pending;
+    pending.swap(halted);
+
+    for(std::vector<sScrMsg*>::iterator it = pending.begin(); it != pending.end(); ++it) {
+        cMultiParm reply;
+        ReceiveMessage(*it, &reply, kNoAction);
+    }
+
+    message_time = outer_time;
+
+    // Nothing can be held back once the init has run, so halted is empty
+    halted.swap(pending);
+    discard_halted();
+}
+
+
+void TWBaseScript::hold_message(sScrMsg* msg)
+{
+    sScrMsg* copy;
+
+    switch(message_id) {
+        case MSGID_SIM:                copy = new sSimMsg(*static_cast<sSimMsg*>(msg)); break;
+        case MSGID_DARKGAMEMODECHANGE: copy = new sDarkGameModeScrMsg(*static_cast<sDarkGameModeScrMsg*>(msg)); break;
+        default:                       copy = new sScrMsg(*msg); break;
+    }
+
+    // The engine's copy of the name may not outlive the message
+    copy -> message = MessageNames::name(message_id);
+    halted.push_back(copy);
+}
+
+
+void TWBaseScript::discard_halted()
+{
+    for(std::vector<sScrMsg*>::iterator it = halted.begin(); it != halted.end(); ++it) {
+        switch(MessageNames::lookup((*it) -> message)) {
+            case MSGID_SIM:                delete static_cast<sSimMsg*>(*it); break;
+            case MSGID_DARKGAMEMODECHANGE: delete static_cast<sDarkGameModeScrMsg*>(*it); break;
+            default:                       delete *it; break;
+        }
+    }
+
+    halted.clear();
+}
+
+
+void TWBaseScript::on_deferred_init(sScrTimerMsg* tick)
+{
+    sScrTimerMsg timer(*tick);
+    timer.to   = ObjId();
+    timer.name = MessageNames::name(MSGID_DEFERREDINIT);
+
+    cMultiParm reply;
+    ReceiveMessage(&timer, &reply, kNoAction);
+}
+
+
+void TWBaseScript::restore_poll()
+{
+    if(poll_scheduled() || !poll_due.Valid())
+        return;
+
+    cMultiParm name;
+    if(!get_script_data("PollName", name) || name.type != kMT_String) {
+        poll_due.Clear();
+        return;
+    }
+
+    poll_name = MessageNames::name(MessageNames::intern(static_cast<const char*>(name)));
+    TimerWheel::get().schedule(this, ObjId(), message_time, static_cast<uint>(int(poll_due)));
+}
+
+
+void TWBaseScript::dump_memory_stats(const char* filename)
+{
+    FILE* out = NULL;
+    if(filename && *filename) {
+        out = fopen(filename, "a");
+        if(!out) {
+            debug_printf(DL_WARNING, "Unable to open '%s' for writing", filename);
+            return;
+        }
+    }
+
+    char line[128];
+    cMemoryAllocator::UsageStats stats;
+
+    // Write a line either to the file or to the monolog
+    #define DUMP_LINE(...) do { snprintf(line, sizeof(line), __VA_ARGS__); \
+                                if(out) fprintf(out, "%s\n", line); else g_pfnMPrintf("%s\n", line); } while(0)
+
+    DUMP_LINE("TWScript memory at %u: %lu blocks for %lu bytes, peak %lu bytes", message_time,
+              g_Allocator.CountBlocks(), g_Allocator.CountSize(), g_Allocator.CountPeakSize());
+    DUMP_LINE("  %lu allocations, average %lu bytes, %lu reallocations", g_Allocator.CountAlloc(), g_Allocator.CountAverage(),
+              g_Allocator.CountRealloc());
+
+    DUMP_LINE("  Size         live     peak        total        bytes    peakbytes");
+    for(uint sizeclass = 0; sizeclass < g_Allocator.CountSizeClasses(); ++sizeclass) {
+        if(g_Allocator.GetSizeStats(sizeclass, stats) && (stats.total || stats.live)) {
+            if(stats.maxsize == static_cast<ulong>(-1)) {
+                DUMP_LINE("  larger  %8lu %8lu %12lu %12lu %12lu", stats.live, stats.peak, stats.total, stats.bytes, stats.peakbytes);
+            } else {
+                DUMP_LINE("  <=%-5lu %8lu %8lu %12lu %12lu %12lu", stats.maxsize, stats.live, stats.peak, stats.total, stats.bytes, stats.peakbytes);
+            }
+        }
+    }
+
+    DUMP_LINE("  Owner                    live     peak        total        bytes    peakbytes");
+    for(uint owner = 0; owner < g_Allocator.CountOwners(); ++owner) {
+        if(g_Allocator.GetOwnerStats(owner, stats)) {
+            DUMP_LINE("  %-20s %8lu %8lu %12lu %12lu %12lu", stats.name, stats.live, stats.peak, stats.total, stats.bytes, stats.peakbytes);
+        }
+    }
+
+    #undef DUMP_LINE
+
+    if(out)
+        fclose(out);
+}
+
+
 /* ------------------------------------------------------------------------
  *  Targetting
  */
 
-std::vector<TargetObj>* TWBaseScript::get_target_objects(const char* target, sScrMsg* msg)
+bool TWBaseScript::compile_target_query(const char* target, TargetQuery& query)
 {
-    std::vector<TargetObj>* matches = new std::vector<TargetObj>;
+    query = TargetQuery();
 
     // Make sure target is actually set before doing anything
-    if(!target || *target == '\0') return matches;
+    if(!target || *target == '\0') return false;
 
-    float radius;
-    bool  lessthan;
-    const char* archname;
-    TargetObj newtarget = { 0, 0 };
+    query.text = target;
 
     // Simple target/source selection.
     if(!_stricmp(target, "[me]")) {
-        newtarget.obj_id = msg -> to;
-        matches -> push_back(newtarget);
+        query.type = TT_ME;
 
     } else if(!_stricmp(target, "[source]")) {
-        newtarget.obj_id = msg -> from;
-        matches -> push_back(newtarget);
+        query.type = TT_SOURCE;
 
     // linked objects
     } else if(*target == '&') {
-        link_search(matches, ObjId(), &target[1]);
+        query.type = TT_LINK;
+        query.name = link_search_setup(&target[1], &query.is_random, &query.is_weighted, &query.fetch_count, &query.fetch_all, &query.no_repeat, &query.link_mode);
 
     // Archetype search, direct concrete and indirect concrete
     } else if(*target == '*' || *target == '@') {
-        archetype_search(matches, &target[1], *target == '@');
+        query.type    = TT_ARCHETYPE;
+        query.name    = &target[1];
+        query.do_full = (*target == '@');
 
     // Radius archetype search
     } else if(*target == '<' || *target == '>') {
-        if(radius_search(target, &radius, &lessthan, &archname)) {
-            const char* realname = archname;
-            // Jump filter controls if needed...
-            if(*archname == '*' || *archname == '@') ++realname;
+        const char* archname;
+
+        if(!radius_search(target, &query.radius, &query.lessthan, &archname)) {
+            query.type = TT_NONE;
+            return false;
+        }
 
-            // Default behaviour for radius search is to get all decendants unless * is specified.
-            archetype_search(matches, realname, *archname != '*', true, msg -> to, radius, lessthan);
+        query.type = TT_RADIUS;
+
+        // Nearest-N counts and sorting may appear before the archetype
+        while(*archname == '[' || *archname == '^') {
+            if(*archname == '^') {
+                query.sorted = true;
+            } else {
+                archname = parse_link_count(archname, &query.fetch_count);
+            }
+            ++archname;
         }
-    // Named destination object
+
+        // Jump filter controls if needed...
+        query.name = (*archname == '*' || *archname == '@') ? &archname[1] : archname;
+
+        // Default behaviour for radius search is to get all decendants unless * is specified.
+        query.do_full = (*archname != '*');
+
+    // Named destination object. This is looked up when the query is run, as the
+    // object may not exist yet.
     } else {
-        SInterface<IObjectSystem> ObjectSys(g_pScriptManager);
+        query.type = TT_NAMED;
+        query.name = target;
+    }
 
-        newtarget.obj_id = ObjectSys -> GetObjectNamed(target);
-        if(newtarget.obj_id)
-            matches -> push_back(newtarget);
+    // Link flavours and archetypes don't come and go during the game, so they can be resolved now.
+    resolve_target_query(query);
+
+    return true;
+}
+
+
+void TWBaseScript::resolve_target_query(const TargetQuery& query)
+{
+    // LinkFlavours, ArchetypeIndex, and ObjectNames are all invalidated together,
+    // so the flavour generation shows whether the IDs may be stale.
+    uint current = LinkFlavours::generation();
+    if(query.generation == current) return;
+
+    query.generation = current;
+
+    if(query.type == TT_LINK) {
+        query.flavour_id = LinkFlavours::id(query.name.c_str());
+
+    } else if(query.type == TT_ARCHETYPE || query.type == TT_RADIUS) {
+        SInterface<IObjectSystem>& ObjectSys = ScriptServices::object_system();
+
+        query.archetype = ObjectSys -> GetObjectNamed(query.name.c_str());
+    }
+}
+
+
+void TWBaseScript::get_target_objects(std::vector<TargetObj>& matches, const TargetQuery& query, sScrMsg* msg)
+{
+    TargetObj newtarget = { 0, 0 };
+
+    // Clearing keeps the vector's storage, so reusing a vector avoids reallocation
+    matches.clear();
+
+    resolve_target_query(query);
+
+    switch(query.type) {
+        case TT_ME:
+            newtarget.obj_id = msg -> to;
+            matches.push_back(newtarget);
+            break;
+
+        case TT_SOURCE:
+            newtarget.obj_id = msg -> from;
+            matches.push_back(newtarget);
+            break;
+
+        case TT_LINK:
+            run_link_query(&matches, ObjId(), query);
+            break;
+
+        case TT_ARCHETYPE:
+            archetype_search(&matches, query.archetype, query.do_full);
+            break;
+
+        case TT_RADIUS:
+            archetype_search(&matches, query.archetype, query.do_full, true, msg -> to, query.radius, query.lessthan, query.fetch_count, query.sorted);
+            break;
+
+        case TT_NAMED: {
+                newtarget.obj_id = ObjectNames::id(query.name.c_str());
+                if(newtarget.obj_id)
+                    matches.push_back(newtarget);
+            }
+            break;
+
+        case TT_NONE:
+            break;
     }
+}
+
+
+void TWBaseScript::get_target_objects(std::vector<TargetObj>& matches, const char* target, sScrMsg* msg)
+{
+    TargetQuery query;
 
-    return matches;
+    compile_target_query(target, query);
+    get_target_objects(matches, query, msg);
 }
 
 
@@ -676,24 +1052,38 @@ std::vector<TargetObj>* TWBaseScript::get_target_objects(const char* target, sSc
 
 void TWBaseScript::link_search(std::vector<TargetObj>* matches, const int from, const char* linkdef)
 {
-    std::vector<LinkScanWorker> links;
-    bool is_random = false, is_weighted = false, fetch_all = false;;
-    uint fetch_count = 0;
-    LinkMode mode = LM_BOTH;
+    TargetQuery query;
+    std::string target("&");
 
-    // Parse the link definition, and fetch the list of possible matching links
-    const char* flavour = link_search_setup(linkdef, &is_random, &is_weighted, &fetch_count, &fetch_all, &mode);
-    uint count = link_scan(flavour, from, is_weighted, mode, links);
+    // Link searches are just a special case of targetting, so reuse the compiler
+    target += linkdef;
+    compile_target_query(target.c_str(), query);
+
+    run_link_query(matches, from, query);
+}
+
+
+void TWBaseScript::run_link_query(std::vector<TargetObj>* matches, const int from, const TargetQuery& query)
+{
+    std::vector<LinkScanWorker>& links = link_scratch;
+
+    // Reuse the scratch list's storage rather than allocating a new list
+    links.clear();
+
+    resolve_target_query(query);
+
+    uint count = link_scan(query.flavour_id, from, query.is_weighted, query.link_mode, links);
 
     if(count) {
         // If no fetch count has been explicitly set, use the whole size, unless random is set
-        if(fetch_count < 1) fetch_count = is_random ? 1 : links.size();
+        uint fetch_count = query.fetch_count;
+        if(fetch_count < 1) fetch_count = query.is_random ? 1 : links.size();
 
         // if fetch_all has been set, set the count to the link count even in random mode
-        if(fetch_all) fetch_count = links.size();
+        if(query.fetch_all) fetch_count = links.size();
 
-        if(is_random) {
-            select_random_links(matches, links, fetch_count, fetch_all, count, is_weighted);
+        if(query.is_random) {
+            select_random_links(matches, links, fetch_count, query.fetch_all, count, query.is_weighted, query.no_repeat);
         } else {
             select_links(matches, links, fetch_count);
         }
@@ -701,7 +1091,7 @@ void TWBaseScript::link_search(std::vector<TargetObj>* matches, const int from,
 }
 
 
-const char* TWBaseScript::link_search_setup(const char* linkdef, bool* is_random, bool* is_weighted, uint* fetch_count, bool *fetch_all, LinkMode *mode)
+const char* TWBaseScript::link_search_setup(const char* linkdef, bool* is_random, bool* is_weighted, uint* fetch_count, bool *fetch_all, bool* no_repeat, LinkMode *mode)
 {
     while(*linkdef) {
         switch(*linkdef) {
@@ -713,6 +1103,10 @@ const char* TWBaseScript::link_search_setup(const char* linkdef, bool* is_random
             case '!': *fetch_all = true;
                 break;
 
+            // The ^ sigil prevents weighted mode from selecting a link more than once
+            case '^': *no_repeat = true;
+                break;
+
             // [ indicates the start of a [N] block, probably
             case '[': linkdef = parse_link_count(linkdef, fetch_count);
 
@@ -783,21 +1177,18 @@ const char* TWBaseScript::parse_link_count(const char* linkdef, uint* fetch_coun
 }
 
 
-uint TWBaseScript::link_scan(const char* flavour, const int from, const bool weighted, LinkMode mode, std::vector<LinkScanWorker>& links)
+uint TWBaseScript::link_scan(const long flavourid, const int from, const bool weighted, LinkMode mode, std::vector<LinkScanWorker>& links)
 {
-    // If there is no link flavour, do nothing
-    if(!flavour || !*flavour) return 0;
-
-    SService<ILinkToolsSrv> LinkToolsSrv(g_pScriptManager);
-
     uint accumulator = 0;
-    long flavourid =  LinkToolsSrv -> LinkKindNamed(flavour);
+    bool unsorted = false;
 
+    // If there is no link flavour, do nothing
     if(flavourid) {
         // At this point, we need to locate all the linked objects that match the flavour and mode
-        SService<ILinkSrv>      LinkSrv(g_pScriptManager);
+        SService<ILinkSrv>& LinkSrv = ScriptServices::link();
         linkset matching_links;
         LinkScanWorker temp = { 0, 0, 0, 0 };
+        int last_link = 0;
 
         // Traverse the list of links that match the selected flavour.
         LinkSrv -> GetAll(matching_links, flavourid, from, 0);
@@ -820,6 +1211,11 @@ uint TWBaseScript::link_scan(const char* flavour, const int from, const bool wei
                     accumulator += temp.weight;
                 }
 
+                // Note whether the links are arriving out of order
+                if(temp.link_id < last_link)
+                    unsorted = true;
+                last_link = temp.link_id;
+
                 links.push_back(temp);
             }
 
@@ -827,9 +1223,9 @@ uint TWBaseScript::link_scan(const char* flavour, const int from, const bool wei
         }
     }
 
-    // Ensure that the list is sorted by link IDs. In theory it already should be, but
-    // this will guarantee it.
-    if(links.size() > 0)
+    // Ensure that the list is sorted by link IDs. In theory it already should be,
+    // and the engine does return them in order, so only sort when it did not.
+    if(unsorted)
         std::sort(links.begin(), links.end());
 
     if(weighted) {
@@ -840,15 +1236,20 @@ uint TWBaseScript::link_scan(const char* flavour, const int from, const bool wei
 }
 
 
+// Ordering used to binary search a list of links by cumulative weight.
+static bool cumulative_less(const LinkScanWorker& link, const uint target)
+{
+    return link.cumulative < target;
+}
+
+
 bool TWBaseScript::pick_weighted_link(std::vector<LinkScanWorker>& links, const uint target, TargetObj& store)
 {
-    std::vector<LinkScanWorker>::iterator it;
+    std::vector<LinkScanWorker>::iterator it = std::lower_bound(links.begin(), links.end(), target, cumulative_less);
 
-    for(it = links.begin(); it < links.end(); it++) {
-        if((*it).cumulative >= target) {
-            store = *it;
-            return true;
-        }
+    if(it != links.end()) {
+        store = *it;
+        return true;
     }
 
     return false;
@@ -869,31 +1270,57 @@ uint TWBaseScript::build_link_weightsums(std::vector<LinkScanWorker>& links)
 }
 
 
-void TWBaseScript::select_random_links(std::vector<TargetObj>* matches, std::vector<LinkScanWorker>& links, const uint fetch_count, const bool fetch_all, const uint total_weights, const bool is_weighted)
+void TWBaseScript::select_random_links(std::vector<TargetObj>* matches, std::vector<LinkScanWorker>& links, const uint fetch_count, const bool fetch_all, const uint total_weights, const bool is_weighted, const bool no_repeat)
 {
-    // Yay for easy randomisation
-    std::shuffle(links.begin(), links.end(), randomiser);
-
     if(!is_weighted) {
         // Work out how many links to fetch, limiting it to the number available.
         uint count = fetch_all ? links.size() : fetch_count;
         if(count > links.size()) count = links.size();
 
+        // Partial Fisher-Yates shuffle: only the first count links need to be
+        // randomised, the rest of the list can be left alone.
+        for(uint pos = 0; pos < count; ++pos) {
+            std::uniform_int_distribution<size_t> pick(pos, links.size() - 1);
+            std::swap(links[pos], links[pick(randomiser)]);
+        }
+
         select_links(matches, links, count);
 
+    } else if(no_repeat) {
+        // Weighted sampling without replacement (Efraimidis and Spirakis): give each
+        // link the key log(u) / weight for a uniform random u in (0, 1], and take the
+        // links with the largest keys. This is a single pass over the links, rather
+        // than removing each link's weight from the total as it is chosen.
+        uint count = fetch_count;
+        if(count > links.size()) count = links.size();
+
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        ScratchVector<std::pair<double, size_t> >::type keys;
+        keys.reserve(links.size());
+
+        for(size_t pos = 0; pos < links.size(); ++pos) {
+            keys.push_back(std::make_pair(log(1.0 - unit(randomiser)) / links[pos].weight, pos));
+        }
+
+        std::partial_sort(keys.begin(), keys.begin() + count, keys.end(), std::greater<std::pair<double, size_t> >());
+
+        TargetObj chosen;
+        for(uint pass = 0; pass < count; ++pass) {
+            chosen = links[keys[pass].second];
+            matches -> push_back(chosen);
+        }
+
     } else {
         // Weighted selection needs cumulative weight information
-        if(is_weighted) build_link_weightsums(links);
+        build_link_weightsums(links);
 
+        std::uniform_int_distribution<uint> target(1, total_weights);
         TargetObj chosen;
 
         // Pick the requested number of links
         for(uint pass = 0; pass < fetch_count; ++pass) {
-            // Weighted mode needs more work to pick the item
-            pick_weighted_link(links, 1 + (randomiser() % total_weights), chosen);
-
-            // Store the chosen item
-            matches -> push_back(chosen);
+            if(pick_weighted_link(links, target(randomiser), chosen))
+                matches -> push_back(chosen);
         }
     }
 }
@@ -944,21 +1371,27 @@ bool TWBaseScript::radius_search(const char* target, float* radius, bool* lessth
 }
 
 
-void TWBaseScript::archetype_search(std::vector<TargetObj>* matches, const char* archetype, bool do_full, bool do_radius, object from_obj, float radius, bool lessthan)
+void TWBaseScript::archetype_search(std::vector<TargetObj>* matches, object arch, bool do_full, bool do_radius, object from_obj, float radius, bool lessthan, uint fetch_count, bool sorted)
 {
-    // Get handles to game interfaces here for convenience
-    SInterface<IObjectSystem> ObjectSys(g_pScriptManager);
-	SService<IObjectSrv>      ObjectSrv(g_pScriptManager);
-    SInterface<ITraitManager> TraitMgr(g_pScriptManager);
+    // Radius searches go through the spatial index, which avoids fetching the
+    // position of every descendant of the archetype every time.
+    if(do_radius) {
+        ScratchVector<int>::type found;
+        TargetObj newtarget = { 0, 0 };
 
-    // These are only needed when doing radius searches
-    cScrVec from_pos, to_pos;
-    float   distance;
-    if(do_radius) ObjectSrv -> Position(from_pos, from_obj);
+        SpatialIndex::get().search(found, arch, do_full, from_obj, radius, lessthan, fetch_count, sorted, message_time);
 
-    // Find the archetype named if possible
-    object arch = ObjectSys -> GetObjectNamed(archetype);
-    if(int(arch) <= 0) {
+        for(ScratchVector<int>::type::const_iterator it = found.begin(); it != found.end(); ++it) {
+            newtarget.obj_id = *it;
+            matches -> push_back(newtarget);
+        }
+        return;
+    }
+
+    SInterface<ITraitManager>& TraitMgr = ScriptServices::trait_manager();
+
+    // Only archetypes can be searched
+    if(int(arch) < 0) {
 
         // Build the query flags
         ulong flags = kTraitQueryChildren;
@@ -972,25 +1405,8 @@ void TWBaseScript::archetype_search(std::vector<TargetObj>* matches, const char*
             // Process each object, adding it to the match list if it's concrete.
             for(; !query -> Done(); query -> Next()) {
                 newtarget.obj_id = query -> Object();
-                if(newtarget.obj_id > 0) {
-
-                    // Object is concrete, do we need to check it for distance?
-                    if(do_radius) {
-                        // Get the provisionally matched object's position, and work out how far it
-                        // is from the 'from' object.
-                        ObjectSrv -> Position(to_pos, newtarget.obj_id);
-                        distance = (float)from_pos.Distance(to_pos);
-
-                        // If the distance check passes, store the object.
-                        if((lessthan && (distance < radius)) || (!lessthan && (distance > radius))) {
-                            matches -> push_back(newtarget);
-                        }
-
-                    // No radius check needed, add straight to the list
-                    } else {
-                        matches -> push_back(newtarget);
-                    }
-                }
+                if(newtarget.obj_id > 0)
+                    matches -> push_back(newtarget);
             }
         }
     }
@@ -1001,22 +1417,20 @@ void TWBaseScript::archetype_search(std::vector<TargetObj>* matches, const char*
  *  Link inspection
  */
 
-int TWBaseScript::get_linked_object(const int from, const std::string& obj_name, const std::string& link_name, const int fallback)
+int TWBaseScript::get_linked_object(const int from, const char* obj_name, const char* link_name, const int fallback)
 {
-    SInterface<IObjectSystem> ObjectSys(g_pScriptManager);
-    SService<IObjectSrv>      ObjectSrv(g_pScriptManager);
-    SService<ILinkSrv>        LinkSrv(g_pScriptManager);
-    SService<ILinkToolsSrv>   LinkToolsSrv(g_pScriptManager);
+    SService<ILinkSrv>& LinkSrv = ScriptServices::link();
 
     // Can't do anything if there is no archytype name set
-    if(!obj_name.empty()) {
+    if(obj_name && *obj_name) {
 
         // Attempt to locate the object requested
-        int object = StrToObject(obj_name.c_str());
+        // Names go through the cache, numeric IDs need no lookup at all
+        int object = (isdigit(static_cast<unsigned char>(obj_name[0])) || obj_name[0] == '-') ? StrToObject(obj_name) : ObjectNames::id(obj_name);
         if(object) {
 
             // Convert the link to a liny type ID
-            long flavourid = LinkToolsSrv -> LinkKindNamed(link_name.c_str());
+            long flavourid = LinkFlavours::id(link_name);
 
             if(flavourid) {
                 // Does the object have a link of the specified flavour?
@@ -1026,7 +1440,6 @@ int TWBaseScript::get_linked_object(const int from, const std::string& obj_name,
                 // Only do anything if there is at least one particle attachment.
                 if(has_link) {
                     linkset links;
-                    true_bool inherits;
 
                     // Check all the links of the appropriate flavour, looking for a link either to
                     // the named object, or to an object that inherits from it
@@ -1036,10 +1449,8 @@ int TWBaseScript::get_linked_object(const int from, const std::string& obj_name,
 
                         // If the object is an archetype, check whether the destination inherits from it.
                         if(object < 0) {
-                            ObjectSrv -> InheritsFrom(inherits, link.dest, object);
-
                             // Found a link from a concrete instance of the archetype? Return that object.
-                            if(inherits) {
+                            if(ArchetypeIndex::get().inherits_from(link.dest, object)) {
                                 return link.dest;
                             }
 
@@ -1052,13 +1463,13 @@ int TWBaseScript::get_linked_object(const int from, const std::string& obj_name,
                     }
 
                     if(debug_enabled())
-                        debug_printf(DL_WARNING, "Object has no %s link to a object named or inheriting from %s", link_name.c_str(), obj_name.c_str());
+                        debug_printf(DL_WARNING, "Object has no %s link to a object named or inheriting from %s", link_name, obj_name);
                 }
             } else {
-                debug_printf(DL_ERROR, "Request for non-existent link flavour %s", link_name.c_str());
+                debug_printf(DL_ERROR, "Request for non-existent link flavour %s", link_name);
             }
         } else if(debug_enabled()) {
-            debug_printf(DL_WARNING, "Unable to find object named '%s'", obj_name.c_str());
+            debug_printf(DL_WARNING, "Unable to find object named '%s'", obj_name);
         }
     } else {
         debug_printf(DL_ERROR, "obj_name name is empty.");
@@ -1074,9 +1485,9 @@ int TWBaseScript::get_linked_object(const int from, const std::string& obj_name,
 
 int TWBaseScript::get_qvar(const char* qvar, int def_val)
 {
-    SService<IQuestSrv> QuestSrv(g_pScriptManager);
-    if(QuestSrv -> Exists(qvar))
-        return QuestSrv -> Get(qvar);
+    int value;
+    if(QVarShadow::get(qvar, ObjId(), value))
+        return value;
 
     return def_val;
 }
@@ -1084,72 +1495,19 @@ int TWBaseScript::get_qvar(const char* qvar, int def_val)
 
 float TWBaseScript::get_qvar(const char* qvar, float def_val)
 {
-    SService<IQuestSrv> QuestSrv(g_pScriptManager);
-    if(QuestSrv -> Exists(qvar))
-        return static_cast<float>(QuestSrv -> Get(qvar));
+    int value;
+    if(QVarShadow::get(qvar, ObjId(), value))
+        return static_cast<float>(value);
 
     return def_val;
 }
 
 
-void TWBaseScript::set_qvar(const std::string &qvar, const int value)
+void TWBaseScript::set_qvar(const char* qvar, const int value)
 {
-    SService<IQuestSrv> QuestSrv(g_pScriptManager);
-    QuestSrv -> Set(qvar.c_str(), value, kQuestDataMission);
-}
-
-
-char* TWBaseScript::parse_qvar(const char* qvar, char** lhs, char* op, char** rhs)
-{
-    char* buffer = new char[strlen(qvar) + 1];
-    if(!buffer) return NULL;
-    strcpy(buffer, qvar);
-
-    char* workstr = buffer;
-
-    // skip any leading spaces or $
-    while(*workstr && (isspace(*workstr) || *workstr == '$')) {
-        ++workstr;
-    }
-
-    *lhs = workstr;
-
-    // Search for an operator
-    char* endstr = NULL;
-    *op = '\0';
-    while(*workstr) {
-        // NOTE: '-' is not included here. LarryG encountered problems with using QVar names containing
-        // '-' as this was interpreting it as an operator.
-        if(*workstr == '+' || *workstr == '*' || *workstr == '/') {
-            *op = *workstr;
-            endstr = workstr - 1; // record the character before the operator, for space trimming
-            *workstr = '\0';      // terminate so that lhs can potentially be used 'as is'
-            ++workstr;
-            break;
-        }
-        ++workstr;
-    }
-
-    // Only bother doing any more work if an operator was found
-    if(op && endstr) {
-        // Trim spaces before the operator if needed
-        while(isspace(*endstr)) {
-            *endstr = '\0';
-            --endstr;
-        }
-
-        // Skip spaces before the second operand
-        while(*workstr && isspace(*workstr)) {
-            ++workstr;
-        }
-
-        // If there is anything left on the right side, store the pointer to it
-        if(*workstr) {
-            *rhs = workstr;
-        }
-    }
-
-    return buffer;
+    SService<IQuestSrv>& QuestSrv = ScriptServices::quest();
+    QuestSrv -> Set(qvar, value, kQuestDataMission);
+    QVarShadow::set(qvar, value);
 }
 
 
@@ -28,6 +28,21 @@
 #include <string>
 #include <random>       // std::default_random_engine
 #include "Script.h"
+#include "MessageNames.h"
+#include "ScratchArena.h"
+#include "CachedScriptVar.h"
+#include "TimerWheel.h"
+#include "InitScheduler.h"
+#include "ParamSchema.h"
+#include "DesignNote.h"
+#include "LinkFlavours.h"
+#include "ArchetypeIndex.h"
+#include "ObjectNames.h"
+#include "QVarShadow.h"
+#include "QVarParam.h"
+#include "SharedConfig.h"
+#include "SpatialIndex.h"
+#include "ScriptServices.h"
 
 
 /** POD class used by the link search code to keep track of link information.
@@ -77,7 +92,7 @@ struct TargetObj {
  *  message handling is performed by the script, and introduces a significant
  *  number of advanced features for subclasses to take advantage of.
  */
-class TWBaseScript : public cScript
+class TWBaseScript : public cScript, private TimerWheel::Client, private InitScheduler::Client
 {
 public:
     /* ------------------------------------------------------------------------
@@ -91,14 +106,38 @@ public:
      * @param object The ID of the client object to add the script to.
      * @return A new TWBaseScript object.
      */
-    TWBaseScript(const char* name, int object) : cScript(name, object), randomiser(0), need_fixup(true), sim_running(false), debug(false), message_time(0), done_init(false)
-        { /* fnord */ }
+    TWBaseScript(const char* name, int object) : cScript(name, object), randomiser(0), need_fixup(true), sim_running(false), debug(false), message_time(0), message_id(MSGID_UNKNOWN), mem_owner(0), poll_name(NULL), poll_fired(0), in_poll(false), poll_due(name, "poll_due", object), done_init(false)
+        {
+            // All scripts are destroyed when a mission or saved game is loaded, so
+            // the first script created after that may be in a different gamesys.
+            if(!live_scripts++) {
+                ScriptServices::init(g_pScriptManager);
+                reload_pending = true;
+                sim_started = false;
+                LinkFlavours::invalidate();
+                ArchetypeIndex::get().invalidate();
+                ObjectNames::invalidate();
+                QVarShadow::invalidate(false);
+                SharedConfig::invalidate();
+                SpatialIndex::get().clear();
+            }
+        }
 
 
     /** Destroy the TWBaseScript object.
      */
     virtual ~TWBaseScript()
-        { /* fnord */ }
+        {
+            // The engine destroys every script before it shuts the script
+            // manager down, so this is the last safe point to release the
+            // interfaces the module holds.
+            discard_halted();
+
+            if(!--live_scripts) {
+                LinkFlavours::release();
+                ScriptServices::release();
+            }
+        }
 
 
     /** Entrypoint for messages recieved from the game. All messages sent to
@@ -120,14 +159,24 @@ public:
     STDMETHOD(ReceiveMessage)(sScrMsg* msg, sMultiParm* reply, eScrTraceAction trace);
 
 
+    /** The design note parameters read by TWBaseScript::init(). Subclasses
+     *  that describe their own parameters with a ParamSchema should use this,
+     *  or the schema of their nearest base class, as its parent.
+     */
+    static const ParamSchema param_schema;
+
 protected:
     /* ------------------------------------------------------------------------
      *  Initialisation related
      */
 
     /** Initialise the debug flag and anything else that couldn't be handled in
-     *  the constructor. This should be called as part of processing BeginScript,
-     *  before any attempt to use the class' features is made.
+     *  the constructor. This is called before the script handles its first
+     *  message, other than the BeginScript, Sim, and DarkGameModeChange
+     *  messages sent to every script at once: the init for those is left to
+     *  the InitScheduler, so it may happen some ticks later, and on_message()
+     *  holds the message back until then rather than passing it on to an
+     *  uninitialised script.
      *
      * @param time The current sim time.
      */
@@ -154,6 +203,13 @@ protected:
      *  script receives a message, and subclasses of this class will generally
      *  override or extend this function to provide script-specific behaviour.
      *
+     *  Subclasses must call this before handling the message themselves, and
+     *  must stop if it returns MS_HALT. It does so when the message is a Sim,
+     *  BeginScript, or DarkGameModeChange broadcast that arrives before the
+     *  script has been initialised: the init is left to the InitScheduler,
+     *  and the message is held back and passed on again once init() has
+     *  run, so subclasses still see it, but possibly some ticks late.
+     *
      * @param msg   A pointer to the message received by the object.
      * @param reply A reference to a multiparm variable in which a reply can
      *              be stored.
@@ -187,6 +243,18 @@ protected:
     uint get_sim_time(void) const { return message_time; }
 
 
+    /** Obtain the interned ID of the message currently being processed. This
+     *  allows on_message implementations to switch on the message ID rather
+     *  than performing a series of string comparisons against msg -> message.
+     *  Messages whose names have never been interned will have the ID
+     *  MSGID_UNKNOWN; use MessageNames::intern() during init to obtain IDs
+     *  for message names that are only known at runtime.
+     *
+     * @return The ID of the message being processed.
+     */
+    int get_message_id(void) const { return message_id; }
+
+
     /* ------------------------------------------------------------------------
      *  Message convenience functions
      */
@@ -246,6 +314,41 @@ protected:
     void cancel_timed_message(tScrTimer timer);
 
 
+    /** Schedule a polling timer on the module's timer wheel. When the delay
+     *  has elapsed, the script is sent a Timer message with the specified name
+     *  exactly as if set_timed_message() had been used, except that it is
+     *  delivered directly rather than through the engine's timer queue. Each
+     *  script can have one polling timer: scheduling a new one replaces any
+     *  pending one.
+     *
+     *  If this is called while handling the polling timer, the delay is
+     *  measured from the time the timer was due, so that periodic polls do not
+     *  drift. Otherwise, if stagger is set, the first delay is shortened by up
+     *  to half based on the object ID, so that many objects polling with the
+     *  same period are spread out rather than all firing together. Pending
+     *  polls survive save and load.
+     *
+     * @param name    The name of the timer, as it will appear in sScrTimerMsg::name.
+     * @param delay   How many milliseconds to wait before sending the timer.
+     * @param stagger If true, the first delay may be shortened to spread polls
+     *                out. This should be false if the delay must be honoured.
+     */
+    void schedule_poll(const char* name, uint delay, bool stagger = true);
+
+
+    /** Cancel the script's polling timer, if it has one.
+     */
+    void cancel_poll();
+
+
+    /** Determine whether the script has a polling timer pending.
+     *
+     * @return true if a polling timer is scheduled, false otherwise.
+     */
+    bool poll_scheduled() const
+        { return wheel_scheduled(); }
+
+
     /* ------------------------------------------------------------------------
      *  Script data handling
      */
@@ -338,11 +441,13 @@ protected:
      *  and its ID number. This builds a 'human readable' version of the object
      *  id and name that can be used when generating debugging messages.
      *
-     * @param name   A reference to a string object to store the name in.
+     * @param name   A reference to a string object to store the name in. As
+     *               this is only intended for use in debugging output, the
+     *               string is allocated from the message scratch arena.
      * @param obj_id The ID of the object to obtain the name and number of. If not
      *               provided, this defaults to the current object ID.
      */
-    void get_object_namestr(std::string& name, object obj_id);
+    void get_object_namestr(ScratchString& name, object obj_id);
 
 
     /** Obtain a string containing the current object's name (or archetype name),
@@ -351,7 +456,7 @@ protected:
      *
      * @param name   A reference to a string object to store the name in.
      */
-    void get_object_namestr(std::string& name);
+    void get_object_namestr(ScratchString& name);
 
 
     /* ------------------------------------------------------------------------
@@ -365,49 +470,53 @@ protected:
      * @param qvar   The name of the qvar to store the value in.
      * @param value  The value to store in the qvar.
      */
-    void set_qvar(const std::string &qvar, const int value);
+    void set_qvar(const char* qvar, const int value);
 
 
-    /** Fetch the value stored in a qvar, potentially applying a simple calculation
-     *  to the value set in the QVar. This takes a string of the form
-     *  qvarname([*+/](value|$qvarname)) and parses out the name, and operation
-     *  and value or qvar name if they are present, and returns the value in the
-     *  left hand side qvar, potentially modified by the operator and value or
-     *  the value in the right hand qvar. For example, if the qvar variable
-     *  contains 'foo/100' this will take the value in foo and divide it by 100.
-     *  If the quest variable does not exist, this returns the default value
-     *  specified *without applying any calculations to it*. The value may
-     *  optionally be another QVar by placing $ before its name, eg: foo/$bar will
-     *  divide the value in foo by the value in bar.
+    /** Fetch the value stored in a qvar, potentially applying a calculation
+     *  to the value set in the QVar. The string may be a QVar name, or an
+     *  expression combining QVars and numbers with + * / and ' - ', parentheses,
+     *  and the functions min(), max(), and clamp(); see QVarExpr for the full
+     *  syntax. For example, if the qvar variable contains 'foo/100' this will
+     *  take the value in foo and divide it by 100, and 'min(foo, $bar) * 2'
+     *  will double the smaller of foo and bar. If the quest variable at the
+     *  start of the expression does not exist, the default value specified is
+     *  used in its place, and the rest of the expression is applied to it.
+     *  Other quest variables that do not exist leave the operation they are
+     *  used in unchanged. Calculations are done using integer arithmetic.
      *
      * @param qvar    The name of the QVar to return the value of, possibly including simple maths.
-     * @param def_val The default value to return if the qvar does not exist.
-     * @return The QVar value, or the default specified.
+     * @param def_val The value to use if the leading qvar does not exist.
+     * @return The value of the expression.
      */
     int get_qvar_value(std::string& qvar, int def_val);
 
 
-    /** Fetch the value stored in a qvar, potentially applying a simple calculation
-     *  to the value set in the QVar. This takes a string of the form
-     *  qvarname([*+/](value|$qvarname)) and parses out the name, and operation
-     *  and value or qvar name if they are present, and returns the value in the
-     *  left hand side qvar, potentially modified by the operator and value or
-     *  the value in the right hand qvar. For example, if the qvar variable
-     *  contains 'foo/2.5' this will take the value in foo and divide it by 2.5.
-     *  If the quest variable does not exist, this returns the default value
-     *  specified *without applying any calculations to it*. The value may
-     *  optionally be another QVar by placing $ before its name, eg: foo/$bar will
-     *  divide the value in foo by the value in bar.
+    /** Fetch the value stored in a qvar, potentially applying a calculation
+     *  to the value set in the QVar. This works in the same way as the int
+     *  version of get_qvar_value(), except that calculations are done using
+     *  floating point arithmetic, so 'foo/2.5' will take the value in foo and
+     *  divide it by 2.5.
      *
      * @param qvar    The name of the QVar to return the value of, possibly including simple maths.
-     * @param def_val The default value to return if the qvar does not exist.
-     * @return The QVar value, or the default specified.
+     * @param def_val The value to use if the leading qvar does not exist.
+     * @return The value of the expression.
      */
     float get_qvar_value(std::string& qvar, float def_val);
 
 
     /* ------------------------------------------------------------------------
      *  Design note support
+     *
+     *  The get_scriptparam_* functions read from an indexed design note, so
+     *  init() should fetch the note, index it once with DesignNote::index(),
+     *  and pass the index to each of them, eg:
+     *
+     *      char* design_note = GetObjectParams(ObjId());
+     *      const DesignNote& note = DesignNote::index(design_note);
+     *      bool foo = get_scriptparam_bool(note, "Foo");
+     *
+     *  The index stays valid until a different note is indexed.
      */
 
     /** Parse a string containing either a float value, or a qvar name, and
@@ -427,6 +536,17 @@ protected:
     float parse_float(const char* param, float def_val, std::string& qvar_str);
 
 
+    /** Fetch the QVar expression from the value of a design note parameter
+     *  whose value starts with '$'.
+     *
+     * @param note     The index of the design note containing the parameter.
+     * @param key      The key of the parameter.
+     * @param qvar_str A reference to a string to store the QVar expression in,
+     *                 without the leading '$'.
+     */
+    static void get_key_qvar(const DesignNote& note, const DesignNote::Key& key, std::string& qvar_str);
+
+
     /** Values that may be returned from the get_scriptparam_countmode() function.
      */
     enum CountMode {
@@ -442,21 +562,21 @@ protected:
      *  parameter to 0, 1, 2, 3, None, On, Off, or Both. Because it is
      *  nifty like that.
      *
-     * @param design_note The design note to parse the count mode from.
+     * @param note        The indexed design note to read the parameter from.
      * @param param       The name of the parameter to parse. This will be prepended
      *                    with the current script name.
      * @param default     The default CountMode to use if not set.
      * @return The selected count mode, or the default if the mode has not
      *         been set by the user, or the set value is invalid.
      */
-    CountMode get_scriptparam_countmode(char* design_note, const char* param, CountMode def_mode = CM_BOTH);
+    CountMode get_scriptparam_countmode(const DesignNote& note, const char* param, CountMode def_mode = CM_BOTH);
 
 
     /** Parse the value and falloff for a specified parameter from the
      *  design note. This tries to parse a value for the parameter,
      *  and a corresponding falloff if one has been specified.
      *
-     * @param design_note The design note to parse the count mode from.
+     * @param note        The indexed design note to read the parameter from.
      * @param param       The name of the parameter to parse the value and
      *                    falloff for. This will be prepended with the current
      *                    script name.
@@ -473,7 +593,7 @@ protected:
      *                    set to zero. If you do not need to parse the limit
      *                    flag, set this to NULL.
      */
-    void get_scriptparam_valuefalloff(char* design_note, const char* param, int* value = NULL, int* falloff = NULL, bool* limit = NULL);
+    void get_scriptparam_valuefalloff(const DesignNote& note, const char* param, int* value = NULL, int* falloff = NULL, bool* limit = NULL);
 
 
     /** Read a float parameter from a design note string. If the value specified
@@ -492,7 +612,7 @@ protected:
      *       parameter this will actually try to parse a float value for will be
      *       `FooScriptBar`.
      *
-     * @param design_note The design note string to parse the parameter from.
+     * @param note        The indexed design note to read the parameter from.
      * @param param       The name of the parameter to parse. This will be prepended
      *                    with the current script name.
      * @param def_val     The default value to use if the parameter does not exist,
@@ -504,7 +624,7 @@ protected:
      * @return The value specified in the parameter, or the float version of a value
      *         read from the qvar named in the parameter.
      */
-    float get_scriptparam_float(const char* design_note, const char* param, float def_val, std::string& qvar_str);
+    float get_scriptparam_float(const DesignNote& note, const char* param, float def_val, std::string& qvar_str);
 
 
     /** Parse an integer parameter from the specified design note. This behaves
@@ -512,7 +632,7 @@ protected:
      *  script name to the specified parameter. It also supports simple calculations
      *  in the value, see the documentation for get_scriptparam_float() for more details.
      *
-     * @param design_note The design note string to parse the parameter from.
+     * @param note        The indexed design note to read the parameter from.
      * @param param       The name of the parameter to parse. This will be prepended
      *                    with the current script name.
      * @param def_val     The default value to use if the parameter does not exist,
@@ -524,7 +644,7 @@ protected:
      * @return The value specified in the parameter, or the int read from the qvar
      *         named in the parameter.
      */
-    int get_scriptparam_int(const char* design_note, const char* param, int def_val, std::string& qvar_str);
+    int get_scriptparam_int(const DesignNote& note, const char* param, int def_val, std::string& qvar_str);
 
 
     /** Parse a time parameter from the specified design note. This behaves
@@ -532,7 +652,7 @@ protected:
      *  script name to the specified parameter. It also supports simple calculations
      *  in the value, see the documentation for get_scriptparam_float() for more details.
      *
-     * @param design_note The design note string to parse the parameter from.
+     * @param note        The indexed design note to read the parameter from.
      * @param param       The name of the parameter to parse. This will be prepended
      *                    with the current script name.
      * @param def_val     The default value to use if the parameter does not exist,
@@ -542,20 +662,66 @@ protected:
      * @return The time, in milliseconds, specified in the parameter, or read from the qvar
      *         named in the parameter.
      */
-    int get_scriptparam_time(const char* design_note, const char* param, int def_val, std::string& qvar_str);
+    int get_scriptparam_time(const DesignNote& note, const char* param, int def_val, std::string& qvar_str);
+
+
+    /** Parse a float parameter from the specified design note into a QVarParam.
+     *  This behaves like the std::string version of get_scriptparam_float(),
+     *  except that if the value is read from a QVar, the parameter remembers
+     *  the expression so that QVarParam::update() can recalculate it when the
+     *  QVars it uses change.
+     *
+     * @param note        The indexed design note to read the parameter from.
+     * @param param       The name of the parameter to parse. This will be prepended
+     *                    with the current script name.
+     * @param def_val     The default value to use if the parameter does not exist,
+     *                    or it references a non-existent QVar.
+     * @param dest        The parameter to store the value and expression in.
+     * @return The value specified in the parameter.
+     */
+    float get_scriptparam_float(const DesignNote& note, const char* param, float def_val, QVarParam<float>& dest);
+
+
+    /** Parse an integer parameter from the specified design note into a QVarParam.
+     *  See the QVarParam version of get_scriptparam_float() for more details.
+     *
+     * @param note        The indexed design note to read the parameter from.
+     * @param param       The name of the parameter to parse. This will be prepended
+     *                    with the current script name.
+     * @param def_val     The default value to use if the parameter does not exist,
+     *                    or it references a non-existent QVar.
+     * @param dest        The parameter to store the value and expression in.
+     * @return The value specified in the parameter.
+     */
+    int get_scriptparam_int(const DesignNote& note, const char* param, int def_val, QVarParam<int>& dest);
+
+
+    /** Parse a time parameter from the specified design note into a QVarParam.
+     *  See the QVarParam version of get_scriptparam_float() for more details.
+     *  Note that values read from QVars are always in milliseconds.
+     *
+     * @param note        The indexed design note to read the parameter from.
+     * @param param       The name of the parameter to parse. This will be prepended
+     *                    with the current script name.
+     * @param def_val     The default value to use if the parameter does not exist,
+     *                    or it references a non-existent QVar.
+     * @param dest        The parameter to store the value and expression in.
+     * @return The time, in milliseconds, specified in the parameter.
+     */
+    int get_scriptparam_time(const DesignNote& note, const char* param, int def_val, QVarParam<int>& dest);
 
 
     /** Parse a boolean parameter from the specified design note. This behaves identically
      *  to GetParamBool, except that it prepends the script name to the specified
      *  parameter name.
      *
-     * @param design_note The design note string to parse the parameter from.
+     * @param note        The indexed design note to read the parameter from.
      * @param param       The name of the parameter to parse. This will be prepended
      *                    with the current script name.
      * @param def_val     The default value to use if the parameter does not exist.
      * @return The value specified in the parameter, or the default value.
      */
-    bool get_scriptparam_bool(const char* design_note, const char* param, bool def_val = false);
+    bool get_scriptparam_bool(const DesignNote& note, const char* param, bool def_val = false);
 
 
     /** Read a string from a design note. This will attempt to locate the first
@@ -569,7 +735,7 @@ protected:
      *       parameter this will actually try to fetch a string for will be
      *       `FooScriptBar`.
      *
-     * @param design_note The design note string to parse the parameter from.
+     * @param note        The indexed design note to read the parameter from.
      * @param param       The name of the parameter to parse. This will be prepended
      *                    with the current script name.
      * @param def_val     The default value to use if the parameter does not exist.
@@ -578,7 +744,7 @@ protected:
      * @return A pointer to a string containing the parameter value. This must be
      *         released by the caller using `g_pMalloc -> Free()`.
      */
-    char* get_scriptparam_string(const char* design_note, const char* param, const char* def_val = NULL);
+    char* get_scriptparam_string(const DesignNote& note, const char* param, const char* def_val = NULL);
 
 
     /** Read a float vector (triple of three floats) from a design note string. This
@@ -588,7 +754,7 @@ protected:
      *  If components are missing, this will use the specified default values
      *  instead.
      *
-     * @param design_note The design note string to parse the parameter from.
+     * @param note        The indexed design note to read the parameter from.
      * @param param       The name of the parameter to parse.  This will be prepended
      *                    with the current script name.
      * @param vect        A reference to a vector to store the values in.
@@ -602,7 +768,7 @@ protected:
      *         whether any values were parsed, rather it should be used to determine
      *         whether the parameter has been found.
      */
-    bool get_scriptparam_floatvec(const char* design_note, const char* param, cScrVec &vect, float defx = 0.0f, float defy = 0.0f, float defz = 0.0f);
+    bool get_scriptparam_floatvec(const DesignNote& note, const char* param, cScrVec &vect, float defx = 0.0f, float defy = 0.0f, float defz = 0.0f);
 
 
     /** Establish the length of the name of the qvar in the specified string. This
@@ -620,6 +786,95 @@ protected:
      *  Targetting
      */
 
+    /** Enum used to control link selection in searches.
+     */
+    enum LinkMode {
+        LM_ARCHETYPE = 1, //!< Only include links to archetypes in results
+        LM_CONCRETE,      //!< Only include links to concrete objects
+        LM_BOTH           //!< Include links to both
+    };
+
+
+    /** The kinds of search a target description string can specify.
+     */
+    enum TargetType {
+        TT_NONE = 0,  //!< Empty or unparseable target, matches nothing
+        TT_ME,        //!< [me]
+        TT_SOURCE,    //!< [source]
+        TT_LINK,      //!< &linkdef
+        TT_ARCHETYPE, //!< *Archetype or @Archetype
+        TT_RADIUS,    //!< <radius:Archetype or >radius:Archetype
+        TT_NAMED      //!< A named object
+    };
+
+
+    /** A target description string that has been parsed in advance. Target
+     *  strings are usually fixed when the script initialises, so rather than
+     *  parsing the sigils, link flavour, counts, and archetype names every time
+     *  a search is needed, scripts can compile the string into a TargetQuery
+     *  once (via compile_target_query()) and then run the query as often as
+     *  needed with get_target_objects(). Anything that might change while the
+     *  game is running - named objects, the contents of archetypes, links -
+     *  is still looked up when the query is run. The link flavour and
+     *  archetype IDs are resolved again if the query is run after they may
+     *  have changed (when the sim is restarted in the editor, for example).
+     */
+    struct TargetQuery {
+        TargetType  type;        //!< The kind of search to perform.
+        std::string text;        //!< The target string this query was compiled from.
+        std::string name;        //!< Link flavour, archetype, or object name, depending on type.
+
+        // Link searches
+        mutable long flavour_id; //!< The ID of the link flavour to search, 0 if it could not be resolved.
+        LinkMode    link_mode;   //!< Which link destinations to include in the results.
+        uint        fetch_count; //!< How many links should be selected, 0 means the default for the mode.
+        bool        is_random;   //!< Select links at random?
+        bool        is_weighted; //!< Use ScriptParams weights when selecting links?
+        bool        fetch_all;   //!< Return all links, even in random mode?
+        bool        no_repeat;   //!< Never select the same link more than once in weighted mode?
+
+        // Archetype and radius searches
+        mutable object archetype; //!< The archetype to search, 0 if it could not be resolved.
+        bool        do_full;     //!< Include indirect descendants of the archetype?
+        float       radius;      //!< The radius for radius searches.
+        bool        lessthan;    //!< Match objects inside (true) or outside (false) the radius.
+        bool        sorted;      //!< Return radius matches nearest first?
+
+        mutable uint generation; //!< The LinkFlavours generation flavour_id and archetype were resolved in, 0 if not yet resolved.
+
+        TargetQuery() : type(TT_NONE), text(), name(), flavour_id(0), link_mode(LM_BOTH), fetch_count(0),
+                        is_random(false), is_weighted(false), fetch_all(false), no_repeat(false), archetype(0), do_full(false),
+                        radius(0.0f), lessthan(false), sorted(false), generation(0)
+            { /* fnord */ }
+    };
+
+
+    /** Parse the specified target description string into a TargetQuery that
+     *  can later be passed to get_target_objects(). See the documentation for
+     *  get_target_objects(const char*, sScrMsg*) for the supported syntax.
+     *
+     * @param targ  The target description string.
+     * @param query A reference to the TargetQuery to store the compiled query in.
+     * @return true if the string describes a search, false if it is empty or
+     *         could not be parsed (in which case the query will match nothing).
+     */
+    bool compile_target_query(const char* targ, TargetQuery& query);
+
+
+    /** Generate a list of object ids matched by a previously compiled TargetQuery.
+     *  The matches are stored in a vector supplied by the caller, so that the
+     *  caller can reuse the same vector (and its storage) for repeated searches.
+     *
+     * @param matches A reference to the vector to store the matched objects in.
+     *                This is cleared before the search is performed.
+     * @param query   The compiled target query to run.
+     * @param msg     A pointer to a script message containing the to and from objects.
+     *                This is required when the query is "[me]", "[source]", or a
+     *                radius search.
+     */
+    void get_target_objects(std::vector<TargetObj>& matches, const TargetQuery& query, sScrMsg* msg = NULL);
+
+
     /** Given a target description string, generate a list of object ids the string
      *  corresponds to. If targ is '[me]', the current object is returned, if targ
      *  is '[source]' the source object is returned, if targ contains an object
@@ -631,13 +886,22 @@ protected:
      *  starts with '&' it is considered to be a link search, in which case the
      *  remainder of the target string should be a linksearch definition.
      *
-     * @param targ The target description string
-     * @param msg  A pointer to a script message containing the to and from objects.
-     *             This is required when targ is "[me]", "[source]",
-     * @return A vector of object ids the target string matches. The caller must
-     *         free this when done with it.
+     *  In radius searches, the archetype name may be preceded by '^' to return
+     *  the matched objects nearest first, and by [N] to return only the N
+     *  nearest matches, eg: `<20:[3]@Guard` selects the three guards closest
+     *  to the object, provided they are within 20 units of it.
+     *
+     * @note This compiles the target string on every call. Scripts that search
+     *       using the same string repeatedly should compile it once with
+     *       compile_target_query() and use the TargetQuery version instead.
+     *
+     * @param matches A reference to the vector to store the matched objects in.
+     *                This is cleared before the search is performed.
+     * @param targ    The target description string
+     * @param msg     A pointer to a script message containing the to and from objects.
+     *                This is required when targ is "[me]", "[source]",
      */
-    std::vector<TargetObj>* get_target_objects(const char* targ, sScrMsg* msg = NULL);
+    void get_target_objects(std::vector<TargetObj>& matches, const char* targ, sScrMsg* msg = NULL);
 
 
     /* ------------------------------------------------------------------------
@@ -677,7 +941,10 @@ protected:
      *  a single linked object is selected. If random or 'Weighted' mode is
      *  enabled, and a fetch count has been given, then the list of returned
      *  TargetObjs will contain the requested number of links, randomly selected
-     *  from the possible links, and *repeats may be present in the list*.
+     *  from the possible links. Random mode never selects the same link twice,
+     *  but in 'Weighted' mode *repeats may be present in the list* unless the
+     *  linkdef also contains '^', in which case each link is selected at most
+     *  once (so fewer links than requested may be returned).
      *
      *  For example, this will fetch three random ControlDevice linked objects:
      *
@@ -713,7 +980,7 @@ protected:
      * @param fallback  An optional default ID to return if no matching object has been located.
      * @return The target object ID, or the fallback ID if no match has been located.
      */
-    int get_linked_object(const int from, const std::string& obj_name, const std::string& link_name, const int fallback = 0);
+    int get_linked_object(const int from, const char* obj_name, const char* link_name, const int fallback = 0);
 
 
     /* ------------------------------------------------------------------------
@@ -721,6 +988,14 @@ protected:
      */
     std::default_random_engine randomiser; //!< a random number generator for... random numbers.
 
+    /** Storage that subclasses can reuse for target searches, to avoid allocating
+     *  a new vector every time a search is done. As handling a message may cause
+     *  another message to be delivered to the script before the search results
+     *  have been used, code should swap this into a local vector, use that, and
+     *  swap it back afterwards rather than using it directly.
+     */
+    std::vector<TargetObj> target_scratch;
+
 private:
     /* ------------------------------------------------------------------------
      *  Message handling
@@ -738,17 +1013,88 @@ private:
     long dispatch_message(sScrMsg* msg, sMultiParm* reply);
 
 
+    /** Write the module's allocation statistics out, either to the monolog
+     *  or appended to the specified file. This lists the overall totals,
+     *  the counts for each allocation size class that has been used, and
+     *  the counts credited to each script class.
+     *
+     * @param filename The name of the file to append the statistics to. If
+     *                 this is NULL or empty, they are written to the monolog.
+     */
+    void dump_memory_stats(const char* filename);
+
+
+    /** Deliver the script's polling timer. This is called by the timer wheel,
+     *  and passes a copy of the wheel's own timer message, modified to look
+     *  like the script's timer, to ReceiveMessage().
+     *
+     * @param tick The engine timer message that drove the wheel.
+     * @param due  The sim time at which the poll was due.
+     */
+    void on_wheel_timer(sScrTimerMsg* tick, uint due);
+
+
+    /** Put the script's polling timer back on the timer wheel after a saved
+     *  game has been loaded, if it had one pending.
+     */
+    void restore_poll();
+
+
+    /** Run the script's init, if it has not already been run, taking it off
+     *  the init scheduler's queue if it is waiting there. Any messages held
+     *  back while the init was deferred are then handled, in the order they
+     *  arrived.
+     *
+     * @param msg The message being handled when the init is needed.
+     */
+    void run_init(sScrMsg* msg);
+
+
+    /** Keep a copy of a message that arrived while the script's init was
+     *  deferred, so that run_init() can pass it on once the init has run.
+     *
+     * @param msg The message to hold back.
+     */
+    void hold_message(sScrMsg* msg);
+
+
+    /** Free any messages still held back by hold_message().
+     */
+    void discard_halted();
+
+
+    /** Initialise the script when the init scheduler reaches it. This is
+     *  called by the scheduler, and passes a copy of the timer wheel's own
+     *  timer message, renamed to TWDeferredInit, to ReceiveMessage() so that
+     *  the init is done inside the usual message handling.
+     *
+     * @param tick The engine timer message that drove the timer wheel.
+     */
+    void on_deferred_init(sScrTimerMsg* tick);
+
+
     /* ------------------------------------------------------------------------
      *  Link targetting
      */
 
-    /** Enum used to control link selection in searches.
+    /** Resolve the link flavour or archetype named in a compiled TargetQuery,
+     *  unless they have already been resolved since link flavours and
+     *  archetypes were last invalidated.
+     *
+     * @param query The compiled query to resolve.
      */
-    enum LinkMode {
-        LM_ARCHETYPE = 1, //!< Only include links to archetypes in results
-        LM_CONCRETE,      //!< Only include links to concrete objects
-        LM_BOTH           //!< Include links to both
-    };
+    void resolve_target_query(const TargetQuery& query);
+
+
+    /** Run the link search described by a compiled link TargetQuery, adding the
+     *  selected link destinations to the matches list.
+     *
+     * @param matches A pointer to the vector to store object IDs in.
+     * @param from    The ID of the object to search for links from.
+     * @param query   A compiled query with type TT_LINK.
+     */
+    void run_link_query(std::vector<TargetObj>* matches, const int from, const TargetQuery& query);
+
 
     /** Process any sigils included in the specified linkdef. This will scan the
      *  specified linkdef for recognised sigils, and set the options for the link
@@ -767,13 +1113,15 @@ private:
      *                    objects to return from link_search.
      * @param fetch_all   A pointer to a book that will be set to true if the linkdef
      *                    contains the '!' sigil.
+     * @param no_repeat   A pointer to a bool that will be set to true if the linkdef
+     *                    contains the '^' sigil.
      * @param mode        A pointer to a LinkMode to store the link selection mode in.
      *                    If a mode is not set in the string, this is set to LM_BOTH.
      * @return A pointer to the start of the link flavour specified in linkdef. Note
      *         that if the linkdef specifies the flavour "Weighted", this will be a
      *         link to a string containing "ScriptParams" which *should not* be freed.
      */
-    const char* link_search_setup(const char *linkdef, bool* is_random, bool* is_weighted, uint* fetch_count, bool *fetch_all, LinkMode *mode);
+    const char* link_search_setup(const char *linkdef, bool* is_random, bool* is_weighted, uint* fetch_count, bool *fetch_all, bool* no_repeat, LinkMode *mode);
 
 
     /** Parse the number of linked objects to return from the specified link definition.
@@ -788,23 +1136,31 @@ private:
     const char* parse_link_count(const char* linkdef, uint* fetch_count);
 
 
+    /** Storage reused by run_link_query() for the list of candidate links, so
+     *  that link searches do not need to allocate a new list each time. Link
+     *  searches never deliver messages, so this can not be used re-entrantly.
+     */
+    std::vector<LinkScanWorker> link_scratch;
+
+
     /** Generate a list of current links of the specified flavour from this object, recording
      *  the link ID and destination, and possibly weighting information if needed and
      *  weighting is enabled.
      *
-     * @param flavour  The link flavour to include in the list.
-     * @param from     The ID of the object to fetch links from.
-     * @param weighted If true, weighting is enabled. `flavour` must be `ScriptParams` or `~ScriptParams`.
-     * @param mode     The link selection mode.
-     * @param links    A reference to a vector in which the list of links should be stored.
+     * @param flavourid The ID of the link flavour to include in the list.
+     * @param from      The ID of the object to fetch links from.
+     * @param weighted  If true, weighting is enabled. `flavourid` must be the ID of `ScriptParams` or `~ScriptParams`.
+     * @param mode      The link selection mode.
+     * @param links     A reference to a vector in which the list of links should be stored.
      * @return The accumulated weights if weighting is enabled, the number of links if it is
      *         not enabled, 0 indicates no matching links found.
      */
-    uint link_scan(const char *flavour, const int from, const bool weighted, const LinkMode mode, std::vector<LinkScanWorker> &links);
+    uint link_scan(const long flavourid, const int from, const bool weighted, const LinkMode mode, std::vector<LinkScanWorker> &links);
 
 
     /** Select a link from the specified vector of links such that it has the target
-     *  cumulative weight, or is the closest greater weight.
+     *  cumulative weight, or is the closest greater weight. This is a binary search,
+     *  so it takes O(log n) time for n links.
      *
      * @param links  A reference to a list of LinkScanWorker structures containing weighted
      *               link information. This must be ordered by ascending cumulative weight.
@@ -824,20 +1180,23 @@ private:
 
 
     /** Choose an appropriate number of links at random from the specified links list.
-     *  This will randomise the list, and then choose the requested number of links
-     *  from it. Note that if fetch_count > 1, this can produce duplicate entries in
-     *  the matches list. The links are chosen *at random*, with no exclusion of
-     *  already selected links!
+     *  In unweighted mode, only as much of the list is shuffled as is needed to choose
+     *  the requested number of links, and no link is chosen twice. In weighted mode,
+     *  each link is chosen independently (so if fetch_count > 1, the matches list can
+     *  contain duplicates), unless no_repeat is set, in which case the links are
+     *  sampled without replacement.
      *
      * @param matches       A pointer to the vector to store object IDs in.
-     * @param links         A reference to a vector of links.
+     * @param links         A reference to a vector of links. The order of the links
+     *                      is changed by this function.
      * @param fetch_count   The number of links to fetch.
      * @param fetch_all     Fetch all the links in a random order?
      * @param total_weights The total of all the weights of the links in the links vector.
      * @param is_weighted   If true, do a weighted random selection, otherwise all links
      *                      can be selected equally.
+     * @param no_repeat     If true, weighted selection never chooses the same link twice.
      */
-    void select_random_links(std::vector<TargetObj>* matches, std::vector<LinkScanWorker>& links, const uint fetch_count, const bool fetch_all, const uint total_weights, const bool is_weighted);
+    void select_random_links(std::vector<TargetObj>* matches, std::vector<LinkScanWorker>& links, const uint fetch_count, const bool fetch_all, const uint total_weights, const bool is_weighted, const bool no_repeat);
 
 
     /** Copy the requested number of links from the link worker vector into the TargetObj
@@ -877,8 +1236,8 @@ private:
      *  from the specified object.
      *
      * @param matches   A pointer to the vector to store object ids in.
-     * @param archetype The name of the archetype to search for. *Must not* include
-     *                  and filtering (* or @) directives.
+     * @param archetype The ID of the archetype to search for. If this is not an
+     *                  archetype (ie: it is zero or positive), nothing is matched.
      * @param do_full   If false, only concrete objects that are direct descendants of
      *                  the archetype are matched. If true, all concrete objects that
      *                  are descendants of the archetype, or any descendant of that
@@ -893,8 +1252,12 @@ private:
      *                  or outside.
      * @param lessthan  If true, objects must fall within the sphere around from_obj,
      *                  if false they must be outside it.
+     * @param fetch_count When doing a radius search, if this is non-zero only the
+     *                  fetch_count objects closest to from_obj are matched.
+     * @param sorted    When doing a radius search, if this is true the objects are
+     *                  matched in order of increasing distance from from_obj.
      */
-    void archetype_search(std::vector<TargetObj>* matches, const char* archetype, bool do_full = false, bool do_radius = false, object from_obj = 0, float radius = 0.0f, bool lessthan = false);
+    void archetype_search(std::vector<TargetObj>* matches, object archetype, bool do_full = false, bool do_radius = false, object from_obj = 0, float radius = 0.0f, bool lessthan = false, uint fetch_count = 0, bool sorted = false);
 
 
     /* ------------------------------------------------------------------------
@@ -905,8 +1268,8 @@ private:
      *  does not.
      *
      * @param qvar    The name of the QVar to return the value of.
-     * @param def_val The default value to return if the qvar does not exist.
-     * @return The QVar value, or the default specified.
+     * @param def_val The value to use if the leading qvar does not exist.
+     * @return The value of the expression.
      */
     int get_qvar(const char* name, int def_val);
 
@@ -915,29 +1278,12 @@ private:
      *  does not.
      *
      * @param qvar    The name of the QVar to return the value of.
-     * @param def_val The default value to return if the qvar does not exist.
-     * @return The QVar value, or the default specified.
+     * @param def_val The value to use if the leading qvar does not exist.
+     * @return The value of the expression.
      */
     float get_qvar(const char* name, float def_val);
 
 
-    /** Parse the pieces of a qvar name string, potentially including a simple calculation.
-     *  The takes a string containing a qvar name, and potentially an operator and either
-     *  a number or another qvar, and stores pointers to the two sides of the operator, plus
-     *  the operator itself, in the provided pointers.
-     *
-     * @param qvar A pointer to the string containing the qvar name.
-     * @param lhs  A pointer to a string pointer in which to store a pointer to the left
-     *             hand side operand.
-     * @param op   A pointer to a char to store the operator in, if there is one.
-     * @param rhs  A pointer to a string pointer in which to store a pointer to the right
-     *             hand side operand, if there is one.
-     * @return A pointer to a buffer containing a processed version of `qvar`. This should
-     *         be freed by the called using `g_pMalloc -> Free()`.
-     */
-    char* parse_qvar(const char* qvar, char** lhs, char* op, char** rhs);
-
-
     /* ------------------------------------------------------------------------
      *  Miscellaneous stuff
      */
@@ -968,10 +1314,21 @@ private:
     bool sim_running;  //!< Is the sim currently running?
     bool debug;        //!< Is debugging enabled?
     uint message_time; //!< The sim time stored in the last recieved message
+    int  message_id;   //!< The interned ID of the message being processed
+    uint mem_owner;    //!< The allocator statistics slot for this script's class
+
+    const char* poll_name;        //!< The interned name of the polling timer.
+    uint poll_fired;              //!< The time the polling timer being handled was due.
+    bool in_poll;                 //!< Is the polling timer being handled?
+    cached_script_int poll_due;   //!< The sim time the pending polling timer is due.
 
     bool done_init;    //!< Has the script run its init?
+    std::vector<sScrMsg*> halted; //!< Copies of the messages held back while the init was deferred.
 
     static const uint NAME_BUFFER_SIZE;
+    static uint live_scripts;   //!< The number of TWBaseScript objects in existence.
+    static bool reload_pending; //!< Has a load happened that the first BeginScript should handle?
+    static bool sim_started;    //!< Has a script already handled the current sim start?
 };
 
 #else // SCR_GENSCRIPTS
@@ -2,6 +2,19 @@
 #include "TWBaseTrap.h"
 #include "ScriptLib.h"
 
+static const ParamDesc trap_params[] = {
+    PARAM_KNOWN("On"),
+    PARAM_KNOWN("Off"),
+    PARAM_KNOWN("Count"),
+    PARAM_KNOWN("CountFalloff"),
+    PARAM_KNOWN("CountLimit"),
+    PARAM_KNOWN("CountOnly"),
+    PARAM_KNOWN("OnCapacitor"),
+    PARAM_KNOWN("OnCapacitorFalloff"),
+    PARAM_KNOWN("OffCapacitor"),
+    PARAM_KNOWN("OffCapacitorFalloff"),
+};
+const ParamSchema TWBaseTrap::param_schema(trap_params, &TWBaseScript::param_schema);
 
 /* ------------------------------------------------------------------------
  *  Message handling
@@ -13,7 +26,11 @@ TWBaseScript::MsgStatus TWBaseTrap::on_message(sScrMsg* msg, cMultiParm& reply)
     MsgStatus result = TWBaseScript::on_message(msg, reply);
     if(result != MS_CONTINUE) return result;
 
-    if(!::_stricmp(msg -> message, turnon_msg.c_str())) {
+    int msgid = get_message_id();
+
+    // The on and off message IDs are only known at runtime, so they can't be
+    // switch cases; they are still simple integer compares, though.
+    if(msgid == turnon_id) {
         if(debug_enabled())
             debug_printf(DL_DEBUG, "Received TurnOn");
 
@@ -30,7 +47,7 @@ TWBaseScript::MsgStatus TWBaseTrap::on_message(sScrMsg* msg, cMultiParm& reply)
         // Get here and one of the counters returned false, so halt further processing.
         return MS_HALT;
 
-    } else if(!::_stricmp(msg -> message, turnoff_msg.c_str())) {
+    } else if(msgid == turnoff_id) {
 
         if(debug_enabled())
             debug_printf(DL_DEBUG, "Received TurnOff");
@@ -48,7 +65,7 @@ TWBaseScript::MsgStatus TWBaseTrap::on_message(sScrMsg* msg, cMultiParm& reply)
         // Get here and one of the counters returned false, so halt further processing.
         return MS_HALT;
 
-    } else if(!::_stricmp(msg -> message, "ResetCount")) {
+    } else if(msgid == MSGID_RESETCOUNT) {
         count.reset(msg -> time);
 
         if(debug_enabled())
@@ -69,42 +86,49 @@ void TWBaseTrap::init(int time)
 
     char *msg;
     char *design_note = GetObjectParams(ObjId());
+    const DesignNote& note = DesignNote::index(design_note);
 
     if(design_note) {
         // Work out what the turnon and turnoff messages should be
-        if((msg = get_scriptparam_string(design_note, "On", "TurnOn")) != NULL) {
+        if((msg = get_scriptparam_string(note, "On", "TurnOn")) != NULL) {
             turnon_msg = msg;
             g_pMalloc -> Free(msg);
         }
 
-        if((msg = get_scriptparam_string(design_note, "Off", "TurnOff")) != NULL) {
+        if((msg = get_scriptparam_string(note, "Off", "TurnOff")) != NULL) {
             turnoff_msg = msg;
             g_pMalloc -> Free(msg);
         }
 
+        // Intern the message names so that on_message can compare IDs. An
+        // empty name would intern as MSGID_UNKNOWN, which any message not in
+        // the table also has, so it gets an ID no message can match instead.
+        turnon_id  = !turnon_msg.empty()  ? MessageNames::intern(turnon_msg.c_str())  : MSGID_NONE;
+        turnoff_id = !turnoff_msg.empty() ? MessageNames::intern(turnoff_msg.c_str()) : MSGID_NONE;
+
         if(debug_enabled())
             debug_printf(DL_DEBUG, "Trap initialised with on = '%s', off = '%s'", turnon_msg.c_str(), turnoff_msg.c_str());
 
         // Now for use limiting.
         int value, falloff;
         bool limit;
-        get_scriptparam_valuefalloff(design_note, "Count", &value, &falloff, &limit);
+        get_scriptparam_valuefalloff(note, "Count", &value, &falloff, &limit);
         count.init(time, 0, value, falloff, false, limit);
 
         // Handle modes
-        count_mode = get_scriptparam_countmode(design_note, "CountOnly");
+        count_mode = get_scriptparam_countmode(note, "CountOnly");
 
         if(debug_enabled())
             debug_printf(DL_DEBUG, "Count is %d%s with a falloff of %d milliseconds, count mode is %d", value, (value ? "" : " (no use limit)"), falloff, static_cast<int>(count_mode));
 
         // Now deal with capacitors
-        get_scriptparam_valuefalloff(design_note, "OnCapacitor", &value, &falloff);
+        get_scriptparam_valuefalloff(note, "OnCapacitor", &value, &falloff);
         on_capacitor.init(time, value, 0, falloff, true);
 
         if(debug_enabled())
             debug_printf(DL_DEBUG, "OnCapacitor is %d%s with a falloff of %d milliseconds", value, (value > 1 ? "" : " (every turnon fires)"), falloff);
 
-        get_scriptparam_valuefalloff(design_note, "OffCapacitor", &value, &falloff);
+        get_scriptparam_valuefalloff(note, "OffCapacitor", &value, &falloff);
         off_capacitor.init(time, value, 0, falloff, true);
 
         if(debug_enabled())
@@ -29,6 +29,7 @@
 #include <string>
 #include "TWBaseScript.h"
 #include "SavedCounter.h"
+#include "IString.h"
 
 class TWBaseTrap : public TWBaseScript
 {
@@ -46,10 +47,17 @@ public:
      */
     TWBaseTrap(const char* name, int object) : TWBaseScript(name, object),
                                                turnon_msg("TurnOn"), turnoff_msg("TurnOff"),
+                                               turnon_id(MSGID_TURNON), turnoff_id(MSGID_TURNOFF),
                                                count(name, object), count_mode(CM_BOTH),
                                                on_capacitor(name, object), off_capacitor(name, object)
         { /* fnord */ }
 
+
+    /** The design note parameters read by TWBaseTrap::init(), including those
+     *  read by TWBaseScript.
+     */
+    static const ParamSchema param_schema;
+
 protected:
     /* ------------------------------------------------------------------------
      *  Initialisation related
@@ -116,8 +124,10 @@ private:
      */
 
     // Message names
-    std::string turnon_msg;        //!< The name of the message that should tigger the 'TurnOn' action
-    std::string turnoff_msg;       //!< The name of the message that should tigger the 'TurnOff' action
+    IString turnon_msg;            //!< The name of the message that should tigger the 'TurnOn' action
+    IString turnoff_msg;           //!< The name of the message that should tigger the 'TurnOff' action
+    int turnon_id;                 //!< The interned ID of turnon_msg
+    int turnoff_id;                //!< The interned ID of turnoff_msg
 
     // Count handling
     SavedCounter count;         //!< Control how many times the script will work
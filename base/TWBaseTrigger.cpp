@@ -2,7 +2,20 @@
 #include <lg/objects.h>
 #include "TWBaseTrigger.h"
 #include "ScriptLib.h"
-
+#include "ScriptServices.h"
+
+static const ParamDesc trigger_params[] = {
+    PARAM_KNOWN("TOn"),
+    PARAM_KNOWN("TOff"),
+    PARAM_KNOWN("TDest"),
+    PARAM_KNOWN("KillLinks"),
+    PARAM_KNOWN("FailChance"),
+    PARAM_KNOWN("Count"),
+    PARAM_KNOWN("CountFalloff"),
+    PARAM_KNOWN("CountLimit"),
+    PARAM_KNOWN("CountOnly"),
+};
+const ParamSchema TWBaseTrigger::param_schema(trigger_params, &TWBaseScript::param_schema);
 
 /* ------------------------------------------------------------------------
  *  Message handling
@@ -14,7 +27,7 @@ TWBaseScript::MsgStatus TWBaseTrigger::on_message(sScrMsg* msg, cMultiParm& repl
     MsgStatus result = TWBaseScript::on_message(msg, reply);
     if(result != MS_CONTINUE) return result;
 
-    if(!::_stricmp(msg -> message, "ResetCount")) {
+    if(get_message_id() == MSGID_RESETCOUNT) {
         count.reset(msg -> time);
 
         if(debug_enabled())
@@ -37,17 +50,18 @@ void TWBaseTrigger::init(int time)
     bool limit = false;
     char *msg;
     char *design_note = GetObjectParams(ObjId());
+    const DesignNote& note = DesignNote::index(design_note);
 
     if(design_note) {
         // Work out what the turnon and turnoff messages should be
-        if((msg = get_scriptparam_string(design_note, "TOff", "TurnOff")) != NULL) {
+        if((msg = get_scriptparam_string(note, "TOff", "TurnOff")) != NULL) {
             messages[0] = msg;
             isstim[0] = check_stimulus_message(msg, &stimob[0], &intensity[0]);
 
             g_pMalloc -> Free(msg);
         }
 
-        if((msg = get_scriptparam_string(design_note, "TOn", "TurnOn")) != NULL) {
+        if((msg = get_scriptparam_string(note, "TOn", "TurnOn")) != NULL) {
             messages[1] = msg;
             isstim[1] = check_stimulus_message(msg, &stimob[1], &intensity[1]);
 
@@ -55,26 +69,30 @@ void TWBaseTrigger::init(int time)
         }
 
         // And where the messages should go
-        if((msg = get_scriptparam_string(design_note, "TDest", "&ControlDevice")) != NULL) {
+        if((msg = get_scriptparam_string(note, "TDest", "&ControlDevice")) != NULL) {
             dest_str = msg;
             g_pMalloc -> Free(msg);
         }
 
-        remove_links = get_scriptparam_bool(design_note, "KillLinks");
+        remove_links = get_scriptparam_bool(note, "KillLinks");
 
         // Allow triggers to fail
-        fail_chance = get_scriptparam_int(design_note, "FailChance", 0, fail_qvar);
+        fail_chance = get_scriptparam_int(note, "FailChance", 0, fail_qvar);
 
         // Now for use limiting.
-        get_scriptparam_valuefalloff(design_note, "Count", &value, &falloff, &limit);
+        get_scriptparam_valuefalloff(note, "Count", &value, &falloff, &limit);
         count.init(time, 0, value, falloff, false, limit);
 
         // Handle modes
-        count_mode = get_scriptparam_countmode(design_note, "CountOnly");
+        count_mode = get_scriptparam_countmode(note, "CountOnly");
 
         g_pMalloc -> Free(design_note);
     }
 
+    // The destination is fixed from here on, so parse it once now
+    if(!compile_target_query(dest_str.c_str(), dest_query))
+        debug_printf(DL_WARNING, "Unable to parse destination '%s'", dest_str.c_str());
+
     if(debug_enabled()) {
         debug_printf(DL_DEBUG, "Trigger initialised with on = '%s', off = '%s', dest = '%s'.\nChosen links will%s be deleted.", messages[1].c_str(), messages[0].c_str(), dest_str.c_str(), (remove_links ? "" : " not"));
         debug_printf(DL_DEBUG, "On is%s a stimulus", (isstim[1] ? "" : " not"));
@@ -118,7 +136,7 @@ bool TWBaseTrigger::check_stimulus_message(char *message, int *obj, float *inten
     if(!*end) return false;
 
     // end now contains the name of an object, so try to locate it
-    SInterface<IObjectSystem> ObjectSys(g_pScriptManager);
+    SInterface<IObjectSystem>& ObjectSys = ScriptServices::object_system();
     *obj = ObjectSys -> GetObjectNamed(end);
 
     // The stimulus must be a negative (ie: a stimulus archetype)
@@ -135,7 +153,7 @@ bool TWBaseTrigger::check_stimulus_message(char *message, int *obj, float *inten
 
 bool TWBaseTrigger::send_trigger_message(bool send_on, sScrMsg* msg)
 {
-    std::vector<TargetObj>* targets = NULL;
+    std::vector<TargetObj> targets;
 
     if(debug_enabled())
         debug_printf(DL_DEBUG, "Doing %s trigger", (send_on ? "On" : "Off"));
@@ -151,20 +169,23 @@ bool TWBaseTrigger::send_trigger_message(bool send_on, sScrMsg* msg)
             debug_printf(DL_WARNING, "Count passed (%d of %d), doing trigger", counted, max);
         }
 
-        targets = get_target_objects(dest_str.c_str(), msg);
+        // Borrow the reusable target list; it is swapped rather than used directly
+        // as stimulating objects may deliver messages back to this script.
+        targets.swap(target_scratch);
+        get_target_objects(targets, dest_query, msg);
 
-        if(!targets -> empty()) {
+        if(!targets.empty()) {
             std::vector<TargetObj>::iterator it;
-            SService<IActReactSrv> ar_srv(g_pScriptManager);
+            SService<IActReactSrv>& ar_srv = ScriptServices::act_react();
 
             // Convert the bool to an index into the various arrays
             int send = (send_on ? 1 : 0);
 
-            for(it = targets -> begin(); it != targets -> end(); it++) {
+            for(it = targets.begin(); it != targets.end(); it++) {
                 // If sending a stim instead of a message, do that...
                 if(isstim[send]) {
                     if(debug_enabled()) {
-                        std::string objname, stimname;
+                        ScratchString objname, stimname;
                         get_object_namestr(objname, it -> obj_id);
                         get_object_namestr(stimname, stimob[send]);
 
@@ -176,7 +197,7 @@ bool TWBaseTrigger::send_trigger_message(bool send_on, sScrMsg* msg)
                 // otherwise, send the message to the target
                 } else {
                     if(debug_enabled()) {
-                        std::string objname;
+                        ScratchString objname;
                         get_object_namestr(objname, it -> obj_id);
 
                         debug_printf(DL_DEBUG, "Sending %s to %s", messages[send].c_str(), objname.c_str());
@@ -191,8 +212,8 @@ bool TWBaseTrigger::send_trigger_message(bool send_on, sScrMsg* msg)
             debug_printf(DL_WARNING, "No targets found for trigger");
         }
 
-        // No longer need the target list
-        delete targets;
+        // Hand the target list's storage back for the next trigger
+        targets.swap(target_scratch);
 
         // Indicate messages have been sent
         return true;
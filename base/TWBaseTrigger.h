@@ -29,6 +29,7 @@
 #include <string>
 #include "TWBaseScript.h"
 #include "SavedCounter.h"
+#include "IString.h"
 
 class TWBaseTrigger : public TWBaseScript
 {
@@ -46,7 +47,7 @@ public:
      */
     TWBaseTrigger(const char* name, int object) : TWBaseScript(name, object),
                                                   messages { "TurnOff", "TurnOn" }, isstim { false, false }, stimob { 0, 0 }, intensity { 0.0f, 0.0f },
-                                                  dest_str("&ControlDevice"),
+                                                  dest_str("&ControlDevice"), dest_query(),
                                                   remove_links(false),
                                                   fail_chance(0),
                                                   fail_qvar(),
@@ -54,6 +55,12 @@ public:
                                                   uni_dist(0, 100)
         { /* fnord */ }
 
+
+    /** The design note parameters read by TWBaseTrigger::init(), including those
+     *  read by TWBaseScript.
+     */
+    static const ParamSchema param_schema;
+
 protected:
     /* ------------------------------------------------------------------------
      *  Initialisation related
@@ -134,7 +141,7 @@ private:
      */
 
     // Message names
-    std::string messages[2];  //!< The name of the message that should be sent as a 'turnon' or 'turnoff'
+    IString messages[2];      //!< The name of the message that should be sent as a 'turnon' or 'turnoff'
 
     // Stimulus for on/off
     bool  isstim[2];         //!< Is the turnon message a stimulus rather than a message?
@@ -142,7 +149,8 @@ private:
     float intensity[2];      //!< The stimulus intensity to use.
 
     // Destination setting
-    std::string dest_str;    //!< Where should messages be sent?
+    IString dest_str;        //!< Where should messages be sent?
+    TargetQuery dest_query;  //!< dest_str compiled into a target query.
 
     bool remove_links;       //!< Remove links after sending messages?
 
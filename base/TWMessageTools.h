@@ -25,46 +25,13 @@
 #include <cstring>
 #include <cctype>
 #include "scriptvars.h"
+#include "CharHash.h"
 
 /** Function pointer type for message field access functions. All message
  *  field accessor functions must have this fingerprint.
  */
 typedef void (*MessageAccessProc)(cMultiParm&, sScrMsg*);
 
-struct char_icmp
-{
-    bool operator () (const char* a ,const char* b) const {
-        while(*a && *b) {
-            if(tolower(*a) != tolower(*b)) return false;
-            ++a;
-            ++b;
-        }
-        return(*a == *b);
-    }
-};
-
-
-struct char_hash
-{
-    /** Hashing operator based on the sdbm algorith, see this URL
-     *  http://www.cse.yorku.ca/~oz/hash.html for more details.
-     */
-    size_t operator()(const char* str) const {
-        size_t hash = 0;
-        int c;
-
-        /* Note the tolower here is not standard: I've added it to make the
-         * hash case insensitive.
-         */
-        while((c = tolower(*str++))) {
-            hash = c + (hash << 6) + (hash << 16) - hash;
-        }
-
-        return hash;
-    }
-};
-
-
 /** A map type for fast lookup of accessor functions for named message types.
  *  I'd *much* rather use std::string as the key, but this will need to be
  *  find()able with a char *, and while there is an implicit converstion, it
@@ -0,0 +1,284 @@
+
+#include <lg/interface.h>
+#include <lg/scrmanagers.h>
+#include "TimerWheel.h"
+#include "ScriptModule.h"
+
+/* ------------------------------------------------------------------------
+ *  Client
+ */
+
+TimerWheel::Client::~Client()
+{
+    TimerWheel& wheel = TimerWheel::get();
+
+    wheel.cancel(this);
+    wheel.host_gone(wheel_host);
+}
+
+
+/* ------------------------------------------------------------------------
+ *  Public interface
+ */
+
+TimerWheel& TimerWheel::get()
+{
+    static TimerWheel wheel;
+
+    return wheel;
+}
+
+
+void TimerWheel::schedule(Client* client, int host, uint now, uint due)
+{
+    cancel(client);
+
+    // An empty wheel can be moved straight to the current time. This is also
+    // what resynchronises the wheel after a saved game has been loaded, when
+    // any timer thought to be pending may have gone with the old session.
+    if(!count) {
+        now_tick = now / TICK_MS;
+        now_ms   = now;
+        armed    = false;
+    } else if(now > now_ms) {
+        now_ms = now;
+    }
+
+    client -> wheel_due  = (due + TICK_MS - 1) / TICK_MS;
+    client -> wheel_host = host;
+    if(client -> wheel_due <= now_tick)
+        client -> wheel_due = now_tick + 1;
+
+    insert(client);
+    ++count;
+
+    if(!ticking)
+        arm_driver();
+}
+
+
+void TimerWheel::cancel(Client* client)
+{
+    if(!client -> wheel_scheduled()) return;
+
+    unlink(client);
+    --count;
+}
+
+
+void TimerWheel::host_gone(int host)
+{
+    // If the engine timer was sent to this object, it may be about to
+    // disappear along with the object, so send a new one elsewhere.
+    if(armed && armed_host == host && !ticking) {
+        armed = false;
+        arm_driver();
+    }
+}
+
+
+void TimerWheel::tick(sScrTimerMsg* tick)
+{
+    // Clients may schedule and cancel each other while being called, but the
+    // engine will not deliver another timer until they have all returned.
+    if(ticking) return;
+
+    if(tick -> time > now_ms)
+        now_ms = tick -> time;
+
+    // The timer that was armed has arrived. Anything else is an extra copy,
+    // or left over from a previous session.
+    if(armed && tick -> time >= armed_ms)
+        armed = false;
+
+    ticking = true;
+
+    uint to_tick = tick -> time / TICK_MS;
+    while(now_tick < to_tick) {
+        if(!count) {
+            now_tick = to_tick;
+            break;
+        }
+
+        // Skip straight to the next occupied slot in this turn of level 0, or
+        // the end of the turn if there are none.
+        uint pos = now_tick & SLOT_MASK;
+        unsigned long long ahead = used[0] & ~((2ULL << pos) - 1);
+        uint target;
+        if(ahead) {
+            uint slot = pos + 1;
+            while(!(ahead & (1ULL << slot))) ++slot;
+            target = (now_tick & ~SLOT_MASK) | slot;
+        } else {
+            target = (now_tick | SLOT_MASK) + 1;
+        }
+
+        if(target > to_tick) {
+            now_tick = to_tick;
+            break;
+        }
+        now_tick = target;
+
+        // At the start of each turn, bring down anything due during it.
+        pos = now_tick & SLOT_MASK;
+        if(!pos) {
+            uint pos1 = (now_tick >> SLOT_BITS) & SLOT_MASK;
+            if(!pos1)
+                cascade(2, (now_tick >> (SLOT_BITS * 2)) & SLOT_MASK);
+            cascade(1, pos1);
+        }
+
+        fire(pos, tick);
+    }
+
+    ticking = false;
+
+    arm_driver();
+}
+
+
+/* ------------------------------------------------------------------------
+ *  Private members
+ */
+
+TimerWheel::TimerWheel() : now_tick(0), now_ms(0), count(0), ticking(false), armed(false), armed_ms(0), armed_host(0)
+{
+    for(uint level = 0; level < LEVELS; ++level) {
+        used[level] = 0;
+        for(uint slot = 0; slot < SLOTS; ++slot) {
+            slots[level][slot].prev = slots[level][slot].next = &slots[level][slot];
+        }
+    }
+}
+
+
+void TimerWheel::insert(Client* client)
+{
+    uint due = client -> wheel_due;
+
+    // Anything beyond the current turn of the top level waits at its end. If
+    // the wheel is at the very end of a turn, the next turn is available.
+    uint limit = ((now_tick + 1) | ((1 << (SLOT_BITS * LEVELS)) - 1));
+    if(due > limit) due = limit;
+
+    // Place the client in the lowest level where its due tick falls within
+    // the current turn, so that it is always moved down before it is due.
+    uint level = 0;
+    while(level < LEVELS - 1 && ((due ^ now_tick) >> (SLOT_BITS * (level + 1))))
+        ++level;
+
+    uint slot = (due >> (SLOT_BITS * level)) & SLOT_MASK;
+
+    Link* head = &slots[level][slot];
+    Link* link = client;
+    link -> prev = head -> prev;
+    link -> next = head;
+    head -> prev -> next = link;
+    head -> prev = link;
+
+    used[level] |= 1ULL << slot;
+    client -> wheel_level = level;
+    client -> wheel_slot  = slot;
+}
+
+
+void TimerWheel::unlink(Client* client)
+{
+    Link* link = client;
+    link -> prev -> next = link -> next;
+    link -> next -> prev = link -> prev;
+    link -> prev = link -> next = NULL;
+
+    Link* head = &slots[client -> wheel_level][client -> wheel_slot];
+    if(head -> next == head)
+        used[client -> wheel_level] &= ~(1ULL << client -> wheel_slot);
+}
+
+
+void TimerWheel::cascade(uint level, uint slot)
+{
+    Link* head = &slots[level][slot];
+
+    while(head -> next != head) {
+        Client* client = static_cast<Client*>(head -> next);
+        unlink(client);
+        insert(client);
+    }
+}
+
+
+void TimerWheel::fire(uint slot, sScrTimerMsg* tick)
+{
+    Link* head = &slots[0][slot];
+
+    // Calling a client may cause others in the slot to be cancelled or moved,
+    // so take them off one at a time rather than walking the list.
+    while(head -> next != head) {
+        Client* client = static_cast<Client*>(head -> next);
+        unlink(client);
+
+        // Parked clients are not due yet, they just go back on the wheel.
+        if(client -> wheel_due > now_tick) {
+            insert(client);
+            continue;
+        }
+
+        --count;
+        client -> on_wheel_timer(tick, client -> wheel_due * TICK_MS);
+    }
+}
+
+
+uint TimerWheel::next_wake(int& host) const
+{
+    uint pos = now_tick & SLOT_MASK;
+    unsigned long long ahead = used[0] & ~((2ULL << pos) - 1);
+
+    if(ahead) {
+        uint slot = pos + 1;
+        while(!(ahead & (1ULL << slot))) ++slot;
+
+        host = static_cast<const Client*>(slots[0][slot].next) -> wheel_host;
+        return (now_tick & ~SLOT_MASK) | slot;
+    }
+
+    // Nothing more this turn, so wake up at the start of the next one and
+    // cascade. Any scheduled client's object will do to receive the timer.
+    for(uint level = 0; level < LEVELS; ++level) {
+        if(used[level]) {
+            uint slot = 0;
+            while(!(used[level] & (1ULL << slot))) ++slot;
+
+            host = static_cast<const Client*>(slots[level][slot].next) -> wheel_host;
+            break;
+        }
+    }
+
+    return (now_tick | SLOT_MASK) + 1;
+}
+
+
+void TimerWheel::arm_driver()
+{
+    if(!count) {
+        // Nothing to wait for. Any timer still pending will simply find
+        // nothing to do.
+        armed = false;
+        return;
+    }
+
+    int host = 0;
+    uint wake_ms = next_wake(host) * TICK_MS;
+
+    // A timer is already pending that will arrive in time. Timers are never
+    // cancelled, as the handle may belong to a previous session.
+    if(armed && armed_ms <= wake_ms)
+        return;
+
+    uint delay = (wake_ms > now_ms) ? (wake_ms - now_ms) : 1;
+    g_pScriptManager -> SetTimedMessage2(host, "TWWheelTick", delay, kSTM_OneShot, cMultiParm::Undef);
+
+    armed      = true;
+    armed_ms   = wake_ms;
+    armed_host = host;
+}
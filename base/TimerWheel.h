@@ -0,0 +1,185 @@
+/** @file
+ * This file contains the interface for the module-wide timer wheel, which
+ * multiplexes the periodic timers used by polling scripts onto a single
+ * engine timer.
+ *
+ * @author Chris Page &lt;chris@starforge.co.uk&gt;
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <lg/config.h>
+#include <lg/objstd.h>
+#include <lg/scrmsgs.h>
+
+/** A hierarchical timer wheel shared by all the scripts in the module. Rather
+ *  than each polling script keeping its own timer in the engine's queue, they
+ *  register with the wheel, and the wheel keeps a single one-shot engine
+ *  timer (named "TWWheelTick") armed for the next time anything is due. When
+ *  that timer arrives, the wheel advances and calls the clients that are due
+ *  directly.
+ *
+ *  The wheel has three levels of 64 slots. The first level has one slot per
+ *  50ms tick, each slot of the second level covers a full turn of the first,
+ *  and so on, so timers up to about three and a half hours away can be held
+ *  without sorting. Anything further away than that is parked at the end of
+ *  the top level, and put back on the wheel when that slot is reached.
+ *
+ *  The wheel only lives as long as the module, so clients are responsible for
+ *  persisting anything they need to reschedule themselves after a saved game
+ *  is loaded.
+ */
+class TimerWheel
+{
+    struct Link {
+        Link* prev;
+        Link* next;
+    };
+
+public:
+    /** The base class for anything that can be scheduled on the wheel. A
+     *  client can be scheduled at most once at a time. Destroying a client
+     *  removes it from the wheel.
+     */
+    class Client : private Link
+    {
+    public:
+        Client() : wheel_due(0), wheel_host(0), wheel_level(0), wheel_slot(0)
+            { prev = next = NULL; }
+
+        virtual ~Client();
+
+        /** Determine whether the client is currently scheduled.
+         *
+         * @return true if the client is scheduled, false otherwise.
+         */
+        bool wheel_scheduled() const
+            { return next != NULL; }
+
+    protected:
+        /** Called by the wheel when the client's timer expires. The client
+         *  is no longer scheduled when this is called, so it may reschedule
+         *  itself.
+         *
+         * @param tick The engine timer message that drove the wheel.
+         * @param due  The sim time at which the client was due.
+         */
+        virtual void on_wheel_timer(sScrTimerMsg* tick, uint due) = 0;
+
+    private:
+        friend class TimerWheel;
+
+        uint  wheel_due;   //!< The tick the client is due at.
+        int   wheel_host;  //!< The object the client is attached to.
+        uchar wheel_level; //!< The level of the slot the client is in.
+        uchar wheel_slot;  //!< The index of the slot the client is in.
+    };
+
+
+    /** Obtain a reference to the module's timer wheel.
+     *
+     * @return A reference to the wheel.
+     */
+    static TimerWheel& get();
+
+
+    /** Schedule the specified client. If the client is already scheduled, it
+     *  is moved to the new time.
+     *
+     * @param client The client to schedule.
+     * @param host   The ID of the object the client is attached to. The engine
+     *               timer that drives the wheel is always sent to an object
+     *               with a scheduled client.
+     * @param now    The current sim time.
+     * @param due    The sim time at which the client should be called. This
+     *               is rounded up to the next 50ms tick.
+     */
+    void schedule(Client* client, int host, uint now, uint due);
+
+
+    /** Remove the specified client from the wheel, if it is scheduled.
+     *
+     * @param client The client to remove.
+     */
+    void cancel(Client* client);
+
+
+    /** Note that the object with the specified ID may be about to be
+     *  destroyed. If the wheel's engine timer was sent to it, a new one is
+     *  sent to another object. Destroying a client does this automatically.
+     *
+     * @param host The ID of the object that may be going away.
+     */
+    void host_gone(int host);
+
+
+    /** Advance the wheel to the time in the specified engine timer message,
+     *  calling any clients that are due. This should be called when a script
+     *  receives the "TWWheelTick" timer. It is safe to call this more than
+     *  once for the same message, as happens when more than one script on the
+     *  same object receives it.
+     *
+     * @param tick The timer message received.
+     */
+    void tick(sScrTimerMsg* tick);
+
+private:
+    TimerWheel();
+
+    /** Add a client to the slot appropriate for its due time.
+     */
+    void insert(Client* client);
+
+    /** Remove a client from whatever list it is in.
+     */
+    void unlink(Client* client);
+
+    /** Move all the clients in a slot of a higher level down the wheel.
+     */
+    void cascade(uint level, uint slot);
+
+    /** Call all the clients in the level 0 slot for the current tick.
+     */
+    void fire(uint slot, sScrTimerMsg* tick);
+
+    /** Work out the tick at which the wheel next needs to advance, and the
+     *  object the engine timer should be sent to.
+     */
+    uint next_wake(int& host) const;
+
+    /** Make sure an engine timer is armed for the next wake time.
+     */
+    void arm_driver();
+
+    static const uint TICK_MS   = 50;
+    static const uint LEVELS    = 3;
+    static const uint SLOT_BITS = 6;
+    static const uint SLOTS     = 1 << SLOT_BITS;
+    static const uint SLOT_MASK = SLOTS - 1;
+
+    Link slots[LEVELS][SLOTS];       //!< Circular lists of clients in each slot.
+    unsigned long long used[LEVELS]; //!< Bitmaps of the non-empty slots in each level.
+    uint now_tick;                   //!< The tick the wheel has advanced to.
+    uint now_ms;                     //!< The latest sim time seen.
+    uint count;                      //!< The number of scheduled clients.
+    bool ticking;                    //!< Is the wheel calling clients?
+    bool armed;                      //!< Is an engine timer pending?
+    uint armed_ms;                   //!< The sim time the pending engine timer is due.
+    int  armed_host;                 //!< The object the pending engine timer was sent to.
+};
+
+#endif // TIMERWHEEL_H
@@ -75,7 +75,16 @@ void operator delete[](void* ptr, const std::nothrow_t&) throw()
 		g_Allocator.Free(ptr);
 }
 
-cMemoryAllocator::AllocRecord cMemoryAllocator::nullrecord;
+const ulong cMemoryAllocator::s_slabsizes[cMemoryAllocator::SLAB_CLASSES] = {
+	8, 16, 24, 32, 48, 64, 96, 128, 192, 256
+};
+
+// Maps (size + 7) / 8 to the smallest size class that can hold it.
+const unsigned char cMemoryAllocator::s_slabindex[cMemoryAllocator::SLAB_MAX_SIZE/8 + 1] = {
+	0, 0, 1, 2, 3, 4, 4, 5, 5, 6, 6, 6, 6, 7, 7, 7,
+	7, 8, 8, 8, 8, 8, 8, 8, 8, 9, 9, 9, 9, 9, 9, 9,
+	9
+};
 
 cMemoryAllocator::cMemoryAllocator()
 {
@@ -83,11 +92,43 @@ cMemoryAllocator::cMemoryAllocator()
 #ifdef DEBUG
 	m_dballoc = NULL;
 #endif
-	m_recordhead = &nullrecord;
+	m_records.init_sentinel();
+	memset(m_slabs, 0, sizeof(m_slabs));
+	m_chunks = NULL;
+	m_numallocs = 0;
+	m_grosstotal = 0;
+	m_numreallocs = 0;
+	m_liveblocks = 0;
+	m_livebytes = 0;
+	m_peakbytes = 0;
+	memset(m_sizes, 0, sizeof(m_sizes));
+	memset(m_owners, 0, sizeof(m_owners));
+	strcpy(m_owners[0].name, "(module)");
+	m_numowners = 1;
+	m_owner = 0;
 }
 
 cMemoryAllocator::~cMemoryAllocator()
 {
+	// Chunks can only be handed back if nothing still points into them.
+	// Static objects destroyed after this one may still free blocks,
+	// so if any are live the chunks are left for the engine to reclaim.
+	bool inuse = false;
+	for (uint cls = 0; cls < SLAB_CLASSES; ++cls)
+	{
+		if (m_slabs[cls].live)
+			inuse = true;
+	}
+	if (m_alloc && !inuse)
+	{
+		while (m_chunks)
+		{
+			SlabChunk* chunk = m_chunks;
+			m_chunks = chunk->next;
+			m_alloc->Free(chunk);
+		}
+		memset(m_slabs, 0, sizeof(m_slabs));
+	}
 	if (m_alloc)
 		m_alloc->Release();
 #ifdef DEBUG
@@ -116,59 +157,256 @@ IMalloc* cMemoryAllocator::AttachMalloc(IMalloc* allocator, const char* module)
 
 ulong cMemoryAllocator::CountAlloc(void)
 {
-#ifdef DEBUG
 	return m_numallocs;
-#else
-	return (ulong)-1;
-#endif
 }
 
 ulong cMemoryAllocator::CountAverage(void)
 {
-#ifdef DEBUG
+	if (!m_numallocs)
+		return 0;
 	return m_grosstotal / m_numallocs;
-#else
-	return (ulong)-1;
-#endif
 }
 
 ulong cMemoryAllocator::CountBlocks(void)
 {
-#ifdef DEBUG
-	ulong num = 0;
-	AllocRecord *rec;
-	for (rec = m_recordhead;
-		 rec->next != rec;
-		 rec = rec->next)
+	return m_liveblocks;
+}
+
+ulong cMemoryAllocator::CountSize(void)
+{
+	return m_livebytes;
+}
+
+bool cMemoryAllocator::GetSlabStats(uint sizeclass, SlabStats& stats) const
+{
+	if (sizeclass >= SLAB_CLASSES)
+		return false;
+	stats.blocksize = s_slabsizes[sizeclass];
+	stats.chunks = m_slabs[sizeclass].chunks;
+	stats.live = m_slabs[sizeclass].live;
+	stats.peak = m_sizes[sizeclass].peak;
+	stats.total = m_sizes[sizeclass].total;
+	stats.bytes = m_sizes[sizeclass].bytes;
+	return true;
+}
+
+bool cMemoryAllocator::GetSizeStats(uint sizeclass, UsageStats& stats) const
+{
+	if (sizeclass >= SIZE_CLASSES)
+		return false;
+	stats.name = NULL;
+	if (sizeclass < SLAB_CLASSES)
+		stats.maxsize = s_slabsizes[sizeclass];
+	else if (sizeclass < SIZE_CLASSES-1)
+		stats.maxsize = (SLAB_MAX_SIZE*2) << (sizeclass - SLAB_CLASSES);
+	else
+		stats.maxsize = (ulong)-1;
+	stats.live = m_sizes[sizeclass].live;
+	stats.peak = m_sizes[sizeclass].peak;
+	stats.total = m_sizes[sizeclass].total;
+	stats.bytes = m_sizes[sizeclass].bytes;
+	stats.peakbytes = m_sizes[sizeclass].peakbytes;
+	return true;
+}
+
+uint cMemoryAllocator::RegisterOwner(const char* name)
+{
+	if (!name)
+		return 0;
+	for (uint slot = 1; slot < m_numowners; ++slot)
 	{
-		num++;
+		if (!strncmp(m_owners[slot].name, name, sizeof(m_owners[slot].name)-1))
+			return slot;
 	}
-	return num;
-#else
-	return (ulong)-1;
-#endif
+	if (m_numowners >= MAX_OWNERS)
+		return 0;
+	OwnerSlot& slot = m_owners[m_numowners];
+	strncpy(slot.name, name, sizeof(slot.name)-1);
+	slot.name[sizeof(slot.name)-1] = '\0';
+	return m_numowners++;
+}
+
+bool cMemoryAllocator::GetOwnerStats(uint owner, UsageStats& stats) const
+{
+	if (owner >= m_numowners)
+		return false;
+	const Counters& counts = m_owners[owner].counts;
+	stats.name = m_owners[owner].name;
+	stats.maxsize = (ulong)-1;
+	stats.live = counts.live;
+	stats.peak = counts.peak;
+	stats.total = counts.total;
+	stats.bytes = counts.bytes;
+	stats.peakbytes = counts.peakbytes;
+	return true;
+}
+
+uint cMemoryAllocator::SizeBucket(ulong size)
+{
+	if (size <= SLAB_MAX_SIZE)
+		return s_slabindex[(size + 7) >> 3];
+	uint bucket = SLAB_CLASSES;
+	ulong limit = SLAB_MAX_SIZE * 2;
+	while (size > limit && bucket < SIZE_CLASSES-1)
+	{
+		limit <<= 1;
+		++bucket;
+	}
+	return bucket;
 }
 
-ulong cMemoryAllocator::CountSize(void)
+static inline void CountUp(ulong& live, ulong& peak)
 {
-#ifdef DEBUG
-	ulong size = 0;
-	AllocRecord *rec;
-	for (rec = m_recordhead;
-		 rec->next != rec;
-		 rec = rec->next)
+	if (++live > peak)
+		peak = live;
+}
+
+void cMemoryAllocator::AccountAlloc(ulong size, uint owner)
+{
+	m_numallocs++;
+	m_grosstotal += size;
+	m_liveblocks++;
+	m_livebytes += size;
+	if (m_livebytes > m_peakbytes)
+		m_peakbytes = m_livebytes;
+
+	Counters* counts[2] = { &m_sizes[SizeBucket(size)], &m_owners[owner].counts };
+	for (uint i = 0; i < 2; ++i)
 	{
-		size += rec->size;
+		CountUp(counts[i]->live, counts[i]->peak);
+		counts[i]->total++;
+		counts[i]->bytes += size;
+		if (counts[i]->bytes > counts[i]->peakbytes)
+			counts[i]->peakbytes = counts[i]->bytes;
 	}
-	return size;
-#else
-	return (ulong)-1;
-#endif
 }
 
-STDMETHODIMP_(void*) cMemoryAllocator::Alloc(ulong size)
+void cMemoryAllocator::AccountFree(ulong size, uint owner)
 {
-	assert(m_alloc != NULL);
+	m_liveblocks--;
+	m_livebytes -= size;
+
+	Counters* counts[2] = { &m_sizes[SizeBucket(size)], &m_owners[owner].counts };
+	for (uint i = 0; i < 2; ++i)
+	{
+		counts[i]->live--;
+		counts[i]->bytes -= size;
+	}
+}
+
+// A realloc changes the size of a block without making a new one, so
+// it is not counted in the totals, and the block stays with the owner
+// it was first credited to.
+void cMemoryAllocator::AccountRealloc(ulong oldsize, ulong size, uint owner)
+{
+	m_numreallocs++;
+	m_livebytes += size - oldsize;
+	if (m_livebytes > m_peakbytes)
+		m_peakbytes = m_livebytes;
+
+	Counters& owned = m_owners[owner].counts;
+	owned.bytes += size - oldsize;
+	if (owned.bytes > owned.peakbytes)
+		owned.peakbytes = owned.bytes;
+
+	uint from = SizeBucket(oldsize);
+	uint to = SizeBucket(size);
+	if (from != to)
+	{
+		m_sizes[from].live--;
+		CountUp(m_sizes[to].live, m_sizes[to].peak);
+	}
+	m_sizes[from].bytes -= oldsize;
+	m_sizes[to].bytes += size;
+	if (m_sizes[to].bytes > m_sizes[to].peakbytes)
+		m_sizes[to].peakbytes = m_sizes[to].bytes;
+}
+
+bool cMemoryAllocator::SlabRefill(uint sizeclass)
+{
+	SlabChunk* chunk = static_cast<SlabChunk*>(m_alloc->Alloc(SLAB_CHUNK_SIZE));
+	if (!chunk)
+		return false;
+	chunk->next = m_chunks;
+	chunk->sizeclass = sizeclass;
+	m_chunks = chunk;
+
+	// Split the rest of the chunk into blocks and put them all on the
+	// free list, lowest address first.
+	ulong stride = sizeof(SlabHeader) + s_slabsizes[sizeclass];
+	char* base = reinterpret_cast<char*>(chunk+1);
+	ulong count = (SLAB_CHUNK_SIZE - sizeof(SlabChunk)) / stride;
+	SlabClass& slab = m_slabs[sizeclass];
+	while (count--)
+	{
+		SlabHeader* hdr = reinterpret_cast<SlabHeader*>(base + count*stride);
+		hdr->info = sizeclass;
+		hdr->check = 0;
+		hdr->next_free() = slab.freelist;
+		slab.freelist = hdr;
+	}
+	slab.chunks++;
+	return true;
+}
+
+void* cMemoryAllocator::SlabAlloc(ulong size, uint owner)
+{
+	uint cls = s_slabindex[(size + 7) >> 3];
+	SlabClass& slab = m_slabs[cls];
+	if (!slab.freelist && !SlabRefill(cls))
+		return NULL;
+	SlabHeader* hdr = slab.freelist;
+	slab.freelist = hdr->next_free();
+	hdr->set(cls, size, owner);
+	slab.live++;
+	return hdr+1;
+}
+
+void* cMemoryAllocator::SlabRealloc(SlabHeader* hdr, ulong size)
+{
+	// Shrinking, or growing within the block's size class, can be
+	// done in place.
+	if (size <= s_slabsizes[hdr->sizeclass()])
+	{
+		AccountRealloc(hdr->reqsize(), size, hdr->owner());
+		hdr->set(hdr->sizeclass(), size, hdr->owner());
+		return hdr+1;
+	}
+	ulong oldsize = hdr->reqsize();
+	uint owner = hdr->owner();
+	void* ptr = BlockAlloc(size, owner);
+	if (!ptr)
+		return NULL;
+	memcpy(ptr, hdr+1, oldsize);
+	SlabRelease(hdr);
+	AccountRealloc(oldsize, size, owner);
+	return ptr;
+}
+
+void cMemoryAllocator::SlabRelease(SlabHeader* hdr)
+{
+	SlabClass& slab = m_slabs[hdr->sizeclass()];
+	hdr->check = 0;
+	hdr->next_free() = slab.freelist;
+	slab.freelist = hdr;
+	slab.live--;
+}
+
+void cMemoryAllocator::SlabFree(SlabHeader* hdr)
+{
+	AccountFree(hdr->reqsize(), hdr->owner());
+	SlabRelease(hdr);
+}
+
+// Allocate a block credited to the given owner, without counting it.
+void* cMemoryAllocator::BlockAlloc(ulong size, uint owner)
+{
+	if (size <= SLAB_MAX_SIZE)
+	{
+		void* ptr = SlabAlloc(size, owner);
+		if (ptr)
+			return ptr;
+	}
 	AllocRecord* rec;
 #ifdef DEBUG
 	if (m_dballoc)
@@ -176,15 +414,23 @@ STDMETHODIMP_(void*) cMemoryAllocator::Alloc(ulong size)
 	else
 #endif
 		rec = static_cast<AllocRecord*>(m_alloc->Alloc(size+sizeof(AllocRecord)));
-	rec->insert(&m_recordhead);
+	if (!rec)
+		return NULL;
+	rec->insert(&m_records);
 	rec->size = size;
-#ifdef DEBUG
-	m_numallocs++;
-	m_grosstotal += size;
-#endif
+	rec->owner = owner;
 	return rec+1;
 }
 
+STDMETHODIMP_(void*) cMemoryAllocator::Alloc(ulong size)
+{
+	assert(m_alloc != NULL);
+	void* ptr = BlockAlloc(size, m_owner);
+	if (ptr)
+		AccountAlloc(size, m_owner);
+	return ptr;
+}
+
 STDMETHODIMP_(void*) cMemoryAllocator::Realloc(void* ptr, ulong size)
 {
 	assert(m_alloc != NULL);
@@ -195,9 +441,15 @@ STDMETHODIMP_(void*) cMemoryAllocator::Realloc(void* ptr, ulong size)
 		Free(ptr);
 		return NULL;
 	}
-	AllocRecord* rec = static_cast<AllocRecord*>(ptr)-1;
-	if (rec->remove(&m_recordhead))
+	SlabHeader* hdr = get_slab(ptr);
+	if (hdr)
+		return SlabRealloc(hdr, size);
+	AllocRecord* rec = get_record(ptr);
+	if (rec->is_live())
 	{
+		ulong oldsize = rec->size;
+		uint owner = rec->owner;
+		rec->remove();
 		AllocRecord* newrec;
 #ifdef DEBUG
 		if (m_dballoc)
@@ -207,14 +459,11 @@ STDMETHODIMP_(void*) cMemoryAllocator::Realloc(void* ptr, ulong size)
 			newrec = static_cast<AllocRecord*>(m_alloc->Realloc(rec, size+sizeof(AllocRecord)));
 		if (!newrec)
 		{
-			rec->insert(&m_recordhead);
+			rec->insert(&m_records);
 			return NULL;
 		}
-#ifdef DEBUG
-		if (size > rec->size)
-			m_grosstotal += size - rec->size;
-#endif
-		newrec->insert(&m_recordhead);
+		AccountRealloc(oldsize, size, owner);
+		newrec->insert(&m_records);
 		newrec->size = size;
 		return newrec+1;
 	}
@@ -228,9 +477,19 @@ STDMETHODIMP_(void*) cMemoryAllocator::Realloc(void* ptr, ulong size)
 STDMETHODIMP_(void) cMemoryAllocator::Free(void* ptr)
 {
 	assert(m_alloc != NULL);
-	AllocRecord* rec = static_cast<AllocRecord*>(ptr)-1;
-	if (rec->remove(&m_recordhead))
+	if (!ptr)
+		return;
+	SlabHeader* hdr = get_slab(ptr);
+	if (hdr)
 	{
+		SlabFree(hdr);
+		return;
+	}
+	AllocRecord* rec = get_record(ptr);
+	if (rec->is_live())
+	{
+		AccountFree(rec->size, rec->owner);
+		rec->remove();
 #ifdef DEBUG
 		if (m_dballoc)
 			m_dballoc->FreeEx(rec, m_module, 0);
@@ -254,9 +513,11 @@ STDMETHODIMP_(ulong) cMemoryAllocator::GetSize(void* ptr)
 	assert(m_alloc != NULL);
 	if (!ptr)
 		return (ulong)-1;
-	AllocRecord* rec = static_cast<AllocRecord*>(ptr)-1;
-	rec = rec->find(m_recordhead);
-	if (rec)
+	SlabHeader* hdr = get_slab(ptr);
+	if (hdr)
+		return hdr->reqsize();
+	AllocRecord* rec = get_record(ptr);
+	if (rec->is_live())
 		return rec->size;
 	return m_alloc->GetSize(ptr);
 }
@@ -266,9 +527,10 @@ STDMETHODIMP_(int) cMemoryAllocator::DidAlloc(void* ptr)
 	assert(m_alloc != NULL);
 	if (!ptr)
 		return 0;
-	AllocRecord* rec = static_cast<AllocRecord*>(ptr)-1;
-	rec = rec->find(m_recordhead);
-	if (rec)
+	if (get_slab(ptr))
+		return 1;
+	AllocRecord* rec = get_record(ptr);
+	if (rec->is_live())
 		return 1;
 	return 0;
 }
@@ -288,10 +550,12 @@ STDMETHODIMP_(void*) cMemoryAllocator::AllocEx(ulong size, const char* file, int
 		rec = static_cast<AllocRecord*>(m_dballoc->AllocEx(size+sizeof(AllocRecord), file, line));
 	else
 		rec = static_cast<AllocRecord*>(m_alloc->Alloc(size+sizeof(AllocRecord)));
-	rec->insert(&m_recordhead);
+	if (!rec)
+		return NULL;
+	rec->insert(&m_records);
 	rec->size = size;
-	m_numallocs++;
-	m_grosstotal += size;
+	rec->owner = m_owner;
+	AccountAlloc(size, m_owner);
 	return rec+1;
 }
 
@@ -305,9 +569,15 @@ STDMETHODIMP_(void*) cMemoryAllocator::ReallocEx(void* ptr, ulong size, const ch
 		Free(ptr);
 		return NULL;
 	}
-	AllocRecord* rec = static_cast<AllocRecord*>(ptr)-1;
-	if (rec->remove(&m_recordhead))
+	SlabHeader* hdr = get_slab(ptr);
+	if (hdr)
+		return SlabRealloc(hdr, size);
+	AllocRecord* rec = get_record(ptr);
+	if (rec->is_live())
 	{
+		ulong oldsize = rec->size;
+		uint owner = rec->owner;
+		rec->remove();
 		AllocRecord* newrec;
 		if (m_dballoc)
 			newrec = static_cast<AllocRecord*>(m_dballoc->ReallocEx(rec, size+sizeof(AllocRecord), file, line));
@@ -315,12 +585,11 @@ STDMETHODIMP_(void*) cMemoryAllocator::ReallocEx(void* ptr, ulong size, const ch
 			newrec = static_cast<AllocRecord*>(m_alloc->Realloc(rec, size+sizeof(AllocRecord)));
 		if (!newrec)
 		{
-			rec->insert(&m_recordhead);
+			rec->insert(&m_records);
 			return NULL;
 		}
-		if (size > rec->size)
-			m_grosstotal += size - rec->size;
-		newrec->insert(&m_recordhead);
+		AccountRealloc(oldsize, size, owner);
+		newrec->insert(&m_records);
 		newrec->size = size;
 		return newrec+1;
 	}
@@ -332,9 +601,19 @@ STDMETHODIMP_(void*) cMemoryAllocator::ReallocEx(void* ptr, ulong size, const ch
 STDMETHODIMP_(void) cMemoryAllocator::FreeEx(void* ptr, const char* file, int line)
 {
 	assert(m_alloc != NULL);
-	AllocRecord* rec = static_cast<AllocRecord*>(ptr)-1;
-	if (rec->remove(&m_recordhead))
+	if (!ptr)
+		return;
+	SlabHeader* hdr = get_slab(ptr);
+	if (hdr)
+	{
+		SlabFree(hdr);
+		return;
+	}
+	AllocRecord* rec = get_record(ptr);
+	if (rec->is_live())
 	{
+		AccountFree(rec->size, rec->owner);
+		rec->remove();
 		if (m_dballoc)
 			m_dballoc->FreeEx(rec, file, line);
 		else
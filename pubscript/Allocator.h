@@ -32,17 +32,221 @@
 #endif
 class cMemoryAllocator : public cMemoryAllocatorBase
 {
-	struct AllocRecord;
+	// Every block handed out by the allocator is preceded by one of these.
+	// The records form a circular doubly linked list through a sentinel
+	// so that a block can be unlinked without searching for it, and the
+	// check tag lets Free and friends tell whether a pointer came from
+	// here without walking the list. The owner is the statistics slot
+	// that was active when the block was allocated; the spare word
+	// keeps the record a multiple of 8 bytes.
+	struct AllocRecord
+	{
+		AllocRecord* prev;
+		AllocRecord* next;
+		ulong owner;
+		ulong spare;
+		ulong size;
+		ulong check;
+
+		static const ulong MAGIC = 0x5457A10CUL;
+
+		void init_sentinel()
+		{
+			prev = next = this;
+			owner = spare = 0;
+			size = 0;
+			check = 0;
+		}
+
+		void insert(AllocRecord* head)
+		{
+			prev = head;
+			next = head->next;
+			next->prev = this;
+			head->next = this;
+			check = reinterpret_cast<ulong>(this) ^ MAGIC;
+		}
+
+		void remove()
+		{
+			prev->next = next;
+			next->prev = prev;
+			// Clearing the tag means a second Free of the same
+			// block will not be mistaken for a live record.
+			check = 0;
+		}
+
+		bool is_live() const
+		{
+			return check == (reinterpret_cast<ulong>(this) ^ MAGIC)
+			    && prev->next == this
+			    && next->prev == this;
+		}
+	};
+
+	static AllocRecord* get_record(void* ptr)
+	{
+		return static_cast<AllocRecord*>(ptr)-1;
+	}
+
+	// Small blocks are carved out of larger chunks taken from the
+	// engine allocator, one chunk per size class. Each block has a
+	// two word header, which overlays the last two words of an
+	// AllocRecord so both kinds of block can be told apart by the
+	// word immediately before the pointer. SLAB_MAGIC is chosen so
+	// that the low bits of (SLAB_MAGIC ^ AllocRecord::MAGIC) can never
+	// match for an 8-aligned record, so the tags can't be confused.
+	struct SlabHeader
+	{
+		ulong info;		// size class in bits 0-3, requested size in 4-12, owner above
+		ulong check;
+
+		static const ulong SLAB_MAGIC = 0x51AB5EEDUL;
+
+		uint sizeclass() const { return info & 0xF; }
+		ulong reqsize() const { return (info >> 4) & 0x1FF; }
+		uint owner() const { return info >> 13; }
+
+		void set(uint cls, ulong size, uint owner)
+		{
+			info = cls | (size << 4) | (owner << 13);
+			check = reinterpret_cast<ulong>(this) ^ SLAB_MAGIC;
+		}
+
+		bool is_live() const
+		{
+			return check == (reinterpret_cast<ulong>(this) ^ SLAB_MAGIC);
+		}
+
+		SlabHeader*& next_free()
+		{
+			return *reinterpret_cast<SlabHeader**>(this+1);
+		}
+	};
+
+	struct SlabChunk
+	{
+		SlabChunk* next;
+		ulong sizeclass;
+	};
+
+	struct SlabClass
+	{
+		SlabHeader* freelist;
+		ulong chunks;
+		ulong live;
+	};
+
+	// Counters kept for every allocation, in all builds. Sizes are
+	// bucketed by slab class up to SLAB_MAX_SIZE, then by powers of
+	// two up to 64K, with a final bucket for anything larger.
+	struct Counters
+	{
+		ulong live;
+		ulong peak;
+		ulong total;
+		ulong bytes;
+		ulong peakbytes;
+	};
+
+	struct OwnerSlot
+	{
+		char name[32];
+		Counters counts;
+	};
+
+	static const uint SLAB_CLASSES = 10;
+	static const ulong SLAB_MAX_SIZE = 256;
+	static const ulong SLAB_CHUNK_SIZE = 8192;
+	static const ulong s_slabsizes[SLAB_CLASSES];
+	static const unsigned char s_slabindex[SLAB_MAX_SIZE/8 + 1];
+	static const uint SIZE_CLASSES = SLAB_CLASSES + 9;
+	static const uint MAX_OWNERS = 64;
+
+	static uint SizeBucket(ulong size);
+	void AccountAlloc(ulong size, uint owner);
+	void AccountFree(ulong size, uint owner);
+	void AccountRealloc(ulong oldsize, ulong size, uint owner);
+
+	static SlabHeader* get_slab(void* ptr)
+	{
+		SlabHeader* hdr = static_cast<SlabHeader*>(ptr)-1;
+		return hdr->is_live() ? hdr : NULL;
+	}
+
+	void* BlockAlloc(ulong size, uint owner);
+	void* SlabAlloc(ulong size, uint owner);
+	void* SlabRealloc(SlabHeader* hdr, ulong size);
+	void SlabRelease(SlabHeader* hdr);
+	void SlabFree(SlabHeader* hdr);
+	bool SlabRefill(uint sizeclass);
 
 public:
 
+	// Statistics for one slab size class. These are kept in all builds.
+	struct SlabStats
+	{
+		ulong blocksize;	// largest request served by this class
+		ulong chunks;		// chunks taken from the engine allocator
+		ulong live;			// blocks currently allocated
+		ulong peak;			// most blocks ever allocated at once
+		ulong total;		// blocks allocated since the module loaded
+		ulong bytes;		// bytes requested by the live blocks
+	};
+
+	// Statistics for allocations of a range of sizes, or for the
+	// allocations credited to one owner. Available in all builds.
+	struct UsageStats
+	{
+		const char* name;	// owner name, NULL for size classes
+		ulong maxsize;		// largest size counted, (ulong)-1 if unbounded
+		ulong live;			// blocks currently allocated
+		ulong peak;			// most blocks ever allocated at once
+		ulong total;		// blocks allocated since the module loaded
+		ulong bytes;		// bytes requested by the live blocks
+		ulong peakbytes;	// most bytes ever live at once
+	};
+
 	virtual ~cMemoryAllocator();
 	cMemoryAllocator();
 	IMalloc* AttachMalloc(IMalloc* allocator, const char* module);
 	ulong CountAlloc(void);
 	ulong CountAverage(void);
+	ulong CountRealloc(void) const
+	{
+		return m_numreallocs;
+	}
 	ulong CountBlocks(void);
 	ulong CountSize(void);
+	uint CountSlabClasses(void) const
+	{
+		return SLAB_CLASSES;
+	}
+	bool GetSlabStats(uint sizeclass, SlabStats& stats) const;
+	ulong CountPeakSize(void) const
+	{
+		return m_peakbytes;
+	}
+	uint CountSizeClasses(void) const
+	{
+		return SIZE_CLASSES;
+	}
+	bool GetSizeStats(uint sizeclass, UsageStats& stats) const;
+
+	// Allocations are credited to the current owner slot. Slot 0 is
+	// the module itself; RegisterOwner returns 0 if the table is full.
+	uint RegisterOwner(const char* name);
+	uint SetOwner(uint owner)
+	{
+		uint prev = m_owner;
+		m_owner = owner;
+		return prev;
+	}
+	uint CountOwners(void) const
+	{
+		return m_numowners;
+	}
+	bool GetOwnerStats(uint owner, UsageStats& stats) const;
 
 	STDMETHOD(QueryInterface)(REFIID, void** ppv)
 	{
@@ -81,61 +285,24 @@ public:
 private:
 
 	IMalloc* m_alloc;
-	AllocRecord* m_recordhead;
-#ifdef DEBUG
-	IDebugMalloc* m_dballoc;
+	AllocRecord m_records;
+	SlabClass m_slabs[SLAB_CLASSES];
+	SlabChunk* m_chunks;
 	ulong m_numallocs;
 	ulong m_grosstotal;
+	ulong m_numreallocs;
+	ulong m_liveblocks;
+	ulong m_livebytes;
+	ulong m_peakbytes;
+	Counters m_sizes[SIZE_CLASSES];
+	OwnerSlot m_owners[MAX_OWNERS];
+	uint m_numowners;
+	uint m_owner;
+#ifdef DEBUG
+	IDebugMalloc* m_dballoc;
 	char* m_module;
 #endif
 
-	struct AllocRecord
-	{
-		AllocRecord* next;
-		ulong size;
-
-		AllocRecord()
-		{
-			next = this;
-			size = 0;
-		}
-
-		void insert(AllocRecord** head)
-		{
-			next = *head;
-			*head = this;
-		}
-
-		bool remove(AllocRecord** head)
-		{
-			AllocRecord *rec;
-			for (rec = *head;
-				 rec->next != rec;
-				 head = &rec->next, rec = rec->next)
-			{
-				if (rec == this)
-				{
-					(*head) = rec->next;
-					return true;
-				}
-			}
-			return false;
-		}
-
-		AllocRecord* find(AllocRecord* rec)
-		{
-			for (; rec->next != rec; rec = rec->next)
-			{
-				if (rec == this)
-					return this;
-			}
-			return NULL;
-		}
-
-	};
-
-	static AllocRecord nullrecord;
-
 };
 
 #endif // ALLOCATOR_H
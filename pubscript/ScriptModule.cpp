@@ -21,6 +21,7 @@
 
 #include "ScriptModule.h"
 #include "Allocator.h"
+#include "ConfigBlob.h"
 
 #include <cstring>
 
@@ -46,6 +47,7 @@ cScriptModule::~cScriptModule()
 {
 	if (m_pszName != sm_ScriptModuleName)
 		delete[] m_pszName;
+	ConfigBlob::release();
 #ifdef DEBUG
 	g_pfnMPrintf("cMemoryAllocator: Current %ld blocks for %ld bytes\n", g_Allocator.CountBlocks(), g_Allocator.CountSize());
 	g_pfnMPrintf("cMemoryAllocator: Total %ld allocations avg %ld bytes\n", g_Allocator.CountAlloc(), g_Allocator.CountAverage());
@@ -123,6 +125,10 @@ ScriptModuleInit (const char* pszName,
 	if (!g_pScriptManager || !g_pMalloc)
 		return 0;
 
+	// Precompiled design notes are optional, anything not in the blob is parsed as usual
+	if (ConfigBlob::load("twscript.twc"))
+		g_pfnMPrintf("%s: using precompiled design notes from twscript.twc\n", pszName);
+
 	g_ScriptModule.SetName(pszName);
 	g_ScriptModule.QueryInterface(IID_IScriptModule, reinterpret_cast<void**>(pOutInterface));
 
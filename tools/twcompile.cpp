@@ -0,0 +1,215 @@
+/** @file
+ * twcompile - build a precompiled config blob from dumps of missions' design
+ * notes. This is a native command line tool, built with `make twcompile`,
+ * and run as:
+ *
+ *     twcompile [-o twscript.twc] dump.txt [dump2.txt ...]
+ *
+ * Each line of a dump describes one object, as three tab-separated fields:
+ * the object ID, the object name, and the design note. Blank lines, and
+ * lines starting with #, are ignored. Every distinct design note is split
+ * into parameters using the same parser as the script module, and any
+ * problems found in the notes are reported on stderr. The exit status is 1
+ * if any problems were found, 2 if the blob could not be written, and 0
+ * otherwise. The blob is written even if there are problems, as the module
+ * would have had to cope with the same notes at runtime anyway.
+ *
+ * @author Chris Page &lt;chris@starforge.co.uk&gt;
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+#include "DesignNote.h"
+#include "ConfigBlob.h"
+
+/** A distinct design note found in the dumps, and where it was first seen.
+ */
+struct NoteInfo {
+    std::string                  text;   //!< The text of the note.
+    std::string                  source; //!< The file and line the note was first seen on.
+    std::string                  object; //!< The name and ID of the object it was first seen on.
+    std::vector<DesignNote::Key> keys;   //!< The parameters in the note.
+};
+
+typedef std::map<std::string, NoteInfo> NoteMap;
+
+
+/** Ordering for notes in the blob, which must be sorted by hash.
+ */
+static bool hash_less(const ConfigBlob::Note& a, const ConfigBlob::Note& b)
+{
+    return a.hash < b.hash;
+}
+
+
+/** Read the notes from a dump file into the map of distinct notes, reporting
+ *  any problems in newly seen notes.
+ *
+ * @param filename The name of the dump to read.
+ * @param notes    The map to add the notes to.
+ * @param problems Incremented for each problem found.
+ * @return true if the file was read, false if it could not be opened.
+ */
+static bool read_dump(const char* filename, NoteMap& notes, int& problems)
+{
+    std::ifstream dump(filename);
+    if(!dump) {
+        fprintf(stderr, "twcompile: unable to open '%s'\n", filename);
+        return false;
+    }
+
+    std::string line;
+    int lineno = 0;
+
+    while(std::getline(dump, line)) {
+        ++lineno;
+
+        // Cope with dumps written on Windows
+        if(!line.empty() && line[line.size() - 1] == '\r')
+            line.erase(line.size() - 1);
+
+        if(line.empty() || line[0] == '#')
+            continue;
+
+        size_t first  = line.find('\t');
+        size_t second = (first == std::string::npos) ? first : line.find('\t', first + 1);
+        if(second == std::string::npos) {
+            fprintf(stderr, "%s:%d: expected object ID, name, and design note separated by tabs\n", filename, lineno);
+            ++problems;
+            continue;
+        }
+
+        std::string text = line.substr(second + 1);
+        if(text.empty() || notes.count(text))
+            continue;
+
+        NoteInfo& info = notes[text];
+        info.text   = text;
+        info.source = std::string(filename) + ":" + std::to_string(lineno);
+        info.object = line.substr(first + 1, second - first - 1) + " (" + line.substr(0, first) + ")";
+
+        std::vector<std::string> found;
+        DesignNote::tokenise(info.text.c_str(), info.keys, &found);
+
+        for(std::vector<std::string>::const_iterator it = found.begin(); it != found.end(); ++it) {
+            fprintf(stderr, "%s: %s: %s\n", info.source.c_str(), info.object.c_str(), it -> c_str());
+            ++problems;
+        }
+    }
+
+    return true;
+}
+
+
+/** Write the blob for the specified notes.
+ *
+ * @param filename The name of the blob to write.
+ * @param notes    The notes to write to the blob.
+ * @return true on success, false if the blob could not be written.
+ */
+static bool write_blob(const char* filename, const NoteMap& notes)
+{
+    std::vector<ConfigBlob::Note> records;
+    std::vector<DesignNote::Key>  keys;
+    std::string                   text;
+
+    for(NoteMap::const_iterator it = notes.begin(); it != notes.end(); ++it) {
+        ConfigBlob::Note record;
+        record.hash      = DesignNote::note_hash(it -> second.text.data(), it -> second.text.size());
+        record.text      = text.size();
+        record.length    = it -> second.text.size();
+        record.first_key = keys.size();
+        record.key_count = it -> second.keys.size();
+        records.push_back(record);
+
+        text += it -> second.text;
+        keys.insert(keys.end(), it -> second.keys.begin(), it -> second.keys.end());
+    }
+
+    std::stable_sort(records.begin(), records.end(), hash_less);
+
+    ConfigBlob::Header header;
+    memcpy(header.magic, "TWCB", 4);
+    header.version    = ConfigBlob::VERSION;
+    header.note_count = records.size();
+    header.key_count  = keys.size();
+    header.text_size  = text.size();
+
+    FILE* out = fopen(filename, "wb");
+    if(!out) {
+        fprintf(stderr, "twcompile: unable to create '%s'\n", filename);
+        return false;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+    if(ok && !records.empty()) ok = fwrite(&records[0], sizeof(ConfigBlob::Note), records.size(), out) == records.size();
+    if(ok && !keys.empty())    ok = fwrite(&keys[0], sizeof(DesignNote::Key), keys.size(), out) == keys.size();
+    if(ok && !text.empty())    ok = fwrite(text.data(), 1, text.size(), out) == text.size();
+    if(fclose(out)) ok = false;
+
+    if(!ok) {
+        fprintf(stderr, "twcompile: error writing '%s'\n", filename);
+        remove(filename);
+    } else {
+        printf("twcompile: wrote %u design notes with %u parameters to '%s'\n", header.note_count, header.key_count, filename);
+    }
+
+    return ok;
+}
+
+
+int main(int argc, char** argv)
+{
+    const char* output = "twscript.twc";
+    std::vector<const char*> inputs;
+
+    for(int arg = 1; arg < argc; ++arg) {
+        if(!strcmp(argv[arg], "-o") && arg + 1 < argc) {
+            output = argv[++arg];
+        } else if(argv[arg][0] == '-') {
+            fprintf(stderr, "Usage: %s [-o output.twc] dump.txt [dump2.txt ...]\n", argv[0]);
+            return 2;
+        } else {
+            inputs.push_back(argv[arg]);
+        }
+    }
+
+    if(inputs.empty()) {
+        fprintf(stderr, "Usage: %s [-o output.twc] dump.txt [dump2.txt ...]\n", argv[0]);
+        return 2;
+    }
+
+    NoteMap notes;
+    int problems = 0;
+
+    for(std::vector<const char*>::const_iterator it = inputs.begin(); it != inputs.end(); ++it) {
+        if(!read_dump(*it, notes, problems))
+            return 2;
+    }
+
+    if(!write_blob(output, notes))
+        return 2;
+
+    if(problems)
+        fprintf(stderr, "twcompile: %d problem%s found\n", problems, (problems == 1) ? "" : "s");
+
+    return problems ? 1 : 0;
+}
@@ -1,6 +1,7 @@
 #include <cmath>
 #include "TWCloudDrift.h"
 #include "ScriptLib.h"
+#include "ScriptServices.h"
 
 /* =============================================================================
  *  TWCloudDrift Implementation - protected members
@@ -24,63 +25,44 @@ void TWCloudDrift::init(int time)
     char *design_note = GetObjectParams(ObjId());
     if(!design_note) {
         debug_printf(DL_WARNING, "No Editor -> Design Note. Doing nothing.");
+        return;
+    }
 
-    } else {
+    // Clouds sharing an archetype usually share a design note, so the
+    // settings only need to be parsed for the first of them, unless they
+    // come from QVars that each cloud must read for itself.
+    if(!config.find(Name(), design_note)) {
+        DriftConfig* parsed = new DriftConfig;
+        parse_config(design_note, *parsed);
+
+        if(SharedConfig::shareable(Name(), design_note))
+            config.share(parsed, Name(), design_note);
+        else
+            config.keep(parsed);
+    }
 
-        // Nothing can be done if there's no drift setting
-        if(get_scriptparam_floatvec(design_note, "Range", driftrange)) {
-            // Drifts must be positive. Divide by two so the range is relative to the start pos.
-            driftrange.x = fabs(driftrange.x) / 2.0;
-            driftrange.y = fabs(driftrange.y) / 2.0;
-            driftrange.z = fabs(driftrange.z) / 2.0;
-
-            // And there needs to be actual drift
-            if(driftrange) {
-                const mxs_vector *location = start_position;
-
-                get_scriptparam_floatvec(design_note, "MaxRate", maxrates, 0.5, 0.5, 0.5);
-                get_scriptparam_floatvec(design_note, "MinRate", minrates, 0.05, 0.05, 0.05);
-
-                std::string dummy;
-                refresh = get_scriptparam_time(design_note, "Refresh", 1000, dummy);
-
-                char *facmode = get_scriptparam_string(design_note, "Mode");
-                if(facmode) {
-                    if(!::_stricmp(facmode, "LINEAR")) {
-                        factormode = LINEAR;
-                    } else if(!::_stricmp(facmode, "LOG")) {
-                        factormode = LOGARITHMIC;
-                    }
-
-                    g_pMalloc -> Free(facmode);
-                }
-
-                // Dump the settings for reference
-                if(debug_enabled()) {
-                    debug_printf(DL_DEBUG, "Initialised on object. Settings:");
-                    debug_printf(DL_DEBUG, "Initial location: (%.3f, %.3f, %.3f)", location -> x, location -> y, location -> z);
-                    debug_printf(DL_DEBUG, "Drift amount: (%.3f, %.3f, %.3f)"    , driftrange.x * 2.0, driftrange.y * 2.0, driftrange.z * 2.0);
-                    debug_printf(DL_DEBUG, "Minimum rate: (%.3f, %.3f, %.3f)"    , minrates.x , minrates.y , minrates.z);
-                    debug_printf(DL_DEBUG, "Maximum rate: (%.3f, %.3f, %.3f)"    , maxrates.x , maxrates.y , maxrates.z);
-                    debug_printf(DL_DEBUG, "Update mode: %d", factormode);
-                    debug_printf(DL_DEBUG, "Update rate: %d", refresh);
-                }
-
-                // Check the velocities and start the refresh timer.
-                check_velocities(time);
-
-            // All drift values are zero, there's no point in doing anything
-            } else {
-                debug_printf(DL_WARNING, "All Drift values are zero. Doing nothing.");
-            }
-
-        // Can't do anything if there is no drift information
-        } else {
-            debug_printf(DL_WARNING, "No Drift specified. Doing nothing.");
-        }
+    g_pMalloc -> Free(design_note);
 
-        g_pMalloc -> Free(design_note);
+    if(config -> problem) {
+        debug_printf(DL_WARNING, "%s", config -> problem);
+        return;
     }
+
+    // Dump the settings for reference
+    if(debug_enabled()) {
+        const mxs_vector *location = start_position;
+
+        debug_printf(DL_DEBUG, "Initialised on object. Settings:");
+        debug_printf(DL_DEBUG, "Initial location: (%.3f, %.3f, %.3f)", location -> x, location -> y, location -> z);
+        debug_printf(DL_DEBUG, "Drift amount: (%.3f, %.3f, %.3f)"    , config -> driftrange.x * 2.0, config -> driftrange.y * 2.0, config -> driftrange.z * 2.0);
+        debug_printf(DL_DEBUG, "Minimum rate: (%.3f, %.3f, %.3f)"    , config -> minrates.x , config -> minrates.y , config -> minrates.z);
+        debug_printf(DL_DEBUG, "Maximum rate: (%.3f, %.3f, %.3f)"    , config -> maxrates.x , config -> maxrates.y , config -> maxrates.z);
+        debug_printf(DL_DEBUG, "Update mode: %d", config -> factormode);
+        debug_printf(DL_DEBUG, "Update rate: %d", config -> refresh);
+    }
+
+    // Check the velocities and start the refresh timer.
+    check_velocities(time);
 }
 
 
@@ -90,7 +72,7 @@ TWBaseScript::MsgStatus TWCloudDrift::on_message(sScrMsg* msg, cMultiParm& reply
     MsgStatus result = TWBaseScript::on_message(msg, reply);
     if(result != MS_CONTINUE) return result;
 
-    if(!::_stricmp(msg -> message, "Timer")) {
+    if(get_message_id() == MSGID_TIMER) {
         return on_timer(static_cast<sScrTimerMsg*>(msg), reply);
     }
 
@@ -100,8 +82,9 @@ TWBaseScript::MsgStatus TWCloudDrift::on_message(sScrMsg* msg, cMultiParm& reply
 
 TWBaseScript::MsgStatus TWCloudDrift::on_timer(sScrTimerMsg *msg, cMultiParm& reply)
 {
-    // Only bother doing anything if the timer name is correct.
-    if(!::_stricmp(msg -> name, "CheckVelocity")) {
+    // Only bother doing anything if the timer name is correct, and the
+    // cloud has settings that allow it to drift.
+    if(MessageNames::lookup(msg -> name) == MSGID_CHECKVELOCITY && config && !config -> problem) {
         check_velocities(msg -> time);
     }
 
@@ -113,9 +96,49 @@ TWBaseScript::MsgStatus TWCloudDrift::on_timer(sScrTimerMsg *msg, cMultiParm& re
  *  TWCloudDrift Implementation - private members
  */
 
+void TWCloudDrift::parse_config(const char* design_note, DriftConfig& settings)
+{
+    const DesignNote& note = DesignNote::index(design_note);
+
+    // Nothing can be done if there's no drift setting
+    if(!get_scriptparam_floatvec(note, "Range", settings.driftrange)) {
+        settings.problem = "No Drift specified. Doing nothing.";
+        return;
+    }
+
+    // Drifts must be positive. Divide by two so the range is relative to the start pos.
+    settings.driftrange.x = fabs(settings.driftrange.x) / 2.0;
+    settings.driftrange.y = fabs(settings.driftrange.y) / 2.0;
+    settings.driftrange.z = fabs(settings.driftrange.z) / 2.0;
+
+    // And there needs to be actual drift
+    if(!settings.driftrange) {
+        settings.problem = "All Drift values are zero. Doing nothing.";
+        return;
+    }
+
+    get_scriptparam_floatvec(note, "MaxRate", settings.maxrates, 0.5, 0.5, 0.5);
+    get_scriptparam_floatvec(note, "MinRate", settings.minrates, 0.05, 0.05, 0.05);
+
+    std::string dummy;
+    settings.refresh = get_scriptparam_time(note, "Refresh", 1000, dummy);
+
+    char *facmode = get_scriptparam_string(note, "Mode");
+    if(facmode) {
+        if(!::_stricmp(facmode, "LINEAR")) {
+            settings.factormode = LINEAR;
+        } else if(!::_stricmp(facmode, "LOG")) {
+            settings.factormode = LOGARITHMIC;
+        }
+
+        g_pMalloc -> Free(facmode);
+    }
+}
+
+
 void TWCloudDrift::fetch_initial_location(void)
 {
-    SService<IObjectSrv> obj_srv(g_pScriptManager);
+    SService<IObjectSrv>& obj_srv = ScriptServices::object();
     cScrVec position;
     obj_srv -> Position(position, ObjId());
 
@@ -137,7 +160,7 @@ float TWCloudDrift::calculate_velocity(float centre, float range, float minrate,
         if(offset > range) offset = range;
 
         float factor = 0.0;
-        switch(factormode) {
+        switch(config -> factormode) {
             case LINEAR: factor = 1 - (offset / range);
                 break;
             case LOGARITHMIC: factor = cosf((offset / range) * M_PI_2);
@@ -159,11 +182,11 @@ void TWCloudDrift::check_velocities(int time)
     if(debug_enabled()) debug_printf(DL_DEBUG, "Updating velocity");
 
     // Obtain the current location and velocity
-    SService<IObjectSrv> obj_srv(g_pScriptManager);
+    SService<IObjectSrv>& obj_srv = ScriptServices::object();
     cScrVec position;
     obj_srv -> Position(position, ObjId());
 
-	SService<IPhysSrv> phys_srv(g_pScriptManager);
+	SService<IPhysSrv>& phys_srv = ScriptServices::phys();
     cScrVec velocity;
     phys_srv -> GetVelocity(ObjId(), velocity);
 
@@ -171,6 +194,10 @@ void TWCloudDrift::check_velocities(int time)
     const mxs_vector *location = start_position;
 
     // Recalculate any velocities that need changing
+    const cScrVec& driftrange = config -> driftrange;
+    const cScrVec& minrates   = config -> minrates;
+    const cScrVec& maxrates   = config -> maxrates;
+
     if(driftrange.x && minrates.x && maxrates.x)
         velocity.x = calculate_velocity(location -> x, driftrange.x, minrates.x, maxrates.x, position.x, velocity.x);
 
@@ -185,11 +212,6 @@ void TWCloudDrift::check_velocities(int time)
     if(debug_enabled())
         debug_printf(DL_DEBUG, "Pos/Vel,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f", time, position.x, position.y, position.z, velocity.x, velocity.y, velocity.z);
 
-    // This shouldn't be needed, but check anyway
-    if(update_timer) {
-        cancel_timed_message(update_timer);
-    }
-
     // And schedule the next update.
-    update_timer = set_timed_message("CheckVelocity", refresh, kSTM_OneShot);
+    schedule_poll("CheckVelocity", config -> refresh);
 }
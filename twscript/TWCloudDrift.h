@@ -31,6 +31,7 @@
 #include <string>
 #include "scriptvars.h"
 #include "TWBaseScript.h"
+#include "SharedConfig.h"
 
 /** @class TWCloudDrift
  *
@@ -67,9 +68,8 @@ public:
         LOGARITHMIC,  //!< Scalw logarithmically based on distance from the start.
     };
 
-    TWCloudDrift(const char* name, int object) : TWBaseScript(name, object), driftrange(), maxrates(), minrates(), refresh(0), factormode(FIXEDMIN),
-                                                 SCRIPT_VAROBJ(TWCloudDrift, start_position, object),
-                                                 SCRIPT_VAROBJ(TWCloudDrift, update_timer, object)
+    TWCloudDrift(const char* name, int object) : TWBaseScript(name, object), config(),
+                                                 SCRIPT_VAROBJ(TWCloudDrift, start_position, object)
         { /* fnord */ }
 
 protected:
@@ -114,6 +114,31 @@ protected:
     MsgStatus on_timer(sScrTimerMsg *msg, cMultiParm& reply);
 
 private:
+    /** The settings parsed from the design note. These are shared by all the
+     *  clouds with the same design note, see SharedConfig.
+     */
+    struct DriftConfig : public SharedConfig
+    {
+        DriftConfig() : driftrange(), maxrates(), minrates(), refresh(0), factormode(FIXEDMIN), problem(NULL)
+            { /* fnord */ }
+
+        cScrVec     driftrange; //!< How far should the cloud be able to drift, either side of the start?
+        cScrVec     maxrates;   //!< How fast can the cloud travel?
+        cScrVec     minrates;   //!< How slow can the cloud travel?
+        int         refresh;    //!< How frequently should the speed be updated?
+        FactorMode  factormode; //!< How should the speed behave based on position?
+        const char* problem;    //!< Why the cloud can not drift, or NULL if it can.
+    };
+
+
+    /** Parse the settings for the cloud from its design note.
+     *
+     * @param design_note The design note to parse.
+     * @param settings    The block to store the settings in.
+     */
+    void parse_config(const char* design_note, DriftConfig& settings);
+
+
     /** Store the initial location of the object, required to determine the
      *  velocity based on the distance from initial location.
      */
@@ -143,15 +168,10 @@ private:
     void check_velocities(int time);
 
     // DesignNote configured options
-    cScrVec    driftrange;         //!< How far should the cloud be able to drift?
-    cScrVec    maxrates;           //!< How fast can the cloud travel?
-    cScrVec    minrates;           //!< How slow can the cloud travel?
-    int        refresh;            //!< How frequently should the speed be updated?
-    FactorMode factormode;         //!< How should the speed behave based on position?
+    ConfigRef<DriftConfig>   config;          //!< The settings parsed from the design note, shared with other clouds.
 
     // Persistent variables (current location and velocity are handled by the game)
     script_vec               start_position;  //!< The initial location of the cloud
-    script_handle<tScrTimer> update_timer;    //!< A timer used to update the cloud speed
 };
 
 #else // SCR_GENSCRIPTS
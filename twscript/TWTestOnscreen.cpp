@@ -1,12 +1,13 @@
 #include "TWTestOnscreen.h"
 #include "ScriptLib.h"
+#include "ScriptServices.h"
 
 void TWTestOnscreen::init(int time)
 {
     TWBaseScript::init(time);
 
     // And schedule the next update.
-    update_timer = set_timed_message("CheckOnScreen", 500, kSTM_OneShot);
+    schedule_poll("CheckOnScreen", 500);
 }
 
 
@@ -16,7 +17,7 @@ TWBaseScript::MsgStatus TWTestOnscreen::on_message(sScrMsg* msg, cMultiParm& rep
     MsgStatus result = TWBaseScript::on_message(msg, reply);
     if(result != MS_CONTINUE) return result;
 
-    if(!::_stricmp(msg -> message, "Timer")) {
+    if(get_message_id() == MSGID_TIMER) {
         return on_timer(static_cast<sScrTimerMsg*>(msg), reply);
     }
 
@@ -27,9 +28,9 @@ TWBaseScript::MsgStatus TWTestOnscreen::on_message(sScrMsg* msg, cMultiParm& rep
 TWBaseScript::MsgStatus TWTestOnscreen::on_timer(sScrTimerMsg *msg, cMultiParm& reply)
 {
     // Only bother doing anything if the timer name is correct.
-    if(!::_stricmp(msg -> name, "CheckOnScreen")) {
-        SService<IObjectSrv> obj_srv(g_pScriptManager);
-        SService<IPropertySrv> prop_srv(g_pScriptManager);
+    if(MessageNames::lookup(msg -> name) == MSGID_CHECKONSCREEN) {
+        SService<IObjectSrv>&   obj_srv = ScriptServices::object();
+        SService<IPropertySrv>& prop_srv = ScriptServices::property();
 
         // Check what the render type is
         if(prop_srv -> Possessed(ObjId(), "RenderType")) {
@@ -50,7 +51,7 @@ TWBaseScript::MsgStatus TWTestOnscreen::on_timer(sScrTimerMsg *msg, cMultiParm&
             debug_printf(DL_DEBUG, "Off screen");
         }
 
-        update_timer = set_timed_message("CheckOnScreen", 500, kSTM_OneShot);
+        schedule_poll("CheckOnScreen", 500);
     }
 
     return MS_CONTINUE;
@@ -38,8 +38,7 @@ class TWTestOnscreen : public TWBaseScript
 {
 
 public:
-    TWTestOnscreen(const char* name, int object) : TWBaseScript(name, object),
-                                                   SCRIPT_VAROBJ(TWTestOnscreen, update_timer, object)
+    TWTestOnscreen(const char* name, int object) : TWBaseScript(name, object)
         { /* fnord */ }
 
 protected:
@@ -82,9 +81,6 @@ protected:
      *         processing the message
      */
     MsgStatus on_timer(sScrTimerMsg *msg, cMultiParm& reply);
-
-private:
-    script_handle<tScrTimer> update_timer;    //!< A timer used to update the cloud speed
 };
 
 #else // SCR_GENSCRIPTS
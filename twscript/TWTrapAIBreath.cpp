@@ -1,6 +1,28 @@
 #include <cstring>
 #include "TWTrapAIBreath.h"
 #include "ScriptLib.h"
+#include "ScriptServices.h"
+#include "LinkFlavours.h"
+
+/** The parameters read by TWTrapAIBreath. Only InCold is per-AI, so it is
+ *  read separately, and everything else is shared through BreathConfig.
+ */
+static const ParamDesc breath_params[] = {
+    PARAM(BreathConfig, stop_immediately,   "Immediate",  PT_BOOL,   "true",                 NULL, false),
+    PARAM(BreathConfig, stop_on_ko,         "StopOnKO",   PT_BOOL,   "false",                NULL, false),
+    PARAM(BreathConfig, exhale_time,        "ExhaleTime", PT_TIME,   "250",                  "ms", false),
+    PARAM(BreathConfig, rates[0],           "Rate0",      PT_TIME,   "3000",                 "ms", false),
+    PARAM(BreathConfig, rates[1],           "Rate1",      PT_TIME,   NULL,                   "ms", false),
+    PARAM(BreathConfig, rates[2],           "Rate2",      PT_TIME,   NULL,                   "ms", false),
+    PARAM(BreathConfig, rates[3],           "Rate3",      PT_TIME,   NULL,                   "ms", false),
+    PARAM(BreathConfig, particle_arch_name, "SFX",        PT_STRING, "AIBreath",             NULL, false),
+    PARAM(BreathConfig, particle_link_name, "LinkType",   PT_STRING, "~ParticleAttachement", NULL, false),
+    PARAM(BreathConfig, proxy_arch_name,    "Proxy",      PT_STRING, "BreathProxy",          NULL, false),
+    PARAM(BreathConfig, proxy_link_name,    "ProxyLink",  PT_STRING, "~DetailAttachement",   NULL, false),
+    PARAM(BreathConfig, cold_room_list,     "ColdRooms",  PT_STRING, NULL,                   NULL, false),
+    PARAM_KNOWN("InCold"),
+};
+static const ParamSchema breath_schema(breath_params, &TWBaseTrap::param_schema);
 
 
 /* =============================================================================
@@ -14,78 +36,31 @@ void TWTrapAIBreath::init(int time)
     // AIs generally start off alive, or they wouldn't have this script on them!
     still_alive.Init(1);
 
-    // Default the base rate
-    rates[0] = 3000;
-
     // Fetch the contents of the object's design note
     char *design_note = GetObjectParams(ObjId());
+    const DesignNote& note = DesignNote::index(design_note);
 
-    if(!design_note) {
+    if(!design_note)
         debug_printf(DL_WARNING, "No Editor -> Design Note. Falling back on defaults.");
 
-        // Work out rates based on the base using a simple division
-        for(int level = 1; level < 4; ++level) {
-            rates[level] = rates[0] / level;
-        }
-
-    } else {
-        std::string dummy;
+    // AIs sharing an archetype usually share a design note, so the settings
+    // only need to be parsed for the first of them, unless they come from
+    // QVars that each AI must read for itself.
+    if(!config.find(Name(), design_note)) {
+        BreathConfig* parsed = new BreathConfig;
+        if(design_note) parse_config(design_note, *parsed);
+
+        if(SharedConfig::shareable(Name(), design_note))
+            config.share(parsed, Name(), design_note);
+        else
+            config.keep(parsed);
+    }
 
-        // Should the AI start off in the cold?
+    // Should the AI start off in the cold? This is only needed the first time
+    // the script starts, after that the persistent setting takes over.
+    if(design_note) {
         if(!in_cold.Valid()) {
-            in_cold = static_cast<int>(get_scriptparam_bool(design_note, "InCold", false));
-        }
-
-        // Should the breath cloud stop immediately on entering the warm?
-        stop_immediately = get_scriptparam_bool(design_note, "Immediate", true);
-
-        // Should the breath cloud stop when knocked out?
-        stop_on_ko = get_scriptparam_bool(design_note, "StopOnKO", false);
-
-        // How long, in milliseconds, should the exhale last
-        exhale_time = get_scriptparam_time(design_note, "ExhaleTime", 250, dummy);
-
-        // Allow the base rate to be overridden, and recalculated the defaults
-        rates[0] = get_scriptparam_time(design_note, "Rate0", rates[0], dummy);
-        for(int level = 1; level < 4; ++level) {
-            rates[level] = rates[0] / level;
-        }
-
-        // Allow override of the default rates
-        rates[1] = get_scriptparam_time(design_note, "Rate1", rates[1], dummy);
-        rates[2] = get_scriptparam_time(design_note, "Rate2", rates[2], dummy);
-        rates[3] = get_scriptparam_time(design_note, "Rate3", rates[3], dummy);
-
-        // Sort out the archetype for the particle
-        char *sfx_name = get_scriptparam_string(design_note, "SFX", "AIBreath");
-        if(sfx_name) {
-            particle_arch_name = sfx_name;
-            g_pMalloc -> Free(sfx_name);
-        }
-
-        char *link_name = get_scriptparam_string(design_note, "LinkType", "~ParticleAttachement");
-        if(link_name) {
-            particle_link_name = link_name;
-            g_pMalloc -> Free(link_name);
-        }
-
-        // Sort out the archetype for the proxy
-        char *proxy_name = get_scriptparam_string(design_note, "Proxy", "BreathProxy");
-        if(proxy_name) {
-            proxy_arch_name = proxy_name;
-            g_pMalloc -> Free(proxy_name);
-        }
-
-        char *proxy_link = get_scriptparam_string(design_note, "ProxyLink", "~DetailAttachement");
-        if(proxy_link) {
-            proxy_link_name = proxy_link;
-            g_pMalloc -> Free(proxy_link);
-        }
-
-        char *cold = get_scriptparam_string(design_note, "ColdRooms", NULL);
-        if(cold) {
-            parse_coldrooms(cold);
-            g_pMalloc -> Free(cold);
+            in_cold = static_cast<int>(get_scriptparam_bool(note, "InCold", false));
         }
 
         g_pMalloc -> Free(design_note);
@@ -93,20 +68,20 @@ void TWTrapAIBreath::init(int time)
 
     if(debug_enabled()) {
         debug_printf(DL_DEBUG, "Initialised on object. Settings:");
-        debug_printf(DL_DEBUG, "In cold: %s, stop breath immediately: %s", in_cold ? "yes" : "no", stop_immediately ? "yes" : "no");
-        debug_printf(DL_DEBUG, "Exhale time: %dms", exhale_time);
-        debug_printf(DL_DEBUG, "Breathing rates (in ms) None: %d, Low: %d, Medium: %d, High: %d", rates[0], rates[1], rates[2], rates[3]);
-        debug_printf(DL_DEBUG, "SFX name: %s", particle_arch_name.c_str());
+        debug_printf(DL_DEBUG, "In cold: %s, stop breath immediately: %s", in_cold ? "yes" : "no", config -> stop_immediately ? "yes" : "no");
+        debug_printf(DL_DEBUG, "Exhale time: %dms", config -> exhale_time);
+        debug_printf(DL_DEBUG, "Breathing rates (in ms) None: %d, Low: %d, Medium: %d, High: %d", config -> rates[0], config -> rates[1], config -> rates[2], config -> rates[3]);
+        debug_printf(DL_DEBUG, "SFX name: %s", config -> particle_arch_name.c_str());
     }
 
     // Now update the breathing rate based on alertness
-    SService<IAIScrSrv> AISrv(g_pScriptManager);
+    SService<IAIScrSrv>& AISrv = ScriptServices::ai();
     int new_rate = AISrv -> GetAlertLevel(ObjId());
 
     // The rate gets reset to 0 if the AI is dead or unconscious
-    int knockedout = StrToObject("M-KnockedOut");
+    int knockedout = ObjectNames::id("M-KnockedOut");
     if(knockedout) {
-        SService<IObjectSrv> ObjectSrv(g_pScriptManager);
+        SService<IObjectSrv>& ObjectSrv = ScriptServices::object();
         true_bool just_resting;
         ObjectSrv -> HasMetaProperty(just_resting, ObjId(), knockedout);
 
@@ -125,27 +100,27 @@ TWBaseScript::MsgStatus TWTrapAIBreath::on_message(sScrMsg* msg, cMultiParm& rep
     MsgStatus result = TWBaseTrap::on_message(msg, reply);
     if(result != MS_CONTINUE) return result;
 
-    if(!::_stricmp(msg -> message, "Timer")) {
-        return stop_breath(static_cast<sScrTimerMsg*>(msg), reply);
+    switch(get_message_id()) {
+        case MSGID_TIMER:
+            return stop_breath(static_cast<sScrTimerMsg*>(msg), reply);
 
-    } else if(!::_stricmp(msg -> message, "TweqComplete")) {
-        return start_breath(static_cast<sTweqMsg*>(msg), reply);
+        case MSGID_TWEQCOMPLETE:
+            return start_breath(static_cast<sTweqMsg*>(msg), reply);
 
-    } else if(!::_stricmp(msg -> message, "Alertness")) {
-        return on_aialertness(static_cast<sAIAlertnessMsg*>(msg), reply);
+        case MSGID_ALERTNESS:
+            return on_aialertness(static_cast<sAIAlertnessMsg*>(msg), reply);
 
-    } else if(!::_stricmp(msg -> message, "ObjRoomTransit")) {
-        return on_objroomtransit(static_cast<sRoomMsg*>(msg), reply);
+        case MSGID_OBJROOMTRANSIT:
+            return on_objroomtransit(static_cast<sRoomMsg*>(msg), reply);
 
-    } else if(!::_stricmp(msg -> message, "AIModeChange")) {
-        return on_aimodechange(static_cast<sAIModeChangeMsg*>(msg), reply);
+        case MSGID_AIMODECHANGE:
+            return on_aimodechange(static_cast<sAIModeChangeMsg*>(msg), reply);
 
-    } else if(!::_stricmp(msg -> message, "Slain")) {
-        return on_slain(msg, reply);
-
-    } else if(!::_stricmp(msg -> message, "IgnorePotion")) {
-        return on_ignorepotion(msg, reply);
+        case MSGID_SLAIN:
+            return on_slain(msg, reply);
 
+        case MSGID_IGNOREPOTION:
+            return on_ignorepotion(msg, reply);
     }
 
 
@@ -176,7 +151,7 @@ TWBaseScript::MsgStatus TWTrapAIBreath::on_offmsg(sScrMsg* msg, cMultiParm& repl
     in_cold = 0;
 
     // Halt breath particle immediately on entering the warm?
-    if(stop_immediately) {
+    if(config -> stop_immediately) {
         abort_breath();
     }
 
@@ -190,7 +165,7 @@ TWBaseScript::MsgStatus TWTrapAIBreath::on_offmsg(sScrMsg* msg, cMultiParm& repl
 
 void TWTrapAIBreath::abort_breath(bool cancel_timer)
 {
-    SService<IPGroupSrv> SFXSrv(g_pScriptManager);
+    SService<IPGroupSrv>& SFXSrv = ScriptServices::pgroup();
 
     if(debug_enabled())
         debug_printf(DL_DEBUG, "Deactivating particle group");
@@ -209,8 +184,8 @@ void TWTrapAIBreath::abort_breath(bool cancel_timer)
 
 TWBaseScript::MsgStatus TWTrapAIBreath::start_breath(sTweqMsg *msg, cMultiParm& reply)
 {
-    SService<IPropertySrv> PropertySrv(g_pScriptManager);
-    SService<IPGroupSrv>   SFXSrv(g_pScriptManager);
+    SService<IPropertySrv>& PropertySrv = ScriptServices::property();
+    SService<IPGroupSrv>&   SFXSrv = ScriptServices::pgroup();
 
     // Only process flicker complete messages, and only actually do anything at all
     // if the object is in the cold.
@@ -218,7 +193,7 @@ TWBaseScript::MsgStatus TWTrapAIBreath::start_breath(sTweqMsg *msg, cMultiParm&
         if(debug_enabled())
             debug_printf(DL_DEBUG, "Doing breathe out");
 
-        int turn_off = exhale_time;
+        int turn_off = config -> exhale_time;
 
         cMultiParm rate_param;
         PropertySrv -> Get(rate_param, ObjId(), "CfgTweqBlink", "Rate");
@@ -253,7 +228,7 @@ TWBaseScript::MsgStatus TWTrapAIBreath::start_breath(sTweqMsg *msg, cMultiParm&
 TWBaseScript::MsgStatus TWTrapAIBreath::stop_breath(sScrTimerMsg *msg, cMultiParm& reply)
 {
     // Only bother doing anything if the timer name is correct.
-    if(!::_stricmp(msg -> name, "StopBreath")) {
+    if(MessageNames::lookup(msg -> name) == MSGID_STOPBREATH) {
         abort_breath(false);
 
         // Check the AI alertness, just in case the rate needs to be lowered
@@ -266,9 +241,9 @@ TWBaseScript::MsgStatus TWTrapAIBreath::stop_breath(sScrTimerMsg *msg, cMultiPar
 
 TWBaseScript::MsgStatus TWTrapAIBreath::on_objroomtransit(sRoomMsg *msg, cMultiParm& reply)
 {
-    ColdRoomIter iter = cold_rooms.find(msg -> ToObjId);
+    ColdRoomMap::const_iterator iter = config -> cold_rooms.find(msg -> ToObjId);
 
-    if(iter != cold_rooms.end() && iter -> second) {
+    if(iter != config -> cold_rooms.end() && iter -> second) {
         return on_onmsg(msg, reply);
     }
 
@@ -284,7 +259,7 @@ TWBaseScript::MsgStatus TWTrapAIBreath::on_ignorepotion(sScrMsg *msg, cMultiParm
 
     // If stop_on_ko is true, it doesn't matter if the AI is knocked out, the
     // particles should be stopped.
-    if(stop_on_ko) {
+    if(config -> stop_on_ko) {
         if(debug_enabled())
             debug_printf(DL_DEBUG, "Treating AI as dead and stopping breath.");
 
@@ -300,7 +275,7 @@ TWBaseScript::MsgStatus TWTrapAIBreath::on_ignorepotion(sScrMsg *msg, cMultiParm
 
 TWBaseScript::MsgStatus TWTrapAIBreath::on_aimodechange(sAIModeChangeMsg *msg, cMultiParm& reply)
 {
-    SService<IObjectSrv> ObjectSrv(g_pScriptManager);
+    SService<IObjectSrv>& ObjectSrv = ScriptServices::object();
 
     // If the AI is dead, they can't breathe!
     if(msg -> mode == kAIM_Dead) {
@@ -309,10 +284,11 @@ TWBaseScript::MsgStatus TWTrapAIBreath::on_aimodechange(sAIModeChangeMsg *msg, c
         set_rate(0);
 
         // If stop_on_ko is true, it doesn't matter if the AI is knocked out...
-        if(!stop_on_ko) {
+        if(!config -> stop_on_ko) {
 
             // Is the AI really dead, or just resting?
-            int m_knockedout = StrToObject("M-KnockedOut");
+            static NamedObject knockedout("M-KnockedOut");
+            int m_knockedout = knockedout.id();
 
             if(m_knockedout) {
                 true_bool just_resting;
@@ -365,26 +341,25 @@ TWBaseScript::MsgStatus TWTrapAIBreath::on_aialertness(sAIAlertnessMsg *msg, cMu
 
 void TWTrapAIBreath::set_rate(int new_level)
 {
-    SService<IPropertySrv> PropertySrv(g_pScriptManager);
+    SService<IPropertySrv>& PropertySrv = ScriptServices::property();
 
     if(new_level != last_level && new_level >= 0 && new_level <= 3 && PropertySrv -> Possessed(ObjId(), "CfgTweqBlink")) {
         last_level = new_level;
 
         if(debug_enabled()) {
-            debug_printf(DL_DEBUG, "New rate is %d", rates[new_level]);
+            debug_printf(DL_DEBUG, "New rate is %d", config -> rates[new_level]);
         }
 
-        PropertySrv -> Set(ObjId(), "CfgTweqBlink", "Rate", rates[new_level]);
-        PropertySrv -> Set(ObjId(), "StTweqBlink", "Cur Time", rates[new_level] - 1);
+        PropertySrv -> Set(ObjId(), "CfgTweqBlink", "Rate", config -> rates[new_level]);
+        PropertySrv -> Set(ObjId(), "StTweqBlink", "Cur Time", config -> rates[new_level] - 1);
     }
 }
 
 
 void TWTrapAIBreath::check_ai_reallyhigh()
 {
-    SService<IAIScrSrv>     AISrv(g_pScriptManager);
-    SService<ILinkSrv>      LinkSrv(g_pScriptManager);
-    SService<ILinkToolsSrv> LinkToolsSrv(g_pScriptManager);
+    SService<IAIScrSrv>& AISrv = ScriptServices::ai();
+    SService<ILinkSrv>&  LinkSrv = ScriptServices::link();
 
     // First obtain the AI's alertness level
     eAIScriptAlertLevel level = AISrv -> GetAlertLevel(ObjId());
@@ -395,16 +370,18 @@ void TWTrapAIBreath::check_ai_reallyhigh()
     if(level == kHighAlert) {
 
         // Knocked out AIs can be on high alert, so check for that...
-        int knockedout = StrToObject("M-KnockedOut");
+        static NamedObject knockedout_mp("M-KnockedOut");
+        int knockedout = knockedout_mp.id();
         if(knockedout) {
-            SService<IObjectSrv> ObjectSrv(g_pScriptManager);
+            SService<IObjectSrv>& ObjectSrv = ScriptServices::object();
             true_bool just_resting;
             ObjectSrv -> HasMetaProperty(just_resting, ObjId(), knockedout);
 
             // If the AI is not knocked out, check whether it is searching/attacking
             if(!just_resting) {
+                static LinkFlavour invest("AIInvest");
                 true_bool has_invest;
-                LinkSrv -> AnyExist(has_invest, LinkToolsSrv -> LinkKindNamed("AIInvest"), ObjId(), 0);
+                LinkSrv -> AnyExist(has_invest, invest.id(), ObjId(), 0);
 
                 // AI Doesn't have an invest link? Pretend the AI is a level lower
                 if(has_invest) {
@@ -434,17 +411,41 @@ int TWTrapAIBreath::get_breath_particles()
 
 int TWTrapAIBreath::get_breath_proxy(object fallback)
 {
-    return get_linked_object(ObjId(), proxy_arch_name, proxy_link_name, fallback);
+    return get_linked_object(ObjId(), config -> proxy_arch_name.c_str(), config -> proxy_link_name.c_str(), fallback);
 }
 
 
 int TWTrapAIBreath::get_breath_particlegroup(object from)
 {
-    return get_linked_object(from, particle_arch_name, particle_link_name);
+    return get_linked_object(from, config -> particle_arch_name.c_str(), config -> particle_link_name.c_str());
+}
+
+
+void TWTrapAIBreath::parse_config(const char* design_note, BreathConfig& settings)
+{
+    std::vector<std::string> problems;
+    uint64_t found = breath_schema.bind(Name(), ObjId(), design_note, &settings, &problems);
+
+    for(std::vector<std::string>::const_iterator it = problems.begin(); it != problems.end(); ++it) {
+        debug_printf(DL_WARNING, "%s", it -> c_str());
+    }
+
+    // Rates that have not been set are based on the base rate
+    static const uint64_t rate_bits[4] = { 0, breath_schema.bit("Rate1"), breath_schema.bit("Rate2"), breath_schema.bit("Rate3") };
+    for(int level = 1; level < 4; ++level) {
+        if(!(found & rate_bits[level]))
+            settings.rates[level] = settings.rates[0] / level;
+    }
+
+    if(!settings.cold_room_list.empty()) {
+        // parse_coldrooms needs a copy it can split up
+        std::string cold = settings.cold_room_list.c_str();
+        parse_coldrooms(&cold[0], settings.cold_rooms);
+    }
 }
 
 
-void TWTrapAIBreath::parse_coldrooms(char *coldstr)
+void TWTrapAIBreath::parse_coldrooms(char *coldstr, ColdRoomMap& cold_rooms)
 {
     char *room;
     char *rest = NULL;
@@ -32,6 +32,8 @@
 #include "scriptvars.h"
 #include "TWBaseScript.h"
 #include "TWBaseTrap.h"
+#include "SharedConfig.h"
+#include "IString.h"
 
 #include <string>
 #include <map>
@@ -47,6 +49,28 @@ typedef ColdRoomMap::iterator   ColdRoomIter; //!< Convenience type for ColdRoom
 typedef ColdRoomMap::value_type ColdRoomPair; //!< Convenience type for ColdRoomMap key/value pairs
 
 
+/** The settings for TWTrapAIBreath parsed from the design note. These are
+ *  shared by all the AIs with the same design note, see SharedConfig.
+ */
+struct BreathConfig : public SharedConfig
+{
+    BreathConfig() : stop_immediately(false), stop_on_ko(false), exhale_time(250), rates{3000, 3000, 1500, 1000},
+                     particle_arch_name(), particle_link_name(), proxy_arch_name(), proxy_link_name(), cold_room_list(), cold_rooms()
+        { /* fnord */ }
+
+    bool        stop_immediately;   //!< Stop the particle group immediately on leaving the cold?
+    bool        stop_on_ko;         //!< Deactivate the particle group on knockout
+    int         exhale_time;        //!< How long to leave the particle group active for at a time
+    int         rates[4];           //!< Breathing rates, in millisecods, for each awareness level.
+    IString     particle_arch_name; //!< The name of the particle group archetype to use
+    IString     particle_link_name; //!< The link flavour used to link the particles to the AI (or proxy)
+    IString     proxy_arch_name;    //!< The name of the particle proxy archetype to use
+    IString     proxy_link_name;    //!< The link flavour used to link the proxy to the AI
+    IString     cold_room_list;     //!< The list of cold rooms given in the design note
+    ColdRoomMap cold_rooms;         //!< Which rooms are marked as cold?
+};
+
+
 /** @class TWTrapAIBreath
  *
  * TWTrapAIBreath controls a particle attachment to an AI that allows the
@@ -287,7 +311,7 @@ typedef ColdRoomMap::value_type ColdRoomPair; //!< Convenience type for ColdRoom
 class TWTrapAIBreath : public TWBaseTrap
 {
 public:
-    TWTrapAIBreath(const char* name, int object) : TWBaseTrap(name, object), stop_immediately(false), stop_on_ko(false), exhale_time(250), rates{0, 0, 0, 0}, last_level(-1), particle_arch_name(), particle_link_name(), cold_rooms(),
+    TWTrapAIBreath(const char* name, int object) : TWBaseTrap(name, object), config(), last_level(-1),
                                                    SCRIPT_VAROBJ(TWTrapAIBreath, in_cold, object),
                                                    SCRIPT_VAROBJ(TWTrapAIBreath, still_alive, object),
                                                    SCRIPT_VAROBJ(TWTrapAIBreath, breath_timer, object)
@@ -468,32 +492,33 @@ private:
 
     int get_breath_particlegroup(object from);
 
-    /** Parse the list of cold rooms defined by the Design Note into the cold_rooms
-     *  map for later lookup. The cold rooms string should contain a comma separated
+    /** Parse the settings in the specified design note.
+     *
+     * @param design_note The design note to parse.
+     * @param settings    A reference to the config to store the settings in.
+     */
+    void parse_config(const char* design_note, BreathConfig& settings);
+
+
+    /** Parse the list of cold rooms defined by the Design Note into a map
+     *  for later lookup. The cold rooms string should contain a comma separated
      *  list of room ID numbers or names.
      *
-     * @param coldstr A string containing the list of cold room names/ids.
+     * @param coldstr    A string containing the list of cold room names/ids.
+     * @param cold_rooms The map to add the cold rooms to.
      */
-    void parse_coldrooms(char* coldstr);
+    void parse_coldrooms(char* coldstr, ColdRoomMap& cold_rooms);
 
 
     char *tok_r(char *str, const char *delim, char **nextp);
 
     // DesignNote configured options
-    bool                     stop_immediately;   //!< Stop the particle group immediately on leaving the cold?
-    bool                     stop_on_ko;         //!< Deactivate the particle group on knockout
-    int                      exhale_time;        //!< How long to leave the particle group active for at a time
-    int                      rates[4];           //!< Breathing rates, in millisecods, for each awareness level.
+    ConfigRef<BreathConfig>  config;             //!< The settings parsed from the design note, shared with other AIs.
     int                      last_level;         //!< Which level is currently set?
-    std::string              particle_arch_name; //!< The name of the particle group archetype to use
-    std::string              particle_link_name; //!< The link flavour used to link the particles to the AI (or proxy)
-    std::string              proxy_arch_name;    //!< The name of the particle proxy archetype to use
-    std::string              proxy_link_name;    //!< The link flavour used to link the proxy to the AI
-    ColdRoomMap              cold_rooms;         //!< Which rooms are marked as cold?
 
     // Persistent variables
-    script_int               in_cold;            //!< Is the AI in a cold area?
-    script_int               still_alive;        //!< Is the AI alive?
+    cached_script_int        in_cold;            //!< Is the AI in a cold area?
+    cached_script_int        still_alive;        //!< Is the AI alive?
     script_handle<tScrTimer> breath_timer;       //!< A timer used to deactivate the group after exhale_time
 };
 
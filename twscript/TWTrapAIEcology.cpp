@@ -1,5 +1,7 @@
 #include "TWTrapAIEcology.h"
 #include "ScriptLib.h"
+#include "ScriptServices.h"
+#include "LinkFlavours.h"
 
 /* =============================================================================
  *  TWTrapAIEcology Impmementation - protected members
@@ -21,6 +23,7 @@ void TWTrapAIEcology::init(int time)
 
     // Fetch the contents of the object's design note
     char *design_note = GetObjectParams(ObjId());
+    const DesignNote& note = DesignNote::index(design_note);
 
     if(!design_note) {
         debug_printf(DL_WARNING, "No Editor -> Design Note. Falling back on defaults.");
@@ -30,32 +33,34 @@ void TWTrapAIEcology::init(int time)
 
     } else {
         // How many AIs can be spawned?
-        pop_limit = get_scriptparam_int(design_note, "Population", 1, pop_qvar);
+        get_scriptparam_int(note, "Population", 1, pop_limit);
 
         // does the ecology have an upper limit?
-        lives = get_scriptparam_int(design_note, "Lives", 0, lives_qvar);
+        std::string qvar;
+        lives = get_scriptparam_int(note, "Lives", 0, qvar);
+        lives_qvar = qvar;
 
         // How often should the ecology update?
-        refresh = get_scriptparam_time(design_note, "Rate", 30000, refresh_qvar);
+        get_scriptparam_time(note, "Rate", 30000, refresh);
 
         // Start on? Note that this will only have any effect the first time the script
         // does the init. After this point, the previous enabled state takes over.
-        starton = get_scriptparam_bool(design_note, "StartOn", false);
+        starton = get_scriptparam_bool(note, "StartOn", false);
         enabled.Init(starton ? 1 : 0);
 
-        char *archetype_def = get_scriptparam_string(design_note, "AILink", "&%Weighted");
+        char *archetype_def = get_scriptparam_string(note, "AILink", "&%Weighted");
         if(archetype_def) {
             archetype_link = archetype_def;
             g_pMalloc -> Free(archetype_def);
         }
 
-        char *spawnpoint_def = get_scriptparam_string(design_note, "SpawnLink", "&#Weighted");
+        char *spawnpoint_def = get_scriptparam_string(note, "SpawnLink", "&#Weighted");
         if(spawnpoint_def) {
             spawnpoint_link = spawnpoint_def;
             g_pMalloc -> Free(spawnpoint_def);
         }
 
-        char *spawned_def = get_scriptparam_string(design_note, "SpawnCountQVar", NULL);
+        char *spawned_def = get_scriptparam_string(note, "SpawnCountQVar", NULL);
         if(spawned_def) {
             spawned_qvar = spawned_def;
             g_pMalloc -> Free(spawned_def);
@@ -64,6 +69,10 @@ void TWTrapAIEcology::init(int time)
        g_pMalloc -> Free(design_note);
     }
 
+    // Parse the link definitions once, rather than every time the ecology updates
+    compile_target_query(archetype_link.c_str(), archetype_query);
+    compile_target_query(spawnpoint_link.c_str(), spawnpoint_query);
+
     // If the ecology is active, start it going
     if(int(enabled)) {
         start_timer(true);
@@ -71,15 +80,15 @@ void TWTrapAIEcology::init(int time)
 
     if(debug_enabled()) {
         debug_printf(DL_DEBUG, "Initialised on object. Settings:");
-        debug_printf(DL_DEBUG, "Population %d at rate %d", pop_limit, refresh);
-        if(!refresh_qvar.empty())
-            debug_printf(DL_DEBUG, "Rate will be read from qvar '%s'", refresh_qvar.c_str());
+        debug_printf(DL_DEBUG, "Population %d at rate %d", int(pop_limit), int(refresh));
+        if(refresh.has_qvar())
+            debug_printf(DL_DEBUG, "Rate will be read from qvar '%s'", refresh.qvar().c_str());
 
         if(lives)
             debug_printf(DL_DEBUG, "Total spawns allowed: %d", lives);
 
-        if(!pop_qvar.empty())
-            debug_printf(DL_DEBUG, "Population will be read from qvar '%s'", pop_qvar.c_str());
+        if(pop_limit.has_qvar())
+            debug_printf(DL_DEBUG, "Population will be read from qvar '%s'", pop_limit.qvar().c_str());
 
         if(!spawned_qvar.empty())
             debug_printf(DL_DEBUG, "Total spawn count will appear in qvar '%s'", spawned_qvar.c_str());
@@ -101,12 +110,10 @@ TWBaseScript::MsgStatus TWTrapAIEcology::on_message(sScrMsg* msg, cMultiParm& re
     MsgStatus result = TWBaseTrap::on_message(msg, reply);
     if(result != MS_CONTINUE) return result;
 
-    if(!::_stricmp(msg -> message, "Timer")) {
-        return on_timer(static_cast<sScrTimerMsg*>(msg), reply);
-    } else if(!::_stricmp(msg -> message, "Despawned")) {
-        return on_despawn(msg, reply);
-    } else if(!::_stricmp(msg -> message, "ResetSpawned")) {
-        return on_resetspawned(msg, reply);
+    switch(get_message_id()) {
+        case MSGID_TIMER:        return on_timer(static_cast<sScrTimerMsg*>(msg), reply);
+        case MSGID_DESPAWNED:    return on_despawn(msg, reply);
+        case MSGID_RESETSPAWNED: return on_resetspawned(msg, reply);
     }
 
     return result;
@@ -156,13 +163,16 @@ TWBaseScript::MsgStatus TWTrapAIEcology::on_offmsg(sScrMsg* msg, cMultiParm& rep
 TWBaseScript::MsgStatus TWTrapAIEcology::on_timer(sScrTimerMsg* msg, cMultiParm& reply)
 {
     // Only bother doing anything if the timer name is correct.
-    if(!::_stricmp(msg -> name, "CheckPop")) {
-        attempt_spawn(msg);
-        start_timer();
-
-    // Fix the links between the spawn point and AI
-    } else if(!::_stricmp(msg -> name, "FixLinks")) {
-        fixup_links(msg -> data);
+    switch(MessageNames::lookup(msg -> name)) {
+        case MSGID_CHECKPOP:
+            attempt_spawn(msg);
+            start_timer();
+            break;
+
+        // Fix the links between the spawn point and AI
+        case MSGID_FIXLINKS:
+            fixup_links(msg -> data);
+            break;
     }
 
     return MS_CONTINUE;
@@ -176,7 +186,7 @@ TWBaseScript::MsgStatus TWTrapAIEcology::on_despawn(sScrMsg* msg, cMultiParm& re
     update_pop_limit();
 
     if(debug_enabled())
-        debug_printf(DL_DEBUG, "AI despawned, population is now %d spawned AIs (limit is %d)", int(population), pop_limit);
+        debug_printf(DL_DEBUG, "AI despawned, population is now %d spawned AIs (limit is %d)", int(population), int(pop_limit));
 
     return MS_CONTINUE;
 }
@@ -199,18 +209,14 @@ TWBaseScript::MsgStatus TWTrapAIEcology::on_resetspawned(sScrMsg* msg, cMultiPar
 
 void TWTrapAIEcology::start_timer(bool immediate)
 {
-    stop_timer(); // most of the time this is redundant, but be sure.
     update_refresh(); // Make sure the refresh rate is updated if it's read from a qvar
-    update_timer = set_timed_message("CheckPop", immediate ? 100 : refresh, kSTM_OneShot);
+    schedule_poll("CheckPop", immediate ? 100 : refresh); // replaces any pending timer
 }
 
 
 void TWTrapAIEcology::stop_timer(void)
 {
-    if(update_timer) {
-        cancel_timed_message(update_timer);
-        update_timer.Clear();
-    }
+    cancel_poll();
 }
 
 
@@ -242,7 +248,7 @@ bool TWTrapAIEcology::spawn_needed(void)
     update_pop_limit();
 
     if(debug_enabled()) {
-        debug_printf(DL_DEBUG, "Got %d spawned AIs (limit is %d)", int(population), pop_limit);
+        debug_printf(DL_DEBUG, "Got %d spawned AIs (limit is %d)", int(population), int(pop_limit));
 
         if(lives) {
             debug_printf(DL_DEBUG, "Total spawns so far %d of %d", int(spawned), lives);
@@ -258,19 +264,22 @@ int TWTrapAIEcology::select_archetype(sScrMsg *msg)
 {
     // Select the AI archetype to spawn an instance of. Note that this may return more than one
     // potential match, depending on the search term, but only the first archetype will be used
-    std::vector<TargetObj> *archetype = get_target_objects(archetype_link.c_str(), msg);
+    std::vector<TargetObj> archetype;
     std::vector<TargetObj>::iterator it;
 
+    archetype.swap(target_scratch);
+    get_target_objects(archetype, archetype_query, msg);
+
     int target = 0;
     // Traverse the list looking for the first matched archetype.
-    for(it = archetype -> begin(); it != archetype -> end() && target >= 0; it++) {
+    for(it = archetype.begin(); it != archetype.end() && target >= 0; it++) {
         target = it -> obj_id;
 
         if(debug_enabled())
             debug_printf(DL_DEBUG, "Checking obj %d", it -> obj_id);
     }
 
-    delete archetype;
+    archetype.swap(target_scratch);
 
     // If an archetype was located, return it, otherwise 0 to indicate a failure.
     return(target < 0 ? target : 0);
@@ -281,12 +290,15 @@ int TWTrapAIEcology::select_spawnpoint(sScrMsg *msg)
 {
     // Select the spawn point to use. This may return more than one potential match, in
     // which case only the first concrete object will be used.
-    std::vector<TargetObj> *concrete = get_target_objects(spawnpoint_link.c_str(), msg);
+    std::vector<TargetObj> concrete;
     std::vector<TargetObj>::iterator it;
 
+    concrete.swap(target_scratch);
+    get_target_objects(concrete, spawnpoint_query, msg);
+
     int target = 0;
     // Traverse the list looking for the first matched concrete.
-    for(it = concrete -> begin(); it != concrete -> end() && target <= 0; it++) {
+    for(it = concrete.begin(); it != concrete.end() && target <= 0; it++) {
         target = it -> obj_id;
 
         if(debug_enabled())
@@ -296,7 +308,7 @@ int TWTrapAIEcology::select_spawnpoint(sScrMsg *msg)
         if(target > 0) target = check_spawn_visibility(target);
     }
 
-    delete concrete;
+    concrete.swap(target_scratch);
 
     // If a concrete object was located, return it, otherwise 0 to indicate a failure.
     return(target > 0 ? target : 0);
@@ -305,11 +317,11 @@ int TWTrapAIEcology::select_spawnpoint(sScrMsg *msg)
 
 void TWTrapAIEcology::spawn_ai(int archetype, int spawnpoint)
 {
-    SService<IObjectSrv>    obj_srv(g_pScriptManager);
-    SService<ISoundScrSrv>  snd_srv(g_pScriptManager);
+    SService<IObjectSrv>&   obj_srv = ScriptServices::object();
+    SService<ISoundScrSrv>& snd_srv = ScriptServices::sound();
 
     if(debug_enabled()) {
-        std::string aname, sname;
+        ScratchString aname, sname;
         get_object_namestr(aname, archetype);
         get_object_namestr(sname, spawnpoint);
         debug_printf(DL_DEBUG, "Attempting to spawn an instance of %s at %s", aname.c_str(), sname.c_str());
@@ -351,7 +363,7 @@ void TWTrapAIEcology::spawn_ai(int archetype, int spawnpoint)
         // Send a TurnOn to the spawn point so it can do stuff and/or relay it.
         post_message(spawnpoint, "TurnOn");
     } else if(debug_enabled()) {
-        std::string name;
+        ScratchString name;
         get_object_namestr(name, archetype);
 
         debug_printf(DL_WARNING, "BeginCreate failed to spawn instance of archetype %s", name.c_str());
@@ -362,11 +374,11 @@ void TWTrapAIEcology::spawn_ai(int archetype, int spawnpoint)
 void TWTrapAIEcology::copy_spawn_aiwatch(object src, object dest)
 {
     linkset links;
-    SService<ILinkSrv>      link_srv(g_pScriptManager);
-    SInterface<ILinkManager>  link_mgr(g_pScriptManager);
-	SService<ILinkToolsSrv> link_tools(g_pScriptManager);
+    SService<ILinkSrv>&       link_srv = ScriptServices::link();
+    SInterface<ILinkManager>& link_mgr = ScriptServices::link_manager();
+    static LinkFlavour aiwatch("AIWatchObj");
 
-    link_srv -> GetAll(links, link_tools -> LinkKindNamed("AIWatchObj"), src, 0);
+    link_srv -> GetAll(links, aiwatch.id(), src, 0);
     for(; links.AnyLinksLeft(); links.NextLink()) {
 		sLink link = links.Get();
 
@@ -386,7 +398,7 @@ void TWTrapAIEcology::copy_spawn_aiwatch(object src, object dest)
 int TWTrapAIEcology::check_spawn_visibility(int target)
 {
     true_bool onscreen;
-    SService<IObjectSrv> obj_srv(g_pScriptManager);
+    SService<IObjectSrv>& obj_srv = ScriptServices::object();
 
     // If spawns can happen in view, this function is a NOP basically.
     if(allow_visible_spawn) return target;
@@ -394,7 +406,7 @@ int TWTrapAIEcology::check_spawn_visibility(int target)
     // When debugging is on, explicitly check that the object does not have
     // Render Type: Not Rendered set
     if(debug_enabled()) {
-        SService<IPropertySrv> prop_srv(g_pScriptManager);
+        SService<IPropertySrv>& prop_srv = ScriptServices::property();
 
         // Does it have a Render Type? If so, check what the render type is
         if(prop_srv -> Possessed(target, "RenderType")) {
@@ -422,7 +434,7 @@ int TWTrapAIEcology::check_spawn_visibility(int target)
 
 void TWTrapAIEcology::get_spawn_location(int spawnpoint, cScrVec& location, cScrVec& facing)
 {
-    SService<IObjectSrv> obj_srv(g_pScriptManager);
+    SService<IObjectSrv>& obj_srv = ScriptServices::object();
 
     obj_srv -> Position(location, spawnpoint);
     obj_srv -> Facing(facing, spawnpoint);
@@ -433,8 +445,9 @@ void TWTrapAIEcology::get_spawn_location(int spawnpoint, cScrVec& location, cScr
     // Does the spawn point have an offset set?
     char *design_note = GetObjectParams(spawnpoint);
     if(design_note) {
+        const DesignNote& note = DesignNote::index(design_note);
         cScrVec offset;
-        get_scriptparam_floatvec(design_note, "SpawnOffset", offset);
+        get_scriptparam_floatvec(note, "SpawnOffset", offset);
 
         // offset will be filled with zeros if no offset has been set, so this is safe even if
         // no offset has actually been specified by the user.
@@ -460,15 +473,13 @@ void TWTrapAIEcology::increase_spawncount(void)
 
     // If the user has set a qvar to store the spawn count in, update it.
     if(!spawned_qvar.empty()) {
-        set_qvar(spawned_qvar, spawn);
+        set_qvar(spawned_qvar.c_str(), spawn);
     }
 }
 
 
 void TWTrapAIEcology::fixup_links(int combined)
 {
-	SService<ILinkSrv>      link_srv(g_pScriptManager);
-	SService<ILinkToolsSrv> link_tools(g_pScriptManager);
 
     int spawnpoint = spawnpoint_id(combined);
     int spawned    = spawn_id(combined);
@@ -483,19 +494,15 @@ void TWTrapAIEcology::fixup_links(int combined)
 
 void TWTrapAIEcology::update_pop_limit(void)
 {
-    if(!pop_qvar.empty()) {
-        pop_limit = get_qvar_value(pop_qvar, pop_limit);
-
-        if(debug_enabled()) debug_printf(DL_DEBUG, "Using population limit %d from %s.", pop_limit, pop_qvar.c_str());
-    }
+    // Only recalculated if the QVars the limit is read from have changed
+    if(pop_limit.update() && debug_enabled())
+        debug_printf(DL_DEBUG, "Using population limit %d from %s.", int(pop_limit), pop_limit.qvar().c_str());
 }
 
 
 void TWTrapAIEcology::update_refresh(void)
 {
-    if(!refresh_qvar.empty()) {
-        refresh = get_qvar_value(refresh_qvar, refresh);
-
-        if(debug_enabled()) debug_printf(DL_DEBUG, "Using update rate %d from %s.", refresh, refresh_qvar.c_str());
-    }
+    // Only recalculated if the QVars the rate is read from have changed
+    if(refresh.update() && debug_enabled())
+        debug_printf(DL_DEBUG, "Using update rate %d from %s.", int(refresh), refresh.qvar().c_str());
 }
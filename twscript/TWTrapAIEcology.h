@@ -31,6 +31,7 @@
 #include <string>
 #include "TWBaseScript.h"
 #include "TWBaseTrap.h"
+#include "IString.h"
 
 /** @class TWTrapAIEcology
  *
@@ -90,13 +91,13 @@
 class TWTrapAIEcology : public TWBaseTrap
 {
 public:
-    TWTrapAIEcology(const char* name, int object) : TWBaseTrap(name, object), refresh(30000), refresh_qvar(), pop_limit(1), pop_qvar(), lives(0), lives_qvar(), spawned_qvar(), allow_visible_spawn(false),
+    TWTrapAIEcology(const char* name, int object) : TWBaseTrap(name, object), refresh(30000), pop_limit(1), lives(0), lives_qvar(), spawned_qvar(), allow_visible_spawn(false),
                                                     archetype_link("&%Weighted"),
                                                     spawnpoint_link("&!#ScriptParams"),
+                                                    archetype_query(), spawnpoint_query(),
                                                     SCRIPT_VAROBJ(TWTrapAIEcology, enabled, object),
                                                     SCRIPT_VAROBJ(TWTrapAIEcology, population, object),
-                                                    SCRIPT_VAROBJ(TWTrapAIEcology, spawned, object),
-                                                    SCRIPT_VAROBJ(TWTrapAIEcology, update_timer, object)
+                                                    SCRIPT_VAROBJ(TWTrapAIEcology, spawned, object)
         { /* fnord */ }
 
 protected:
@@ -309,14 +310,14 @@ private:
     void fixup_links(int combined);
 
 
-    /** Determine whether the population limit should be read from a qvar rather than the design note,
-     *  and if so update its value if needed.
+    /** If the population limit is read from a qvar rather than the design note,
+     *  update its value if the qvar has changed.
      */
     void update_pop_limit(void);
 
 
-    /** Determine whether the update rate should be read from a qvar rather than the design note,
-     *  and if so update its value if needed.
+    /** If the update rate is read from a qvar rather than the design note,
+     *  update its value if the qvar has changed.
      */
     void update_refresh(void);
 
@@ -352,23 +353,22 @@ private:
     }
 
 
-    int  refresh;                          //!< How frequently should the ecology be updated?
-    std::string refresh_qvar;              //!< If the refresh rate is controlled by a qvar, the name goes here.
-    int  pop_limit;                        //!< How many AIs should this ecology allow?
-    std::string pop_qvar;                  //!< If the population is controlled by a qvar, the name goes here.
+    QVarParam<int> refresh;                //!< How frequently should the ecology be updated? May be read from a qvar.
+    QVarParam<int> pop_limit;              //!< How many AIs should this ecology allow? May be read from a qvar.
     int  lives;                            //!< Should there be an upper limit to the number of AIs that are ever spawned?
-    std::string lives_qvar;                //!< If the number of lives is controlled by a qvar, the name goes here.
-    std::string spawned_qvar;              //!< The name of the qvar to store the total number of spawned AIs.
+    IString lives_qvar;                    //!< If the number of lives is controlled by a qvar, the name goes here.
+    IString spawned_qvar;                  //!< The name of the qvar to store the total number of spawned AIs.
 
     bool allow_visible_spawn;              //!< Should spawns be allowed to happen on-screen?
 
-    std::string archetype_link;            //!< The string to use as a linkdef when searching for the archetype to spawn.
-    std::string spawnpoint_link;           //!< The string to use as a linkdef when searching for spawn points.
+    IString archetype_link;                //!< The string to use as a linkdef when searching for the archetype to spawn.
+    IString spawnpoint_link;               //!< The string to use as a linkdef when searching for spawn points.
+    TargetQuery archetype_query;           //!< archetype_link compiled into a target query.
+    TargetQuery spawnpoint_query;          //!< spawnpoint_link compiled into a target query.
 
-    script_int               enabled;      //!< Is the ecology enabled?
-    script_int               population;   //!< The number of currently spawned AIs
-    script_int               spawned;      //!< The number of AIs spawned from the start.
-    script_handle<tScrTimer> update_timer; //!< A timer used to update the ecology.
+    cached_script_int        enabled;      //!< Is the ecology enabled?
+    cached_script_int        population;   //!< The number of currently spawned AIs
+    cached_script_int        spawned;      //!< The number of AIs spawned from the start.
 };
 
 #else // SCR_GENSCRIPTS
@@ -2,6 +2,7 @@
 
 #include "TWTrapPhysStateCtrl.h"
 #include "ScriptLib.h"
+#include "ScriptServices.h"
 
 /* =============================================================================
  *  TWTrapPhysStateCtrl Impmementation - protected members
@@ -48,14 +49,15 @@ void TWTrapPhysStateCtrl::update()
 
     // Fetch the contents of the object's design note
     char *design_note = GetObjectParams(ObjId());
+    const DesignNote& note = DesignNote::index(design_note);
 
     if(!design_note)
         debug_printf(DL_WARNING, "No Editor -> Design Note. Falling back on defaults.");
 
-    data.set_location = get_scriptparam_floatvec(design_note, "Location", data.location);
-    data.set_facing   = get_scriptparam_floatvec(design_note, "Facing"  , data.facing  );
-    data.set_velocity = get_scriptparam_floatvec(design_note, "Velocity", data.velocity);
-    data.set_rotvel   = get_scriptparam_floatvec(design_note, "RotVel"  , data.rotvel  );
+    data.set_location = get_scriptparam_floatvec(note, "Location", data.location);
+    data.set_facing   = get_scriptparam_floatvec(note, "Facing"  , data.facing  );
+    data.set_velocity = get_scriptparam_floatvec(note, "Velocity", data.velocity);
+    data.set_rotvel   = get_scriptparam_floatvec(note, "RotVel"  , data.rotvel  );
 
     if(data.set_location || data.set_facing || data.set_velocity || data.set_rotvel) {
         IterateLinks("ControlDevice", ObjId(), 0, set_state, this, static_cast<void*>(&data));
@@ -79,7 +81,7 @@ int TWTrapPhysStateCtrl::set_state(ILinkSrv*, ILinkQuery* link_query, IScript* s
     object target_obj = current_link.dest; // For readability
 
     // Names are only needed for debugging, but meh.
-    std::string target_name;
+    ScratchString target_name;
     static_cast<TWTrapPhysStateCtrl *>(script) -> get_object_namestr(target_name, target_obj);
 
     if(static_cast<TWTrapPhysStateCtrl *>(script) -> debug_enabled())
@@ -87,7 +89,7 @@ int TWTrapPhysStateCtrl::set_state(ILinkSrv*, ILinkQuery* link_query, IScript* s
 
     // Obtain the current location and orientation - both are needed, even if one is being updated,
     // so that teleport will work
-    SService<IObjectSrv> obj_srv(g_pScriptManager);
+    SService<IObjectSrv>& obj_srv = ScriptServices::object();
     cScrVec position, facing;
     obj_srv -> Position(position, target_obj);
     obj_srv -> Facing(facing, target_obj);
@@ -110,7 +112,7 @@ int TWTrapPhysStateCtrl::set_state(ILinkSrv*, ILinkQuery* link_query, IScript* s
     obj_srv -> Teleport(target_obj, position, facing, 0);
 
     // Now fix up the object velocities.
-    SService<IPropertySrv> prop_srv(g_pScriptManager);
+    SService<IPropertySrv>& prop_srv = ScriptServices::property();
     if(prop_srv -> Possessed(target_obj, "PhysState")) {
 
         if(state_data -> set_velocity) {
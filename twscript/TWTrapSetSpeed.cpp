@@ -1,5 +1,8 @@
 #include "TWTrapSetSpeed.h"
 #include "ScriptLib.h"
+#include "ScriptServices.h"
+#include "LinkFlavours.h"
+#include "QVarShadow.h"
 
 /* =============================================================================
  *  TWTrapSetSpeed Impmementation - protected members
@@ -11,26 +14,27 @@ void TWTrapSetSpeed::init(int time)
 
     // Fetch the contents of the object's design note
     char *design_note = GetObjectParams(ObjId());
+    const DesignNote& note = DesignNote::index(design_note);
 
     if(!design_note) {
         debug_printf(DL_WARNING, "No Editor -> Design Note. Falling back on defaults.");
     } else {
 
         // Check whether the speed should come from a stim message intensity
-        char *speed_data = get_scriptparam_string(design_note, "Speed");
+        char *speed_data = get_scriptparam_string(note, "Speed");
         if(speed_data) {
             intensity = (::_stricmp(speed_data, "[intensity]") == 0);
             g_pMalloc -> Free(speed_data);
         }
 
         // Get the speed the user has set for this object (which could be a QVar string)
-        speed = get_scriptparam_float(design_note, "Speed", 0.0f, qvar_name);
+        speed = get_scriptparam_float(note, "Speed", 0.0f, qvar_name);
 
         // Is immediate mode enabled?
-        immediate = get_scriptparam_bool(design_note, "Immediate", false);
+        immediate = get_scriptparam_bool(note, "Immediate", false);
 
         // Is qvar tracking enabled? (can only be turned on if there is a qvar to track, too)
-        if(get_scriptparam_bool(design_note, "WatchQVar", false) && !qvar_name.empty()) {
+        if(get_scriptparam_bool(note, "WatchQVar", false) && !qvar_name.empty()) {
             int namelen = get_qvar_namelen(qvar_name.c_str());
 
             if(namelen) {
@@ -40,8 +44,7 @@ void TWTrapSetSpeed::init(int time)
                 if(debug_enabled())
                     debug_printf(DL_DEBUG, "Adding subscription to qvar '%s'.", qvar_sub.c_str());
 
-                SService<IQuestSrv> quest_srv(g_pScriptManager);
-                quest_srv -> SubscribeMsg(ObjId(), qvar_sub.c_str(), kQuestDataAny);
+                QVarShadow::subscribe(ObjId(), qvar_sub.c_str());
             } else {
                 debug_printf(DL_WARNING, "Unable to subscribe to qvar with name '%s'", qvar_name.c_str());
             }
@@ -50,12 +53,12 @@ void TWTrapSetSpeed::init(int time)
         // Sort out the target string too.
         // IMPORTANT NOTE: While it is tempting to build the full target object list at this point,
         // doing so may possibly miss dynamically created terrpts.
-        char *target = get_scriptparam_string(design_note, "Dest", "[me]");
+        char *target = get_scriptparam_string(note, "Dest", "[me]");
         if(target) {
             set_target = target;
             g_pMalloc -> Free(target);
         }
-        if(set_target.empty())
+        if(set_target.empty() || !compile_target_query(set_target.c_str(), set_query))
             debug_printf(DL_WARNING, "Target set failed!");
 
         g_pMalloc -> Free(design_note);
@@ -78,19 +81,20 @@ TWBaseScript::MsgStatus TWTrapSetSpeed::on_message(sScrMsg* msg, cMultiParm& rep
     MsgStatus result = TWBaseTrap::on_message(msg, reply);
     if(result != MS_CONTINUE) return result;
 
-    // Remove the qvar subscription during shutdown
-    if(!::_stricmp(msg -> message, "EndScript")) {
-        if(!qvar_sub.empty()) {
-            if(debug_enabled())
-                debug_printf(DL_DEBUG, "Removing subscription to '%s'", qvar_sub.c_str());
+    switch(get_message_id()) {
+        // Remove the qvar subscription during shutdown
+        case MSGID_ENDSCRIPT:
+            if(!qvar_sub.empty()) {
+                if(debug_enabled())
+                    debug_printf(DL_DEBUG, "Removing subscription to '%s'", qvar_sub.c_str());
 
-            SService<IQuestSrv> quest_srv(g_pScriptManager);
-            quest_srv -> UnsubscribeMsg(ObjId(), qvar_sub.c_str());
-        }
+                QVarShadow::unsubscribe(ObjId(), qvar_sub.c_str());
+            }
+            break;
 
-    // Handle updates on quest variable change
-    } else if(!::_stricmp(msg -> message, "QuestChange")) {
-        return on_questchange(static_cast<sQuestMsg *>(msg), reply);
+        // Handle updates on quest variable change
+        case MSGID_QUESTCHANGE:
+            return on_questchange(static_cast<sQuestMsg *>(msg), reply);
     }
 
     return result;
@@ -110,6 +114,11 @@ TWBaseScript::MsgStatus TWTrapSetSpeed::on_onmsg(sScrMsg* msg, cMultiParm& reply
 
 TWBaseScript::MsgStatus TWTrapSetSpeed::on_questchange(sQuestMsg* msg, cMultiParm& reply)
 {
+    // The object may also be receiving changes to QVars read by other scripts,
+    // and those should not trigger an update.
+    if(qvar_sub.empty() || !msg -> m_pName || ::_stricmp(msg -> m_pName, qvar_sub.c_str()))
+        return MS_CONTINUE;
+
     // Only bother doing speed updates if the quest variable changes
     if(msg -> m_newValue != msg -> m_oldValue) {
         update_speed(msg);
@@ -127,7 +136,6 @@ TWBaseScript::MsgStatus TWTrapSetSpeed::on_questchange(sQuestMsg* msg, cMultiPar
 
 void TWTrapSetSpeed::update_speed(sScrMsg* msg)
 {
-    SInterface<IObjectSystem> obj_sys(g_pScriptManager);
 
     if(debug_enabled())
         debug_printf(DL_DEBUG, "Updating speed.");
@@ -155,13 +163,16 @@ void TWTrapSetSpeed::update_speed(sScrMsg* msg)
         if(debug_enabled())
             debug_printf(DL_DEBUG, "Looking up targets matched by %s.", set_target.c_str());
 
-        std::vector<TargetObj>* targets = get_target_objects(set_target.c_str(), msg);
+        std::vector<TargetObj> targets;
+
+        targets.swap(target_scratch);
+        get_target_objects(targets, set_query, msg);
 
-        if(!targets -> empty()) {
+        if(!targets.empty()) {
             // Process the target list, setting the speeds accordingly
             std::vector<TargetObj>::iterator it;
-            std::string targ_name;
-            for(it = targets -> begin() ; it != targets -> end(); it++) {
+            ScratchString targ_name;
+            for(it = targets.begin() ; it != targets.end(); it++) {
                 set_tpath_speed(it -> obj_id);
 
                 if(debug_enabled()) {
@@ -173,8 +184,8 @@ void TWTrapSetSpeed::update_speed(sScrMsg* msg)
             debug_printf(DL_WARNING, "Dest '%s' did not match any objects.", set_target.c_str());
         }
 
-        // And clean up
-        delete targets;
+        // And hand the storage back for reuse
+        targets.swap(target_scratch);
     }
 
     // And now update any moving terrain objects linked to this one via ScriptParams with data set to "SetSpeed"
@@ -184,15 +195,16 @@ void TWTrapSetSpeed::update_speed(sScrMsg* msg)
 
 void TWTrapSetSpeed::set_tpath_speed(object obj_id)
 {
-    SService<ILinkSrv> link_srv(g_pScriptManager);
-    SService<ILinkToolsSrv> link_tools_srv(g_pScriptManager);
+    SService<ILinkSrv>&      link_srv = ScriptServices::link();
+    SService<ILinkToolsSrv>& link_tools_srv = ScriptServices::link_tools();
 
     // Convert to a multiparm here for ease
     cMultiParm setspeed = speed;
 
     // Fetch all TPath links from the specified object to any other
     linkset lsLinks;
-    link_srv -> GetAll(lsLinks, link_tools_srv -> LinkKindNamed("TPath"), obj_id, 0);
+    static LinkFlavour tpath("TPath");
+    link_srv -> GetAll(lsLinks, tpath.id(), obj_id, 0);
 
     // Set the speed for each link to the set speed.
     for(; lsLinks.AnyLinksLeft(); lsLinks.NextLink()) {
@@ -213,14 +225,14 @@ int TWTrapSetSpeed::set_mterr_speed(ILinkSrv*, ILinkQuery* link_query, IScript*
     object mterr_obj = current_link.dest;
 
     if(client -> debug_enabled()) {
-        std::string mterr_name;
+        ScratchString mterr_name;
         client -> get_object_namestr(mterr_name, mterr_obj);
         client -> debug_printf(DL_DEBUG, "setting speed %.3f on %s", client -> speed, mterr_name.c_str());
     }
 
     // Find out where the moving terrain is headed to
-    SInterface<ILinkManager> link_mgr(g_pScriptManager);
-    SInterface<IRelation> path_next_rel = link_mgr -> GetRelationNamed("TPathNext");
+    static LinkFlavour tpath_next("TPathNext");
+    SInterface<IRelation>& path_next_rel = tpath_next.relation();
 
     // Try to get the link to the next waypoint
     long id = path_next_rel -> GetSingleLink(mterr_obj, 0);
@@ -232,8 +244,8 @@ int TWTrapSetSpeed::set_mterr_speed(ILinkSrv*, ILinkQuery* link_query, IScript*
         object terrpt_obj = target_link.dest;   // For readability
 
         if(terrpt_obj) {
-            SService<IObjectSrv> obj_srv(g_pScriptManager);
-            SService<IPhysSrv> phys_srv(g_pScriptManager);
+            SService<IObjectSrv>& obj_srv = ScriptServices::object();
+            SService<IPhysSrv>&   phys_srv = ScriptServices::phys();
 
             // Get the location of the terrpt
             cScrVec target_pos;
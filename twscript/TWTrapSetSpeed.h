@@ -106,7 +106,7 @@
 class TWTrapSetSpeed : public TWBaseTrap
 {
 public:
-    TWTrapSetSpeed(const char* name, int object) : TWBaseTrap(name, object), speed(0.0f), immediate(false), qvar_name(), qvar_sub(), set_target()
+    TWTrapSetSpeed(const char* name, int object) : TWBaseTrap(name, object), speed(0.0f), immediate(false), qvar_name(), qvar_sub(), set_target(), set_query()
         { /* fnord */ }
 
 protected:
@@ -200,6 +200,7 @@ private:
     std::string qvar_name;  //!< The name of the QVar to read speed from, may include basic maths.
     std::string qvar_sub;   //!< The name of the QVar to subscribe to.
     std::string set_target; //!< The target string set by the user.
+    TargetQuery set_query;  //!< set_target compiled into a target query.
 };
 
 #else // SCR_GENSCRIPTS
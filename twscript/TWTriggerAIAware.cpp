@@ -1,5 +1,7 @@
 #include "TWTriggerAIAware.h"
 #include "ScriptLib.h"
+#include "ScriptServices.h"
+#include "LinkFlavours.h"
 
 /* =============================================================================
  *  TWTriggerAIAware Impmementation - protected members
@@ -15,6 +17,7 @@ void TWTriggerAIAware::init(int time)
 
     // Fetch the contents of the object's design note
     char *design_note = GetObjectParams(ObjId());
+    const DesignNote& note = DesignNote::index(design_note);
 
     is_linked.Init(0);
 
@@ -24,12 +27,12 @@ void TWTriggerAIAware::init(int time)
     } else {
         std::string dummy;
 
-        refresh = get_scriptparam_int(design_note, "Rate", 500, dummy);
-        trigger_level = (eAIScriptAlertLevel)get_scriptparam_int(design_note, "Alertness" , 2, dummy);
+        refresh = get_scriptparam_int(note, "Rate", 500, dummy);
+        trigger_level = (eAIScriptAlertLevel)get_scriptparam_int(note, "Alertness" , 2, dummy);
 
-        char *objname = get_scriptparam_string(design_note, "Object", "Garrett");
+        char *objname = get_scriptparam_string(note, "Object", "Garrett");
         if(objname) {
-            SService<IObjectSrv>  obj_srv(g_pScriptManager);
+            SService<IObjectSrv>& obj_srv = ScriptServices::object();
 
             obj_srv -> Named(trigger_object, objname);
             if(!trigger_object) {
@@ -44,7 +47,7 @@ void TWTriggerAIAware::init(int time)
     }
 
     if(debug_enabled()) {
-        std::string targ_name;
+        ScratchString targ_name;
         get_object_namestr(targ_name, trigger_object);
 
         debug_printf(DL_DEBUG, "Initialised trigger level %d, match object '%s', check rate %d", trigger_level, targ_name.c_str(), refresh);
@@ -61,16 +64,13 @@ TWBaseScript::MsgStatus TWTriggerAIAware::on_message(sScrMsg* msg, cMultiParm& r
     MsgStatus result = TWBaseTrigger::on_message(msg, reply);
     if(result != MS_CONTINUE) return result;
 
-    if(!::_stricmp(msg -> message, "Alertness")) {
-        return on_alertness(static_cast<sAIAlertnessMsg*>(msg), reply);
-    } else if(!::_stricmp(msg -> message, "Timer")) {
-        return on_timer(static_cast<sScrTimerMsg*>(msg), reply);
+    switch(get_message_id()) {
+        case MSGID_ALERTNESS:    return on_alertness(static_cast<sAIAlertnessMsg*>(msg), reply);
+        case MSGID_TIMER:        return on_timer(static_cast<sScrTimerMsg*>(msg), reply);
 
-    // Make sure death and knockout stops the check
-    } else if(!::_stricmp(msg -> message, "Slain")) {
-        return on_slain(static_cast<sSlayMsg*>(msg), reply);
-    } else if(!::_stricmp(msg -> message, "IgnorePotion")) {
-        return on_ignorepotion(msg, reply);
+        // Make sure death and knockout stops the check
+        case MSGID_SLAIN:        return on_slain(static_cast<sSlayMsg*>(msg), reply);
+        case MSGID_IGNOREPOTION: return on_ignorepotion(msg, reply);
     }
 
     return result;
@@ -110,7 +110,7 @@ TWBaseScript::MsgStatus TWTriggerAIAware::on_alertness(sAIAlertnessMsg* msg, cMu
 TWBaseScript::MsgStatus TWTriggerAIAware::on_timer(sScrTimerMsg* msg, cMultiParm& reply)
 {
     // Only bother doing anything if the timer name is correct.
-    if(!::_stricmp(msg -> name, "CheckLinks")) {
+    if(MessageNames::lookup(msg -> name) == MSGID_CHECKLINKS) {
         check_awareness(msg);
     }
 
@@ -152,17 +152,15 @@ TWBaseScript::MsgStatus TWTriggerAIAware::on_slain(sSlayMsg* msg, cMultiParm& re
 
 void TWTriggerAIAware::check_awareness(sScrMsg* msg)
 {
-    SService<IObjectSrv>     obj_srv(g_pScriptManager);
-    SService<ILinkSrv>       link_srv(g_pScriptManager);
-    SInterface<ILinkManager> link_mgr(g_pScriptManager);
-    SService<ILinkToolsSrv>  link_tools(g_pScriptManager);
+    SService<ILinkSrv>& link_srv = ScriptServices::link();
+    static LinkFlavour awareness("AIAwareness");
 
     bool target_linked = false;
 
     stop_timer(); // most of the time this is redundant, but be sure.
 
     linkset links;
-    link_srv -> GetAll(links, link_tools -> LinkKindNamed("AIAwareness"), ObjId(), 0);
+    link_srv -> GetAll(links, awareness.id(), ObjId(), 0);
     for(; !target_linked && links.AnyLinksLeft(); links.NextLink()) {
 		sLink link = links.Get();
 
@@ -173,10 +171,7 @@ void TWTriggerAIAware::check_awareness(sScrMsg* msg)
             if(int(trigger_object) > 0 && link.dest == trigger_object) {
                 target_linked = true;
             } else if(int(trigger_object) < 0) {
-                true_bool inherits;
-                obj_srv -> InheritsFrom(inherits, link.dest, trigger_object);
-
-                target_linked = (bool)inherits;
+                target_linked = ArchetypeIndex::get().inherits_from(link.dest, trigger_object);
             }
         }
     }
@@ -192,14 +187,11 @@ void TWTriggerAIAware::check_awareness(sScrMsg* msg)
         send_off_message(msg);
     }
 
-    update_timer = set_timed_message("CheckLinks", refresh, kSTM_OneShot);
+    schedule_poll("CheckLinks", refresh);
 }
 
 
 void TWTriggerAIAware::stop_timer(void)
 {
-    if(update_timer) {
-        cancel_timed_message(update_timer);
-        update_timer.Clear();
-    }
+    cancel_poll();
 }
@@ -40,7 +40,6 @@ class TWTriggerAIAware : public TWBaseTrigger
 {
 public:
     TWTriggerAIAware(const char* name, int object) : TWBaseTrigger(name, object), refresh(500), trigger_level(kModerateAlert), trigger_object(0),
-                                                     SCRIPT_VAROBJ(TWTriggerAIAware, update_timer, object),
                                                      SCRIPT_VAROBJ(TWTriggerAIAware, is_linked, object)
         { /* fnord */ }
 
@@ -125,8 +124,7 @@ private:
     eAIScriptAlertLevel trigger_level;     //!< The level at which the trigger should fire an On message
     object trigger_object;                 //!< The object (or archetype) that must be linked before the trigger happens
 
-    script_handle<tScrTimer> update_timer; //!< A timer used to update the trigger
-    script_int               is_linked;    //!< Is the target currently linked?
+    cached_script_int        is_linked;    //!< Is the target currently linked?
 };
 
 #else // SCR_GENSCRIPTS
@@ -1,5 +1,6 @@
 #include "TWTriggerAIEcologyDespawn.h"
 #include "ScriptLib.h"
+#include "ScriptServices.h"
 
 /* =============================================================================
  *  TWTriggerAIEcologyDespawn Impmementation - protected members
@@ -15,6 +16,7 @@ void TWTriggerAIEcologyDespawn::init(int time)
 
     // Fetch the contents of the object's design note
     char *design_note = GetObjectParams(ObjId());
+    const DesignNote& note = DesignNote::index(design_note);
 
     if(!design_note) {
         debug_printf(DL_WARNING, "No Editor -> Design Note. Falling back on defaults.");
@@ -23,7 +25,7 @@ void TWTriggerAIEcologyDespawn::init(int time)
         std::string dummy;
 
         // How often should the ecology update?
-        refresh  = get_scriptparam_int(design_note, "Rate", 20000, dummy);
+        refresh  = get_scriptparam_int(note, "Rate", 20000, dummy);
 
         g_pMalloc -> Free(design_note);
     }
@@ -45,10 +47,9 @@ TWBaseScript::MsgStatus TWTriggerAIEcologyDespawn::on_message(sScrMsg* msg, cMul
     MsgStatus result = TWBaseTrigger::on_message(msg, reply);
     if(result != MS_CONTINUE) return result;
 
-    if(!::_stricmp(msg -> message, "Timer")) {
-        return on_timer(static_cast<sScrTimerMsg*>(msg), reply);
-    } else if(!::_stricmp(msg -> message, "Slain")) {
-        return on_slain(static_cast<sSlayMsg*>(msg), reply);
+    switch(get_message_id()) {
+        case MSGID_TIMER: return on_timer(static_cast<sScrTimerMsg*>(msg), reply);
+        case MSGID_SLAIN: return on_slain(static_cast<sSlayMsg*>(msg), reply);
     }
 
     return result;
@@ -57,12 +58,12 @@ TWBaseScript::MsgStatus TWTriggerAIEcologyDespawn::on_message(sScrMsg* msg, cMul
 
 TWBaseScript::MsgStatus TWTriggerAIEcologyDespawn::on_timer(sScrTimerMsg* msg, cMultiParm& reply)
 {
-    if(!::_stricmp(msg -> name, "Despawn")) {
+    if(MessageNames::lookup(msg -> name) == MSGID_DESPAWN) {
         if(!attempt_despawn(msg)) {
             if(debug_enabled())
                 debug_printf(DL_DEBUG, "Re-setting timed despawn");
 
-            update_timer = set_timed_message("Despawn", refresh, kSTM_OneShot);
+            schedule_poll("Despawn", refresh);
         }
     }
 
@@ -76,10 +77,7 @@ TWBaseScript::MsgStatus TWTriggerAIEcologyDespawn::on_slain(sSlayMsg* msg, cMult
     if(debug_enabled())
         debug_printf(DL_DEBUG, "AI slain, setting timed despawn");
 
-    if(update_timer) {
-        cancel_timed_message(update_timer);
-    }
-    update_timer = set_timed_message("Despawn", refresh, kSTM_OneShot);
+    schedule_poll("Despawn", refresh, false);
 
     return MS_CONTINUE;
 }
@@ -91,7 +89,7 @@ bool TWTriggerAIEcologyDespawn::attempt_despawn(sScrMsg *msg)
         debug_printf(DL_DEBUG, "Attempting despawn of AI");
 
     true_bool onscreen;
-    SService<IObjectSrv> obj_srv(g_pScriptManager);
+    SService<IObjectSrv>& obj_srv = ScriptServices::object();
 
     // If the AI is visible, it can't be despawned
     obj_srv -> RenderedThisFrame(onscreen, ObjId());
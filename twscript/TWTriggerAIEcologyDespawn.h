@@ -38,8 +38,7 @@
 class TWTriggerAIEcologyDespawn : public TWBaseTrigger
 {
 public:
-    TWTriggerAIEcologyDespawn(const char* name, int object) : TWBaseTrigger(name, object), refresh(20000),
-                                                              SCRIPT_VAROBJ(TWTriggerAIEcologyDespawn, update_timer, object)
+    TWTriggerAIEcologyDespawn(const char* name, int object) : TWBaseTrigger(name, object), refresh(20000)
         { /* fnord */ }
 
 protected:
@@ -103,7 +102,6 @@ private:
     bool attempt_despawn(sScrMsg *msg);
 
     int  refresh;                          //!< How frequently should the despawn happen after death?
-    script_handle<tScrTimer> update_timer; //!< A timer used to despawn the AI
 };
 
 #else // SCR_GENSCRIPTS
@@ -1,5 +1,7 @@
 #include "TWTriggerAIEcologyFireShadow.h"
 #include "ScriptLib.h"
+#include "ScriptServices.h"
+#include "LinkFlavours.h"
 
 /* =============================================================================
  *  TWTriggerAIEcologyFireShadow Impmementation - protected members
@@ -15,6 +17,7 @@ void TWTriggerAIEcologyFireShadow::init(int time)
 
     // Fetch the contents of the object's design note
     char *design_note = GetObjectParams(ObjId());
+    const DesignNote& note = DesignNote::index(design_note);
 
     if(!design_note) {
         debug_printf(DL_WARNING, "No Editor -> Design Note. Falling back on defaults.");
@@ -23,11 +26,11 @@ void TWTriggerAIEcologyFireShadow::init(int time)
         std::string tmp;
 
         // How often should the ecology update?
-        refresh  = get_scriptparam_int(design_note, "Rate", 1000, tmp);
+        refresh  = get_scriptparam_int(note, "Rate", 1000, tmp);
 
         // parse the timewarp settings
-        speed_factor = get_scriptparam_float(design_note, "Speedup"    , 0.8125, tmp);
-        min_timewarp = get_scriptparam_float(design_note, "MinTimewarp", 0.03, tmp);
+        speed_factor = get_scriptparam_float(note, "Speedup"    , 0.8125, tmp);
+        min_timewarp = get_scriptparam_float(note, "MinTimewarp", 0.03, tmp);
 
         g_pMalloc -> Free(design_note);
     }
@@ -49,10 +52,9 @@ TWBaseScript::MsgStatus TWTriggerAIEcologyFireShadow::on_message(sScrMsg* msg, c
     MsgStatus result = TWBaseTrigger::on_message(msg, reply);
     if(result != MS_CONTINUE) return result;
 
-    if(!::_stricmp(msg -> message, "Timer")) {
-        return on_timer(static_cast<sScrTimerMsg*>(msg), reply);
-    } else if(!::_stricmp(msg -> message, "Slain")) {
-        return on_slain(static_cast<sSlayMsg*>(msg), reply);
+    switch(get_message_id()) {
+        case MSGID_TIMER: return on_timer(static_cast<sScrTimerMsg*>(msg), reply);
+        case MSGID_SLAIN: return on_slain(static_cast<sSlayMsg*>(msg), reply);
     }
 
     return result;
@@ -61,14 +63,14 @@ TWBaseScript::MsgStatus TWTriggerAIEcologyFireShadow::on_message(sScrMsg* msg, c
 
 TWBaseScript::MsgStatus TWTriggerAIEcologyFireShadow::on_timer(sScrTimerMsg* msg, cMultiParm& reply)
 {
-    if(!::_stricmp(msg -> name, "FireShadow")) {
+    if(MessageNames::lookup(msg -> name) == MSGID_FIRESHADOW) {
         speedup();
 
         if(!attempt_despawn(msg)) {
             if(debug_enabled())
                 debug_printf(DL_DEBUG, "Re-setting timed despawn");
 
-            update_timer = set_timed_message("FireShadow", refresh, kSTM_OneShot);
+            schedule_poll("FireShadow", refresh);
         }
     }
 
@@ -81,10 +83,7 @@ TWBaseScript::MsgStatus TWTriggerAIEcologyFireShadow::on_slain(sSlayMsg* msg, cM
     if(debug_enabled())
         debug_printf(DL_DEBUG, "AI slain, setting up slain behaviour");
 
-    if(update_timer) {
-        cancel_timed_message(update_timer);
-    }
-    update_timer = set_timed_message("FireShadow", refresh, kSTM_OneShot);
+    schedule_poll("FireShadow", refresh, false);
 
     fireshadow_flee();
 
@@ -100,7 +99,7 @@ bool TWTriggerAIEcologyFireShadow::attempt_despawn(sScrMsg *msg)
     fireshadow_flee();
 
     true_bool onscreen;
-    SService<IObjectSrv> obj_srv(g_pScriptManager);
+    SService<IObjectSrv>& obj_srv = ScriptServices::object();
 
     // If the AI is visible, it can't be despawned
     obj_srv -> RenderedThisFrame(onscreen, ObjId());
@@ -137,12 +136,12 @@ bool TWTriggerAIEcologyFireShadow::attempt_despawn(sScrMsg *msg)
 
 void TWTriggerAIEcologyFireShadow::fire_corseparts(void)
 {
-    SService<IPhysSrv>      phys_srv(g_pScriptManager);
-    SService<ILinkSrv>      link_srv(g_pScriptManager);
-    SService<ILinkToolsSrv> link_tools(g_pScriptManager);
+    SService<IPhysSrv>&      phys_srv = ScriptServices::phys();
+    SService<ILinkSrv>&      link_srv = ScriptServices::link();
+    static LinkFlavour corpse_part("CorpsePart");
     linkset links;
 
-    link_srv -> GetAllInheritedSingle(links, link_tools -> LinkKindNamed("CorpsePart"), ObjId(), 0);
+    link_srv -> GetAllInheritedSingle(links, corpse_part.id(), ObjId(), 0);
     for(; links.AnyLinksLeft(); links.NextLink()) {
         sLink link = links.Get();
         object fired;
@@ -153,11 +152,11 @@ void TWTriggerAIEcologyFireShadow::fire_corseparts(void)
 
 void TWTriggerAIEcologyFireShadow::fireshadow_flee(void)
 {
-    SService<IObjectSrv>   obj_srv(g_pScriptManager);
-    SService<IPropertySrv> prop_srv(g_pScriptManager);
+    SService<IObjectSrv>&   obj_srv = ScriptServices::object();
+    SService<IPropertySrv>& prop_srv = ScriptServices::property();
 
-    object metaprop;
-    obj_srv -> Named(metaprop, "M-FireShadowFlee");
+    static NamedObject flee("M-FireShadowFlee");
+    object metaprop = flee.id();
     if(metaprop) {
         true_bool has_prop;
 
@@ -179,8 +178,7 @@ void TWTriggerAIEcologyFireShadow::fireshadow_flee(void)
 
 void TWTriggerAIEcologyFireShadow::speedup(void)
 {
-    SService<IObjectSrv>   obj_srv(g_pScriptManager);
-    SService<IPropertySrv> prop_srv(g_pScriptManager);
+    SService<IPropertySrv>& prop_srv = ScriptServices::property();
 
     cMultiParm timewarp;
     prop_srv -> Get(timewarp, ObjId(), "TimeWarp", NULL);
@@ -38,8 +38,7 @@
 class TWTriggerAIEcologyFireShadow : public TWBaseTrigger
 {
 public:
-    TWTriggerAIEcologyFireShadow(const char* name, int object) : TWBaseTrigger(name, object), refresh(1000), speed_factor(0.8125), min_timewarp(0.03),
-                                                                 SCRIPT_VAROBJ(TWTriggerAIEcologyFireShadow, update_timer, object)
+    TWTriggerAIEcologyFireShadow(const char* name, int object) : TWBaseTrigger(name, object), refresh(1000), speed_factor(0.8125), min_timewarp(0.03)
         { /* fnord */ }
 
 protected:
@@ -123,7 +122,6 @@ private:
     int   refresh;                         //!< How frequently should the speedup and despawn happen after slay?
     float speed_factor;                    //!< The speedup factor for the fireshadow
     float min_timewarp;                    //!< The minimum timewarp factor.
-    script_handle<tScrTimer> update_timer; //!< A timer used to speedup and despawn the AI
 };
 
 #else // SCR_GENSCRIPTS
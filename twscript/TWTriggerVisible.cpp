@@ -2,6 +2,7 @@
 #include <lg/iids.h>
 #include "TWTriggerVisible.h"
 #include "ScriptLib.h"
+#include "ScriptServices.h"
 
 /* =============================================================================
  *  TWTriggerVisible Implementation - protected members
@@ -13,6 +14,7 @@ void TWTriggerVisible::init(int time)
 
     // Fetch the contents of the object's design note
     char *design_note = GetObjectParams(ObjId());
+    const DesignNote& note = DesignNote::index(design_note);
 
     if(!design_note) {
         debug_printf(DL_WARNING, "No Editor -> Design Note. Falling back on defaults.");
@@ -20,10 +22,10 @@ void TWTriggerVisible::init(int time)
     } else {
         std::string dummy;
 
-        lowlight_threshold  = get_scriptparam_int(design_note, "Low" , 35, dummy);
-        highlight_threshold = get_scriptparam_int(design_note, "High", 55, dummy);
+        lowlight_threshold  = get_scriptparam_int(note, "Low" , 35, dummy);
+        highlight_threshold = get_scriptparam_int(note, "High", 55, dummy);
 
-        refresh = get_scriptparam_int(design_note, "Rate", 500, dummy);
+        refresh = get_scriptparam_int(note, "Rate", 500, dummy);
 
         g_pMalloc -> Free(design_note);
     }
@@ -33,12 +35,8 @@ void TWTriggerVisible::init(int time)
         debug_printf(DL_DEBUG, "Update rate set to %dms", refresh);
     }
 
-    if(update_timer) {
-        cancel_timed_message(update_timer);
-    }
-
     // And schedule the next update.
-    update_timer = set_timed_message("CheckVis", refresh, kSTM_OneShot);
+    schedule_poll("CheckVis", refresh);
 }
 
 
@@ -48,7 +46,7 @@ TWBaseScript::MsgStatus TWTriggerVisible::on_message(sScrMsg* msg, cMultiParm& r
     MsgStatus result = TWBaseScript::on_message(msg, reply);
     if(result != MS_CONTINUE) return result;
 
-    if(!::_stricmp(msg -> message, "Timer")) {
+    if(get_message_id() == MSGID_TIMER) {
         return on_timer(static_cast<sScrTimerMsg*>(msg), reply);
     }
 
@@ -59,10 +57,10 @@ TWBaseScript::MsgStatus TWTriggerVisible::on_message(sScrMsg* msg, cMultiParm& r
 TWBaseScript::MsgStatus TWTriggerVisible::on_timer(sScrTimerMsg *msg, cMultiParm& reply)
 {
     // Only bother doing anything if the timer name is correct.
-    if(!::_stricmp(msg -> name, "CheckVis")) {
+    if(MessageNames::lookup(msg -> name) == MSGID_CHECKVIS) {
         check_visible(msg);
 
-        update_timer = set_timed_message("CheckVis", refresh, kSTM_OneShot);
+        schedule_poll("CheckVis", refresh);
     }
 
     return MS_CONTINUE;
@@ -71,7 +69,7 @@ TWBaseScript::MsgStatus TWTriggerVisible::on_timer(sScrTimerMsg *msg, cMultiParm
 
 void TWTriggerVisible::check_visible(sScrMsg* msg)
 {
-    SService<IPropertySrv> prop_serv(g_pScriptManager);
+    SService<IPropertySrv>& prop_serv = ScriptServices::property();
     if(prop_serv -> Possessed(ObjId(), "AI_Visibility")) {
         cMultiParm light;
         prop_serv -> Get(light, ObjId(), "AI_Visibility", "Light rating");
@@ -40,8 +40,7 @@ class TWTriggerVisible : public TWBaseTrigger
 {
 public:
     TWTriggerVisible(const char* name, int object) : TWBaseTrigger(name, object), refresh(500), lowlight_threshold(35), highlight_threshold(55),
-                                                     SCRIPT_VAROBJ(TWTriggerVisible, is_litup    , object),
-                                                     SCRIPT_VAROBJ(TWTriggerVisible, update_timer, object)
+                                                     SCRIPT_VAROBJ(TWTriggerVisible, is_litup    , object)
         { /* fnord */ }
 
 protected:
@@ -96,8 +95,7 @@ private:
     int lowlight_threshold;  //!< The boundary below which the player is considered in darkness
     int highlight_threshold; //!< The boundary above which the player is considered in light
 
-    script_int               is_litup;     //!< Is the player currently illuminated?
-    script_handle<tScrTimer> update_timer; //!< A timer used to update the trigger
+    cached_script_int        is_litup;     //!< Is the player currently illuminated?
 };
 
 #else // SCR_GENSCRIPTS